@@ -1,5 +1,509 @@
 #pragma once
 
-/// TODO: Signals/Slots/listeners, etc
-/// TODO: A multi-threaded version with a dispatcher/mailboxes etc
-/// TODO: Maybe add an Actors module?
\ No newline at end of file
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <span>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+#include <functional>
+#include <iterator>
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <bit>
+
+#include "include/Parallel.h"
+#include "include/Includes/Assuming.h"
+
+namespace gamelib
+{
+	template <typename SIGNATURE>
+	class Delegate;
+
+	/// Like `std::function`, but callables of up to two pointers in size (eg. a lambda capturing `this` and one reference,
+	/// or a function pointer) are stored inline, without allocating. Bigger ones are stored on the heap.
+	template <typename R, typename... ARGS>
+	class Delegate<R(ARGS...)>
+	{
+	public:
+
+		static constexpr size_t InlineSize = 2 * sizeof(void*);
+
+		template <typename FUNC>
+		static constexpr bool StoredInline = sizeof(FUNC) <= InlineSize && alignof(FUNC) <= alignof(void*) && std::is_nothrow_move_constructible_v<FUNC>;
+
+		Delegate() noexcept = default;
+		Delegate(std::nullptr_t) noexcept {}
+
+		template <typename FUNC>
+		requires (!std::is_same_v<std::remove_cvref_t<FUNC>, Delegate> && std::is_invocable_r_v<R, std::remove_cvref_t<FUNC>&, ARGS...>)
+		Delegate(FUNC&& func)
+		{
+			using stored_type = std::remove_cvref_t<FUNC>;
+			if constexpr (StoredInline<stored_type>)
+			{
+				new (mStorage) stored_type(std::forward<FUNC>(func));
+				mInvoke = [](std::byte* storage, ARGS... args) -> R {
+					return std::invoke(*std::launder(reinterpret_cast<stored_type*>(storage)), std::forward<ARGS>(args)...);
+				};
+			}
+			else
+			{
+				new (mStorage) stored_type*(new stored_type(std::forward<FUNC>(func)));
+				mInvoke = [](std::byte* storage, ARGS... args) -> R {
+					return std::invoke(**std::launder(reinterpret_cast<stored_type**>(storage)), std::forward<ARGS>(args)...);
+				};
+			}
+			mManage = &Manage<stored_type>;
+		}
+
+		Delegate(Delegate const& other) { CopyFrom(other); }
+		Delegate(Delegate&& other) noexcept { MoveFrom(other); }
+		Delegate& operator=(Delegate const& other) { if (this != &other) { Reset(); CopyFrom(other); } return *this; }
+		Delegate& operator=(Delegate&& other) noexcept { if (this != &other) { Reset(); MoveFrom(other); } return *this; }
+		Delegate& operator=(std::nullptr_t) noexcept { Reset(); return *this; }
+		~Delegate() { Reset(); }
+
+		R operator()(ARGS... args) const { return mInvoke(mStorage, std::forward<ARGS>(args)...); }
+
+		explicit operator bool() const noexcept { return mInvoke != nullptr; }
+
+		void Reset() noexcept
+		{
+			if (mManage)
+				mManage(Operation::Destroy, mStorage, nullptr);
+			mInvoke = nullptr;
+			mManage = nullptr;
+		}
+
+	private:
+
+		enum class Operation { Copy, Move, Destroy };
+
+		alignas(void*) mutable std::byte mStorage[InlineSize];
+		R (*mInvoke)(std::byte*, ARGS...) = nullptr;
+		void (*mManage)(Operation, std::byte* to, std::byte* from) = nullptr;
+
+		template <typename FUNC>
+		static void Manage(Operation operation, std::byte* to, std::byte* from)
+		{
+			if constexpr (StoredInline<FUNC>)
+			{
+				switch (operation)
+				{
+				case Operation::Copy: new (to) FUNC(*std::launder(reinterpret_cast<FUNC*>(from))); break;
+				case Operation::Move: new (to) FUNC(std::move(*std::launder(reinterpret_cast<FUNC*>(from)))); std::launder(reinterpret_cast<FUNC*>(from))->~FUNC(); break;
+				case Operation::Destroy: std::launder(reinterpret_cast<FUNC*>(to))->~FUNC(); break;
+				}
+			}
+			else
+			{
+				switch (operation)
+				{
+				case Operation::Copy: new (to) FUNC*(new FUNC(**std::launder(reinterpret_cast<FUNC**>(from)))); break;
+				case Operation::Move: new (to) FUNC*(*std::launder(reinterpret_cast<FUNC**>(from))); break;
+				case Operation::Destroy: delete *std::launder(reinterpret_cast<FUNC**>(to)); break;
+				}
+			}
+		}
+
+		void CopyFrom(Delegate const& other)
+		{
+			if (other.mManage)
+				other.mManage(Operation::Copy, mStorage, other.mStorage);
+			mInvoke = other.mInvoke;
+			mManage = other.mManage;
+		}
+
+		void MoveFrom(Delegate& other) noexcept
+		{
+			if (other.mManage)
+				other.mManage(Operation::Move, mStorage, other.mStorage);
+			mInvoke = std::exchange(other.mInvoke, nullptr);
+			mManage = std::exchange(other.mManage, nullptr);
+		}
+	};
+
+	/// Identifies a listener connected to a signal
+	enum class ConnectionID : uint32_t { None = 0 };
+
+	/// Calls every connected listener when emitted. Emitting doesn't allocate.
+	/// Listeners can connect and disconnect (themselves or others) while the signal is being emitted;
+	/// listeners connected during an emission are first called by the next one.
+	template <typename... ARGS>
+	class Signal
+	{
+	public:
+
+		using Listener = Delegate<void(ARGS...)>;
+
+		ConnectionID Connect(Listener listener)
+		{
+			const auto id = ConnectionID{ mNextID++ };
+			(mEmitting ? mConnectedWhileEmitting : mListeners).push_back({ id, std::move(listener) });
+			return id;
+		}
+
+		/// Returns false if there is no such listener
+		bool Disconnect(ConnectionID id)
+		{
+			if (id == ConnectionID::None)
+				return false;
+
+			for (auto* listeners : { &mListeners, &mConnectedWhileEmitting })
+			{
+				const auto it = std::ranges::find(*listeners, id, &Connection::ID);
+				if (it == listeners->end())
+					continue;
+
+				/// Can't erase while emitting, so the emission doesn't skip anyone, and the listener may be the one running;
+				/// disconnected listeners are destroyed afterwards
+				if (mEmitting && listeners == &mListeners)
+					it->ID = ConnectionID::None;
+				else
+					listeners->erase(it);
+				return true;
+			}
+			return false;
+		}
+
+		void DisconnectAll()
+		{
+			if (mEmitting)
+			{
+				for (auto& listener : mListeners)
+					listener.ID = ConnectionID::None;
+			}
+			else
+				mListeners.clear();
+			mConnectedWhileEmitting.clear();
+		}
+
+		void Emit(ARGS... args) const
+		{
+			++mEmitting;
+			for (auto const& listener : mListeners)
+			{
+				if (listener.ID != ConnectionID::None)
+					listener.Function(args...);
+			}
+			if (--mEmitting == 0)
+				const_cast<Signal*>(this)->FinishEmitting();
+		}
+
+		void operator()(ARGS... args) const { Emit(std::forward<ARGS>(args)...); }
+
+		size_t ListenerCount() const noexcept { return mListeners.size() + mConnectedWhileEmitting.size(); }
+		bool HasListeners() const noexcept { return ListenerCount() != 0; }
+		explicit operator bool() const noexcept { return HasListeners(); }
+
+	private:
+
+		struct Connection
+		{
+			ConnectionID ID;
+			Listener Function;
+		};
+
+		std::vector<Connection> mListeners;
+		std::vector<Connection> mConnectedWhileEmitting;
+		uint32_t mNextID = 1;
+		mutable int mEmitting = 0;
+
+		void FinishEmitting()
+		{
+			std::erase_if(mListeners, [](Connection const& listener) { return listener.ID == ConnectionID::None; });
+			if (!mConnectedWhileEmitting.empty())
+			{
+				std::ranges::move(mConnectedWhileEmitting, std::back_inserter(mListeners));
+				mConnectedWhileEmitting.clear();
+			}
+		}
+	};
+
+	/// Collects events and hands them to the listeners all at once, as a span, when dispatched
+	template <typename EVENT>
+	class BatchedSignal
+	{
+	public:
+
+		Signal<std::span<EVENT const>> Listeners;
+
+		void Queue(EVENT event) { mQueued.push_back(std::move(event)); }
+
+		/// Events queued by the listeners are dispatched in the next call
+		void Dispatch()
+		{
+			if (mQueued.empty())
+				return;
+			std::swap(mQueued, mDispatching);
+			Listeners.Emit(mDispatching);
+			mDispatching.clear();
+		}
+
+		size_t QueuedCount() const noexcept { return mQueued.size(); }
+
+	private:
+
+		std::vector<EVENT> mQueued;
+		std::vector<EVENT> mDispatching;
+	};
+
+	/// A fixed-capacity queue that any number of threads can push to, and one thread pops from, without locking.
+	/// Based on Dmitry Vyukov's bounded MPMC queue: every cell has a sequence number that tells whether it's ready
+	/// to be written to or read from in the current lap around the ring.
+	template <typename T>
+	class BoundedMPSCQueue
+	{
+	public:
+
+		/// The capacity is rounded up to a power of two
+		explicit BoundedMPSCQueue(size_t capacity)
+			: mMask(std::bit_ceil(std::max<size_t>(capacity, 2)) - 1)
+			, mCells(std::make_unique<Cell[]>(mMask + 1))
+		{
+			for (size_t i = 0; i <= mMask; ++i)
+				mCells[i].Sequence.store(i, std::memory_order_relaxed);
+		}
+
+		~BoundedMPSCQueue()
+		{
+			while (TryPop()) {}
+		}
+
+		BoundedMPSCQueue(BoundedMPSCQueue const&) = delete;
+		BoundedMPSCQueue& operator=(BoundedMPSCQueue const&) = delete;
+
+		/// Can be called from any thread; returns false (and drops the value) if the queue is full
+		bool TryPush(T value)
+		{
+			auto position = mEnqueuePosition.load(std::memory_order_relaxed);
+			Cell* cell;
+			while (true)
+			{
+				cell = &mCells[position & mMask];
+				const auto sequence = cell->Sequence.load(std::memory_order_acquire);
+				const auto difference = intptr_t(sequence) - intptr_t(position);
+				if (difference == 0)
+				{
+					if (mEnqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+						break;
+				}
+				else if (difference < 0)
+					return false;
+				else
+					position = mEnqueuePosition.load(std::memory_order_relaxed);
+			}
+
+			new (cell->Storage) T(std::move(value));
+			cell->Sequence.store(position + 1, std::memory_order_release);
+			return true;
+		}
+
+		/// Must only be called by the consumer thread
+		std::optional<T> TryPop()
+		{
+			const auto position = mDequeuePosition.load(std::memory_order_relaxed);
+			auto& cell = mCells[position & mMask];
+			if (cell.Sequence.load(std::memory_order_acquire) != position + 1)
+				return std::nullopt;
+
+			auto& value = *std::launder(reinterpret_cast<T*>(cell.Storage));
+			std::optional<T> result{ std::move(value) };
+			value.~T();
+			cell.Sequence.store(position + mMask + 1, std::memory_order_release);
+			mDequeuePosition.store(position + 1, std::memory_order_relaxed);
+			return result;
+		}
+
+		/// Pops and calls `func(T&)` for up to `max_count` values, without moving them out; returns the number popped.
+		/// Must only be called by the consumer thread.
+		template <typename FUNC>
+		size_t PopAll(FUNC&& func, size_t max_count = ~size_t{})
+		{
+			auto position = mDequeuePosition.load(std::memory_order_relaxed);
+			size_t count = 0;
+			for (; count < max_count; ++count, ++position)
+			{
+				auto& cell = mCells[position & mMask];
+				if (cell.Sequence.load(std::memory_order_acquire) != position + 1)
+					break;
+
+				auto& value = *std::launder(reinterpret_cast<T*>(cell.Storage));
+				func(value);
+				value.~T();
+				cell.Sequence.store(position + mMask + 1, std::memory_order_release);
+				mDequeuePosition.store(position + 1, std::memory_order_relaxed);
+			}
+			return count;
+		}
+
+		/// Exact when called from the consumer thread, a hint otherwise
+		bool Empty() const noexcept
+		{
+			const auto position = mDequeuePosition.load(std::memory_order_relaxed);
+			return mCells[position & mMask].Sequence.load(std::memory_order_acquire) != position + 1;
+		}
+
+		size_t Capacity() const noexcept { return mMask + 1; }
+
+	private:
+
+		static constexpr size_t CacheLineSize = 64;
+
+		struct Cell
+		{
+			std::atomic<size_t> Sequence;
+			alignas(T) std::byte Storage[sizeof(T)];
+		};
+
+		size_t const mMask;
+		std::unique_ptr<Cell[]> const mCells;
+
+		/// Producers and the consumer write these, so they get cache lines of their own
+		alignas(CacheLineSize) std::atomic<size_t> mEnqueuePosition = 0;
+		alignas(CacheLineSize) std::atomic<size_t> mDequeuePosition = 0;
+	};
+
+	/// Messages posted from any thread, delivered to the `Received` listeners by whichever thread owns the mailbox
+	/// (usually through a `MessageDispatcher`)
+	template <typename MESSAGE>
+	class Mailbox
+	{
+	public:
+
+		explicit Mailbox(size_t capacity = 1024) : mQueue(capacity) {}
+
+		Signal<MESSAGE&> Received;
+
+		/// Thread-safe; returns false if the mailbox is full, so the sender can decide whether to retry, drop or handle the message itself
+		bool Post(MESSAGE message) { return mQueue.TryPush(std::move(message)); }
+
+		/// Emits `Received` for up to `max_count` messages, in the order they were posted; returns the number delivered.
+		/// Must not be called by two threads at once.
+		size_t Deliver(size_t max_count = ~size_t{})
+		{
+			return mQueue.PopAll([this](MESSAGE& message) { Received(message); }, max_count);
+		}
+
+		bool Empty() const noexcept { return mQueue.Empty(); }
+		size_t Capacity() const noexcept { return mQueue.Capacity(); }
+
+	private:
+
+		BoundedMPSCQueue<MESSAGE> mQueue;
+	};
+
+	/// Delivers the messages of the mailboxes registered for a frame phase (eg. "input", "physics", "render") when the phase is dispatched,
+	/// so subsystems can post to each other from any thread but receive at well-defined points of the frame
+	class MessageDispatcher
+	{
+	public:
+
+		/// The mailbox must outlive the dispatcher (or be removed with `RemovePhase`)
+		template <typename MESSAGE>
+		void Add(std::string_view phase, Mailbox<MESSAGE>& mailbox)
+		{
+			auto it = mPhases.find(phase);
+			if (it == mPhases.end())
+				it = mPhases.emplace(std::string{ phase }, std::vector<Delegate<size_t()>>{}).first;
+			it->second.push_back([&mailbox] { return mailbox.Deliver(); });
+		}
+
+		/// Delivers the messages in the phase's mailboxes (in the order the mailboxes were added) on the calling thread;
+		/// returns the number of messages delivered. Messages posted by the listeners to mailboxes of the same phase
+		/// may be delivered in this call or in the next one.
+		size_t Dispatch(std::string_view phase)
+		{
+			const auto it = mPhases.find(phase);
+			if (it == mPhases.end())
+				return 0;
+			size_t delivered = 0;
+			for (auto& deliver : it->second)
+				delivered += deliver();
+			return delivered;
+		}
+
+		bool RemovePhase(std::string_view phase)
+		{
+			const auto it = mPhases.find(phase);
+			if (it == mPhases.end())
+				return false;
+			mPhases.erase(it);
+			return true;
+		}
+
+	private:
+
+		std::map<std::string, std::vector<Delegate<size_t()>>, std::less<>> mPhases;
+	};
+
+	/// Processes the messages sent to it on a pool thread, one message at a time, so its state needs no locking
+	/// as long as only `Receive` touches it. Processing is scheduled by `Send` when the actor is idle,
+	/// and handles up to `BatchSize` messages before yielding the thread to other tasks.
+	/// `Receive` must not throw. The actor must not be destroyed while it may have messages to process (eg. call `WorkStealingPool::WaitIdle` first).
+	template <typename MESSAGE>
+	class Actor
+	{
+	public:
+
+		static constexpr size_t BatchSize = 64;
+
+		explicit Actor(WorkStealingPool& pool, size_t mailbox_capacity = 1024)
+			: mPool(pool), mMailbox(mailbox_capacity)
+		{
+		}
+
+		virtual ~Actor()
+		{
+			AssumingEqual(mScheduled.load(), false, "actor destroyed while it had messages to process");
+		}
+
+		Actor(Actor const&) = delete;
+		Actor& operator=(Actor const&) = delete;
+
+		/// Thread-safe; returns false if the mailbox is full
+		bool Send(MESSAGE message)
+		{
+			if (!mMailbox.TryPush(std::move(message)))
+				return false;
+			Schedule();
+			return true;
+		}
+
+		WorkStealingPool& Pool() const noexcept { return mPool; }
+
+	protected:
+
+		virtual void Receive(MESSAGE& message) = 0;
+
+	private:
+
+		WorkStealingPool& mPool;
+		BoundedMPSCQueue<MESSAGE> mMailbox;
+		std::atomic<bool> mScheduled = false;
+
+		void Schedule()
+		{
+			/// Pairs with the fence in `Process`, so either it sees the message we pushed, or we see it's no longer scheduled
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (!mScheduled.exchange(true, std::memory_order_acquire))
+				mPool.Submit([this] { Process(); });
+		}
+
+		void Process()
+		{
+			mMailbox.PopAll([this](MESSAGE& message) { Receive(message); }, BatchSize);
+			mScheduled.store(false, std::memory_order_release);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (!mMailbox.Empty())
+				Schedule();
+		}
+	};
+}
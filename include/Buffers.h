@@ -2,6 +2,12 @@
 
 #include <cstdint>
 #include <type_traits>
+#include <span>
+#include <array>
+#include <limits>
+#include <algorithm>
+#include <iterator>
+#include <memory>
 
 namespace gamelib
 {
@@ -15,8 +21,13 @@ namespace gamelib
 	struct output_buffer_traits : base_buffer_traits<char>
 	{
 		static constexpr bool can_reserve = false;
+		/// Whether `buffer_append_chunk` is specialized for the buffer
+		static constexpr bool can_append_chunks = false;
 	};
 
+	/// Size of the stack buffer the generic algorithms move chunks through
+	static constexpr size_t buffer_chunk_size = 4096;
+
 	/// ////////////////////////////////////////////////////////////// ///
 	/// Output buffer concept
 	/// ////////////////////////////////////////////////////////////// ///
@@ -73,6 +84,13 @@ namespace gamelib
 		return result;
 	}
 
+	/// Appends the whole span at once; returns the number of elements appended
+	template <typename BUFFER, typename ELEMENT_TYPE>
+	size_t buffer_append_chunk(BUFFER&& buffer, std::span<ELEMENT_TYPE const> chunk)
+	{
+		static_assert(false, "buffer_append_chunk needs to be specialized for the BUFFER type");
+	}
+
 	template <typename BUFFER, typename CHAR_TYPE>
 	size_t buffer_append_cstring_ptr(BUFFER& buffer, const CHAR_TYPE* cstr)
 	{
@@ -147,6 +165,8 @@ namespace gamelib
 	struct input_buffer_traits : base_buffer_traits<char>
 	{
 		static constexpr bool is_random_access = false;
+		/// Whether `buffer_read_chunk` is specialized for the buffer
+		static constexpr bool can_read_chunks = false;
 	};
 
 	template <typename BUFFER>
@@ -162,6 +182,14 @@ namespace gamelib
 		static_assert(false, "buffer_read_to needs to be specialized for the BUFFER type");
 	}
 
+	/// Consumes up to `scratch.size()` elements from the buffer and returns them as a contiguous span, which either points
+	/// into the buffer's own memory or into `scratch`. An empty span means there is no more data.
+	template <typename BUFFER, typename ELEMENT_TYPE>
+	std::span<ELEMENT_TYPE const> buffer_read_chunk(BUFFER&& buffer, std::span<ELEMENT_TYPE> scratch)
+	{
+		static_assert(false, "buffer_read_chunk needs to be specialized for the BUFFER type");
+	}
+
 	template <typename T, typename BUFFER>
 	T buffer_read(BUFFER&& buffer)
 	{
@@ -176,11 +204,48 @@ namespace gamelib
 		return 1;
 	}
 
+	/// The remaining contents of a random-access buffer, in place; doesn't consume them
+	template <typename BUFFER>
+	auto buffer_remaining_span(BUFFER&& buffer)
+	{
+		static_assert(input_buffer_traits<std::remove_cvref_t<BUFFER>>::is_random_access, "buffer_remaining_span requires a random-access buffer");
+		const auto begin = std::to_address(buffer_get_iterator(buffer, 0));
+		const auto end = std::to_address(buffer_get_iterator(buffer, std::numeric_limits<intptr_t>::max()));
+		return std::span{ begin, size_t(end - begin) };
+	}
+
+	/// Appends a chunk read from an input buffer, in one call if the output buffer supports it
+	template <typename OUTPUT_BUFFER, typename ELEMENT_TYPE>
+	size_t buffer_append_read_chunk(OUTPUT_BUFFER& output, std::span<ELEMENT_TYPE const> chunk)
+	{
+		if constexpr (output_buffer_traits<std::remove_cvref_t<OUTPUT_BUFFER>>::can_append_chunks)
+			return buffer_append_chunk(output, chunk);
+		else
+			return buffer_append_range(output, chunk.data(), chunk.data() + chunk.size());
+	}
+
 	template <typename INPUT_BUFFER, typename OUTPUT_BUFFER, typename ELEMENT_TYPE>
 	size_t buffer_copy(INPUT_BUFFER&& input, OUTPUT_BUFFER&& output, size_t try_elements)
 	{
-		/// TODO: If input buffer supports buffering, do this in batches, or make a buffer_copy_buffered function
-		if constexpr (input_buffer_traits<INPUT_BUFFER>::is_random_access)
+		using input_traits = input_buffer_traits<std::remove_cvref_t<INPUT_BUFFER>>;
+		if constexpr (input_traits::can_read_chunks)
+		{
+			std::array<ELEMENT_TYPE, buffer_chunk_size> scratch;
+			size_t result = 0;
+			while (try_elements)
+			{
+				const auto chunk = buffer_read_chunk(input, std::span{ scratch }.first(std::min(try_elements, scratch.size())));
+				if (chunk.empty())
+					break;
+				const auto appended = buffer_append_read_chunk(output, chunk);
+				result += appended;
+				try_elements -= chunk.size();
+				if (appended < chunk.size())
+					break;
+			}
+			return result;
+		}
+		else if constexpr (input_traits::is_random_access)
 		{
 			auto start = buffer_get_iterator(input, 0);
 			auto end = buffer_get_iterator(input, (intptr_t)try_elements);
@@ -204,8 +269,11 @@ namespace gamelib
 	template <typename INPUT_BUFFER, typename OUTPUT_BUFFER>
 	size_t buffer_copy(INPUT_BUFFER&& input, OUTPUT_BUFFER&& output)
 	{
-		/// TODO: If input buffer supports buffering, do this in batches, or make a buffer_copy_buffered function
-		if constexpr (input_buffer_traits<INPUT_BUFFER>::is_random_access)
+		using input_traits = input_buffer_traits<std::remove_cvref_t<INPUT_BUFFER>>;
+		using element_type = typename input_traits::element_type;
+		if constexpr (input_traits::can_read_chunks)
+			return buffer_copy<INPUT_BUFFER, OUTPUT_BUFFER, element_type>(std::forward<INPUT_BUFFER>(input), std::forward<OUTPUT_BUFFER>(output), std::numeric_limits<size_t>::max());
+		else if constexpr (input_traits::is_random_access)
 		{
 			auto start = buffer_get_iterator(input, 0);
 			auto end = buffer_get_iterator(input, std::numeric_limits<intptr_t>::max());
@@ -218,7 +286,7 @@ namespace gamelib
 			{
 				if (buffer_available_data(input) == 0)
 					break;
-				if (!buffer_append(output, buffer_read<input_buffer_traits<INPUT_BUFFER>::element_type>(input)))
+				if (!buffer_append(output, buffer_read<element_type>(input)))
 					break;
 				result++;
 			}
@@ -226,26 +294,58 @@ namespace gamelib
 		}
 	}
 
+	/// Returns the number of elements read
 	template <typename INPUT_BUFFER, typename OUTPUT_IT>
 	size_t buffer_read_range(INPUT_BUFFER&& input, OUTPUT_IT first, OUTPUT_IT last)
 	{
-		/// TODO: If input buffer supports buffering, do this in batches, or make a buffer_copy_buffered function
-		if constexpr (input_buffer_traits<INPUT_BUFFER>::is_random_access)
+		using input_traits = input_buffer_traits<std::remove_cvref_t<INPUT_BUFFER>>;
+		using element_type = typename input_traits::element_type;
+		const auto start = first;
+		if constexpr (input_traits::can_read_chunks)
 		{
-			auto start = buffer_get_iterator(input, 0);
+			/// Contiguous outputs are read into directly, unless the input hands out its own memory
+			constexpr bool read_directly = std::contiguous_iterator<OUTPUT_IT> && std::is_same_v<std::iter_value_t<OUTPUT_IT>, element_type>;
+			std::array<element_type, read_directly ? 1 : buffer_chunk_size> scratch;
+			while (first != last)
+			{
+				const auto remaining = size_t(std::distance(first, last));
+				if constexpr (read_directly)
+				{
+					const auto chunk = buffer_read_chunk(input, std::span<element_type>{ std::to_address(first), remaining });
+					if (chunk.empty())
+						break;
+					if (chunk.data() == std::to_address(first))
+						first += chunk.size();
+					else
+						first = std::copy(chunk.begin(), chunk.end(), first);
+				}
+				else
+				{
+					const auto chunk = buffer_read_chunk(input, std::span{ scratch }.first(std::min(scratch.size(), remaining)));
+					if (chunk.empty())
+						break;
+					first = std::copy(chunk.begin(), chunk.end(), first);
+				}
+			}
+			return std::distance(start, first);
+		}
+		else if constexpr (input_traits::is_random_access)
+		{
+			auto begin = buffer_get_iterator(input, 0);
 			auto end = buffer_get_iterator(input, std::distance(first, last));
-			return std::distance(std::copy(start, end, first, last), first);
+			return std::distance(start, std::copy(begin, end, first));
 		}
 		else
 		{
-			while (first < last)
+			while (first != last)
 			{
 				if (buffer_available_data(input) == 0)
 					break;
-				if (!buffer_read_to(input, *first++))
+				if (!buffer_read_to(input, *first))
 					break;
+				++first;
 			}
-			return std::distance(first, last);
+			return std::distance(start, first);
 		}
 	}
 
@@ -2,6 +2,10 @@
 
 #include "Circle.h"
 #include "../Random.h"
+#include "../Includes/Assuming.h"
+#include <span>
+#include <numbers>
+#include <vector>
 
 namespace gamelib
 {
@@ -26,4 +30,166 @@ namespace gamelib
 	{
 		return s.position() + random_point(s.size(), rng);
 	}
-}
\ No newline at end of file
+
+	namespace detail
+	{
+		/// Calls `func(i, u, v)` for every i in [0, count), with `u` and `v` uniformly distributed in [0, 1).
+		/// Floats take a single 64-bit draw per pair. With a `random::CounterRNG`, the draws of a batch don't depend on each other.
+		template <std::floating_point T, typename RNG, typename FUNC>
+		void for_each_unit_pair(RNG& rng, size_t count, FUNC&& func)
+		{
+			static constexpr bool single_draw = sizeof(T) <= sizeof(float);
+			static constexpr size_t draws = single_draw ? 1 : 2;
+
+			if constexpr (std::same_as<std::remove_cvref_t<RNG>, random::CounterRNG>)
+			{
+				const auto first = rng.Skip(count * draws);
+				for (size_t i = 0; i < count; ++i)
+				{
+					const auto bits = rng.At(first + i * draws);
+					if constexpr (single_draw)
+						func(i, random::UnitReal<T>(bits), random::UnitReal<T>(bits << 32));
+					else
+						func(i, random::UnitReal<T>(bits), random::UnitReal<T>(rng.At(first + i * draws + 1)));
+				}
+			}
+			else
+			{
+				for (size_t i = 0; i < count; ++i)
+				{
+					const auto bits = random::Bits(rng);
+					if constexpr (single_draw)
+						func(i, random::UnitReal<T>(bits), random::UnitReal<T>(bits << 32));
+					else
+						func(i, random::UnitReal<T>(bits), random::UnitReal<T>(random::Bits(rng)));
+				}
+			}
+		}
+	}
+
+	/// Function: random_points
+	/// Fills `out` with points uniformly distributed in the shape. Much faster than calling `random_point` in a loop,
+	/// especially with a `random::CounterRNG`.
+	template <std::floating_point T, typename RNG>
+	void random_points(trec2<T> const& s, RNG&& rng, std::span<glm::tvec2<T>> out)
+	{
+		const auto origin = s.position();
+		const auto size = s.size();
+		detail::for_each_unit_pair<T>(rng, out.size(), [&](size_t i, T u, T v) {
+			out[i] = origin + glm::tvec2<T>{ u, v } * size;
+		});
+	}
+
+	template <std::floating_point T, typename RNG>
+	void random_points(tcircle2<T> const& s, RNG&& rng, std::span<glm::tvec2<T>> out)
+	{
+		using std::sin; using std::cos; using std::sqrt;
+		detail::for_each_unit_pair<T>(rng, out.size(), [&](size_t i, T u, T v) {
+			const auto r = s.radius * sqrt(u);
+			const auto t = v * glm::two_pi<T>();
+			out[i] = s.center + glm::tvec2<T>{ r * cos(t), r * sin(t) };
+		});
+	}
+
+	/// Uses rejection sampling inside the bounding box of the shape, so the shape must have a non-zero area
+	template <shape SHAPE, typename RNG, std::floating_point T>
+	void random_points(SHAPE const& s, RNG&& rng, std::span<glm::tvec2<T>> out)
+	{
+		AssumingGreater(s.calculate_area(), 0);
+		const trec2<T> box = s.bounding_box();
+		size_t filled = 0;
+		while (filled < out.size())
+		{
+			const auto rest = out.subspan(filled);
+			random_points(box, rng, rest);
+			for (auto const& point : rest)
+			{
+				if (s.contains(point))
+					out[filled++] = point;
+			}
+		}
+	}
+
+	/// Function: poisson_disk_points
+	/// Appends to `out` points inside the shape that are at least `min_distance` apart from each other, and cover the shape
+	/// (there is no empty space where another point could fit, with high probability), using Bridson's algorithm.
+	/// `attempts` is the number of candidates tried around each point before giving up on it.
+	/// Returns: The number of points added
+	template <shape SHAPE, typename RNG>
+	size_t poisson_disk_points(SHAPE const& s, float min_distance, RNG&& rng, std::vector<vec2>& out, int attempts = 30)
+	{
+		AssumingGreater(min_distance, 0.0f);
+
+		const rec2 box = s.bounding_box();
+		const auto cell_size = min_distance / std::numbers::sqrt2_v<float>;
+		const ivec2 grid_size = glm::max(ivec2(glm::ceil(box.size() / cell_size)), ivec2{ 1, 1 });
+		const auto min_distance_squared = min_distance * min_distance;
+
+		/// Each cell can contain at most one point, so a cell just stores its index in `out`
+		std::vector<uint32_t> grid(size_t(grid_size.x) * size_t(grid_size.y), ~uint32_t{});
+		std::vector<uint32_t> active;
+
+		const auto first_index = out.size();
+		const auto cell_of = [&](vec2 point) {
+			return glm::clamp(ivec2(glm::floor((point - box.p1) / cell_size)), ivec2{ 0, 0 }, grid_size - 1);
+		};
+		const auto add_point = [&](vec2 point) {
+			const auto cell = cell_of(point);
+			grid[size_t(cell.y) * grid_size.x + cell.x] = uint32_t(out.size());
+			active.push_back(uint32_t(out.size()));
+			out.push_back(point);
+		};
+		const auto fits = [&](vec2 point) {
+			if (!box.contains(point) || !s.contains(point))
+				return false;
+			const auto cell = cell_of(point);
+			const auto from = glm::max(cell - 2, ivec2{ 0, 0 }), to = glm::min(cell + 2, grid_size - 1);
+			for (int y = from.y; y <= to.y; ++y)
+			{
+				for (int x = from.x; x <= to.x; ++x)
+				{
+					const auto other = grid[size_t(y) * grid_size.x + x];
+					if (other == ~uint32_t{})
+						continue;
+					const auto d = out[other] - point;
+					if (glm::dot(d, d) < min_distance_squared)
+						return false;
+				}
+			}
+			return true;
+		};
+
+		vec2 seed{};
+		random_points(s, rng, std::span{ &seed, 1 });
+		add_point(seed);
+
+		while (!active.empty())
+		{
+			const auto active_index = size_t(((random::Bits(rng) >> 32) * active.size()) >> 32);
+			const auto center = out[active[active_index]];
+
+			bool found = false;
+			for (int attempt = 0; attempt < attempts && !found; ++attempt)
+			{
+				/// Uniform over the area of the annulus between `min_distance` and twice that
+				const auto bits = random::Bits(rng);
+				const auto r = min_distance * std::sqrt(1.0f + 3.0f * random::UnitReal<float>(bits));
+				const auto t = random::UnitReal<float>(bits << 32) * glm::two_pi<float>();
+				const auto candidate = center + vec2{ r * std::cos(t), r * std::sin(t) };
+				if (fits(candidate))
+				{
+					add_point(candidate);
+					found = true;
+				}
+			}
+
+			if (!found)
+			{
+				active[active_index] = active.back();
+				active.pop_back();
+			}
+		}
+
+		return out.size() - first_index;
+	}
+}
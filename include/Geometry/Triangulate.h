@@ -1 +1,688 @@
 #pragma once
+
+#include "Polygon.h"
+#include <span>
+#include <memory_resource>
+#include <algorithm>
+#include <limits>
+
+/// Ear clipping is based on the algorithm from https://github.com/mapbox/earcut (ISC license),
+/// convex decomposition is the Hertel-Mehlhorn algorithm run over the resulting triangulation.
+///
+/// Neither function allocates from the global heap (unless you let them use the default memory resource);
+/// all scratch memory comes from the `arena` memory resource you provide (eg. a `std::pmr::monotonic_buffer_resource`
+/// over a reusable buffer), and the results are written to the spans you provide.
+
+namespace gamelib
+{
+	/// Function: max_triangulation_indices
+	/// Returns the size of the index buffer required to triangulate a polygon with `vertex_count` vertices (including hole vertices) and `hole_count` holes
+	constexpr size_t max_triangulation_indices(size_t vertex_count, size_t hole_count) noexcept
+	{
+		return vertex_count + 2 * hole_count < 3 ? 0 : (vertex_count + 2 * hole_count - 2) * 3;
+	}
+
+	namespace detail::triangulation
+	{
+		template <typename T>
+		struct node
+		{
+			uint32_t i = 0;
+			T x{};
+			T y{};
+			node* prev = nullptr;
+			node* next = nullptr;
+			int32_t z = 0;
+			node* prev_z = nullptr;
+			node* next_z = nullptr;
+			bool steiner = false;
+		};
+
+		template <typename T>
+		struct context
+		{
+			std::pmr::polymorphic_allocator<> alloc;
+			std::span<uint32_t> out;
+			size_t written = 0;
+			T min_x{}, min_y{}, inv_size{};
+
+			void emit(uint32_t a, uint32_t b, uint32_t c)
+			{
+				if (written + 3 > out.size()) return;
+				out[written++] = a;
+				out[written++] = b;
+				out[written++] = c;
+			}
+
+			node<T>* insert_node(uint32_t i, T x, T y, node<T>* last)
+			{
+				auto p = alloc.new_object<node<T>>(node<T>{ .i = i, .x = x, .y = y });
+				if (!last)
+				{
+					p->prev = p;
+					p->next = p;
+				}
+				else
+				{
+					p->next = last->next;
+					p->prev = last;
+					last->next->prev = p;
+					last->next = p;
+				}
+				return p;
+			}
+
+			node<T>* linked_list(std::span<glm::tvec2<T> const> vertices, uint32_t start, uint32_t end, bool clockwise)
+			{
+				node<T>* last = nullptr;
+				if (clockwise == (signed_area(vertices, start, end) > 0))
+				{
+					for (auto i = start; i < end; ++i)
+						last = insert_node(i, vertices[i].x, vertices[i].y, last);
+				}
+				else
+				{
+					for (auto i = end; i-- > start;)
+						last = insert_node(i, vertices[i].x, vertices[i].y, last);
+				}
+
+				if (last && equals(last, last->next))
+				{
+					remove_node(last);
+					last = last->next;
+				}
+				return last;
+			}
+
+			node<T>* split_polygon(node<T>* a, node<T>* b)
+			{
+				auto a2 = alloc.new_object<node<T>>(node<T>{ .i = a->i, .x = a->x, .y = a->y });
+				auto b2 = alloc.new_object<node<T>>(node<T>{ .i = b->i, .x = b->x, .y = b->y });
+				auto an = a->next;
+				auto bp = b->prev;
+
+				a->next = b;
+				b->prev = a;
+
+				a2->next = an;
+				an->prev = a2;
+
+				b2->next = a2;
+				a2->prev = b2;
+
+				bp->next = b2;
+				b2->prev = bp;
+
+				return b2;
+			}
+
+			static T signed_area(std::span<glm::tvec2<T> const> vertices, uint32_t start, uint32_t end)
+			{
+				T sum{};
+				for (uint32_t i = start, j = end - 1; i < end; j = i++)
+					sum += (vertices[j].x - vertices[i].x) * (vertices[i].y + vertices[j].y);
+				return sum;
+			}
+
+			static T area(node<T> const* p, node<T> const* q, node<T> const* r) { return (q->y - p->y) * (r->x - q->x) - (q->x - p->x) * (r->y - q->y); }
+			static bool equals(node<T> const* a, node<T> const* b) { return a->x == b->x && a->y == b->y; }
+			static int sign(T v) { return (v > T{}) - (v < T{}); }
+
+			static bool point_in_triangle(T ax, T ay, T bx, T by, T cx, T cy, T px, T py)
+			{
+				return (cx - px) * (ay - py) >= (ax - px) * (cy - py) &&
+					(ax - px) * (by - py) >= (bx - px) * (ay - py) &&
+					(bx - px) * (cy - py) >= (cx - px) * (by - py);
+			}
+
+			static bool on_segment(node<T> const* p, node<T> const* q, node<T> const* r)
+			{
+				return q->x <= std::max(p->x, r->x) && q->x >= std::min(p->x, r->x) && q->y <= std::max(p->y, r->y) && q->y >= std::min(p->y, r->y);
+			}
+
+			static bool intersects(node<T> const* p1, node<T> const* q1, node<T> const* p2, node<T> const* q2)
+			{
+				const auto o1 = sign(area(p1, q1, p2));
+				const auto o2 = sign(area(p1, q1, q2));
+				const auto o3 = sign(area(p2, q2, p1));
+				const auto o4 = sign(area(p2, q2, q1));
+				if (o1 != o2 && o3 != o4) return true;
+				if (o1 == 0 && on_segment(p1, p2, q1)) return true;
+				if (o2 == 0 && on_segment(p1, q2, q1)) return true;
+				if (o3 == 0 && on_segment(p2, p1, q2)) return true;
+				if (o4 == 0 && on_segment(p2, q1, q2)) return true;
+				return false;
+			}
+
+			static bool intersects_polygon(node<T> const* a, node<T> const* b)
+			{
+				auto p = a;
+				do
+				{
+					if (p->i != a->i && p->next->i != a->i && p->i != b->i && p->next->i != b->i && intersects(p, p->next, a, b))
+						return true;
+					p = p->next;
+				} while (p != a);
+				return false;
+			}
+
+			static bool locally_inside(node<T> const* a, node<T> const* b)
+			{
+				return area(a->prev, a, a->next) < 0 ?
+					area(a, b, a->next) >= 0 && area(a, a->prev, b) >= 0 :
+					area(a, b, a->prev) < 0 || area(a, a->next, b) < 0;
+			}
+
+			static bool middle_inside(node<T> const* a, node<T> const* b)
+			{
+				auto p = a;
+				bool inside = false;
+				const auto px = (a->x + b->x) / 2;
+				const auto py = (a->y + b->y) / 2;
+				do
+				{
+					if (((p->y > py) != (p->next->y > py)) && p->next->y != p->y && (px < (p->next->x - p->x) * (py - p->y) / (p->next->y - p->y) + p->x))
+						inside = !inside;
+					p = p->next;
+				} while (p != a);
+				return inside;
+			}
+
+			static bool is_valid_diagonal(node<T> const* a, node<T> const* b)
+			{
+				return a->next->i != b->i && a->prev->i != b->i && !intersects_polygon(a, b) &&
+					((locally_inside(a, b) && locally_inside(b, a) && middle_inside(a, b) && (area(a->prev, a, b->prev) != 0 || area(a, b->prev, b) != 0)) ||
+					(equals(a, b) && area(a->prev, a, a->next) > 0 && area(b->prev, b, b->next) > 0));
+			}
+
+			static bool sector_contains_sector(node<T> const* m, node<T> const* p)
+			{
+				return area(m->prev, m, p->prev) < 0 && area(p->next, m, m->next) < 0;
+			}
+
+			static void remove_node(node<T>* p)
+			{
+				p->next->prev = p->prev;
+				p->prev->next = p->next;
+				if (p->prev_z) p->prev_z->next_z = p->next_z;
+				if (p->next_z) p->next_z->prev_z = p->prev_z;
+			}
+
+			static node<T>* filter_points(node<T>* start, node<T>* end = nullptr)
+			{
+				if (!start) return start;
+				if (!end) end = start;
+
+				auto p = start;
+				bool again = false;
+				do
+				{
+					again = false;
+					if (!p->steiner && (equals(p, p->next) || area(p->prev, p, p->next) == 0))
+					{
+						remove_node(p);
+						p = end = p->prev;
+						if (p == p->next) break;
+						again = true;
+					}
+					else
+						p = p->next;
+				} while (again || p != end);
+
+				return end;
+			}
+
+			static node<T>* get_leftmost(node<T>* start)
+			{
+				auto p = start, leftmost = start;
+				do
+				{
+					if (p->x < leftmost->x || (p->x == leftmost->x && p->y < leftmost->y))
+						leftmost = p;
+					p = p->next;
+				} while (p != start);
+				return leftmost;
+			}
+
+			int32_t z_order(T x, T y) const
+			{
+				auto ix = uint32_t(int32_t((x - min_x) * inv_size));
+				auto iy = uint32_t(int32_t((y - min_y) * inv_size));
+
+				ix = (ix | (ix << 8)) & 0x00FF00FF;
+				ix = (ix | (ix << 4)) & 0x0F0F0F0F;
+				ix = (ix | (ix << 2)) & 0x33333333;
+				ix = (ix | (ix << 1)) & 0x55555555;
+
+				iy = (iy | (iy << 8)) & 0x00FF00FF;
+				iy = (iy | (iy << 4)) & 0x0F0F0F0F;
+				iy = (iy | (iy << 2)) & 0x33333333;
+				iy = (iy | (iy << 1)) & 0x55555555;
+
+				return int32_t(ix | (iy << 1));
+			}
+
+			void index_curve(node<T>* start)
+			{
+				std::pmr::vector<node<T>*> sorted{ alloc };
+				auto p = start;
+				do
+				{
+					if (p->z == 0)
+						p->z = z_order(p->x, p->y);
+					sorted.push_back(p);
+					p = p->next;
+				} while (p != start);
+
+				std::stable_sort(sorted.begin(), sorted.end(), [](node<T> const* a, node<T> const* b) { return a->z < b->z; });
+
+				for (size_t i = 0; i < sorted.size(); ++i)
+				{
+					sorted[i]->prev_z = i > 0 ? sorted[i - 1] : nullptr;
+					sorted[i]->next_z = i + 1 < sorted.size() ? sorted[i + 1] : nullptr;
+				}
+			}
+
+			static bool blocks_ear(node<T> const* p, node<T> const* a, node<T> const* b, node<T> const* c, T x0, T y0, T x1, T y1)
+			{
+				return p->x >= x0 && p->x <= x1 && p->y >= y0 && p->y <= y1 && p != a && p != c &&
+					point_in_triangle(a->x, a->y, b->x, b->y, c->x, c->y, p->x, p->y) && area(p->prev, p, p->next) >= 0;
+			}
+
+			static bool is_ear(node<T> const* ear)
+			{
+				const auto a = ear->prev, b = ear, c = ear->next;
+				if (area(a, b, c) >= 0) return false; /// reflex, can't be an ear
+
+				const auto x0 = std::min({ a->x, b->x, c->x }), y0 = std::min({ a->y, b->y, c->y });
+				const auto x1 = std::max({ a->x, b->x, c->x }), y1 = std::max({ a->y, b->y, c->y });
+
+				for (auto p = c->next; p != a; p = p->next)
+					if (blocks_ear(p, a, b, c, x0, y0, x1, y1))
+						return false;
+				return true;
+			}
+
+			bool is_ear_hashed(node<T> const* ear) const
+			{
+				const auto a = ear->prev, b = ear, c = ear->next;
+				if (area(a, b, c) >= 0) return false;
+
+				const auto x0 = std::min({ a->x, b->x, c->x }), y0 = std::min({ a->y, b->y, c->y });
+				const auto x1 = std::max({ a->x, b->x, c->x }), y1 = std::max({ a->y, b->y, c->y });
+
+				const auto min_z = z_order(x0, y0);
+				const auto max_z = z_order(x1, y1);
+
+				auto p = ear->prev_z;
+				auto n = ear->next_z;
+
+				/// Look for points inside the triangle in both directions
+				while (p && p->z >= min_z && n && n->z <= max_z)
+				{
+					if (blocks_ear(p, a, b, c, x0, y0, x1, y1)) return false;
+					p = p->prev_z;
+					if (blocks_ear(n, a, b, c, x0, y0, x1, y1)) return false;
+					n = n->next_z;
+				}
+
+				/// Look for remaining points in decreasing z-order
+				for (; p && p->z >= min_z; p = p->prev_z)
+					if (blocks_ear(p, a, b, c, x0, y0, x1, y1)) return false;
+
+				/// Look for remaining points in increasing z-order
+				for (; n && n->z <= max_z; n = n->next_z)
+					if (blocks_ear(n, a, b, c, x0, y0, x1, y1)) return false;
+
+				return true;
+			}
+
+			node<T>* cure_local_intersections(node<T>* start)
+			{
+				auto p = start;
+				do
+				{
+					auto a = p->prev, b = p->next->next;
+					if (!equals(a, b) && intersects(a, p, p->next, b) && locally_inside(a, b) && locally_inside(b, a))
+					{
+						emit(a->i, p->i, b->i);
+						remove_node(p);
+						remove_node(p->next);
+						p = start = b;
+					}
+					p = p->next;
+				} while (p != start);
+
+				return filter_points(p);
+			}
+
+			void split_earcut(node<T>* start)
+			{
+				auto a = start;
+				do
+				{
+					for (auto b = a->next->next; b != a->prev; b = b->next)
+					{
+						if (a->i != b->i && is_valid_diagonal(a, b))
+						{
+							auto c = split_polygon(a, b);
+							a = filter_points(a, a->next);
+							c = filter_points(c, c->next);
+							earcut_linked(a, 0);
+							earcut_linked(c, 0);
+							return;
+						}
+					}
+					a = a->next;
+				} while (a != start);
+			}
+
+			void earcut_linked(node<T>* ear, int pass)
+			{
+				if (!ear) return;
+
+				if (!pass && inv_size != T{})
+					index_curve(ear);
+
+				auto stop = ear;
+				while (ear->prev != ear->next)
+				{
+					auto prev = ear->prev;
+					auto next = ear->next;
+
+					if (inv_size != T{} ? is_ear_hashed(ear) : is_ear(ear))
+					{
+						emit(prev->i, ear->i, next->i);
+						remove_node(ear);
+
+						/// Skipping the next vertex leads to less sliver triangles
+						ear = next->next;
+						stop = next->next;
+						continue;
+					}
+
+					ear = next;
+
+					/// If we looped through the whole remaining polygon and can't find any more ears
+					if (ear == stop)
+					{
+						if (pass == 0)
+							earcut_linked(filter_points(ear), 1);
+						else if (pass == 1)
+							earcut_linked(cure_local_intersections(filter_points(ear)), 2);
+						else
+							split_earcut(ear);
+						break;
+					}
+				}
+			}
+
+			node<T>* find_hole_bridge(node<T>* hole, node<T>* outer_node)
+			{
+				auto p = outer_node;
+				const auto hx = hole->x;
+				const auto hy = hole->y;
+				auto qx = -std::numeric_limits<T>::infinity();
+				node<T>* m = nullptr;
+
+				/// Find a segment intersected by a ray from the hole's leftmost point to the left;
+				/// segment's endpoint with lesser x will be potential connection point
+				do
+				{
+					if (hy <= p->y && hy >= p->next->y && p->next->y != p->y)
+					{
+						const auto x = p->x + (hy - p->y) * (p->next->x - p->x) / (p->next->y - p->y);
+						if (x <= hx && x > qx)
+						{
+							qx = x;
+							m = p->x < p->next->x ? p : p->next;
+							if (x == hx) return m; /// hole touches outer segment; pick leftmost endpoint
+						}
+					}
+					p = p->next;
+				} while (p != outer_node);
+
+				if (!m) return nullptr;
+
+				/// Look for points inside the triangle of hole point, segment intersection and endpoint;
+				/// if there are no points found, we have a valid connection;
+				/// otherwise choose the point of the minimum angle with the ray as connection point
+				const auto stop = m;
+				const auto mx = m->x;
+				const auto my = m->y;
+				auto tan_min = std::numeric_limits<T>::infinity();
+
+				p = m;
+				do
+				{
+					if (hx >= p->x && p->x >= mx && hx != p->x &&
+						point_in_triangle(hy < my ? hx : qx, hy, mx, my, hy < my ? qx : hx, hy, p->x, p->y))
+					{
+						const auto tan = std::abs(hy - p->y) / (hx - p->x);
+						if (locally_inside(p, hole) &&
+							(tan < tan_min || (tan == tan_min && (p->x > m->x || (p->x == m->x && sector_contains_sector(m, p))))))
+						{
+							m = p;
+							tan_min = tan;
+						}
+					}
+					p = p->next;
+				} while (p != stop);
+
+				return m;
+			}
+
+			node<T>* eliminate_holes(std::span<glm::tvec2<T> const> vertices, std::span<uint32_t const> hole_starts, node<T>* outer_node)
+			{
+				std::pmr::vector<node<T>*> queue{ alloc };
+				queue.reserve(hole_starts.size());
+				for (size_t i = 0; i < hole_starts.size(); ++i)
+				{
+					const auto start = hole_starts[i];
+					const auto end = i + 1 < hole_starts.size() ? hole_starts[i + 1] : (uint32_t)vertices.size();
+					auto list = linked_list(vertices, start, end, false);
+					if (!list) continue;
+					if (list == list->next) list->steiner = true;
+					queue.push_back(get_leftmost(list));
+				}
+
+				std::sort(queue.begin(), queue.end(), [](node<T> const* a, node<T> const* b) { return a->x < b->x; });
+
+				/// Process holes from left to right
+				for (auto hole : queue)
+				{
+					if (auto bridge = find_hole_bridge(hole, outer_node))
+					{
+						auto bridge_reverse = split_polygon(bridge, hole);
+						filter_points(bridge_reverse, bridge_reverse->next);
+						outer_node = filter_points(bridge, bridge->next);
+					}
+				}
+
+				return outer_node;
+			}
+		};
+	}
+
+	/// Function: triangulate
+	/// Triangulates a polygon given as a list of `vertices`, where the holes start at the vertex indices given by `hole_starts`
+	/// (the outer ring goes from vertex 0 to `hole_starts[0]`).
+	/// Writes triples of vertex indices to `out_indices` (see <max_triangulation_indices> for the required size).
+	/// Returns: the number of indices written
+	template <std::floating_point T>
+	size_t triangulate(std::span<glm::tvec2<T> const> vertices, std::span<uint32_t const> hole_starts, std::span<uint32_t> out_indices, std::pmr::memory_resource* arena = std::pmr::get_default_resource())
+	{
+		using namespace detail::triangulation;
+
+		context<T> ctx{ .alloc = arena, .out = out_indices };
+
+		const auto outer_end = hole_starts.empty() ? (uint32_t)vertices.size() : hole_starts[0];
+		auto outer_node = ctx.linked_list(vertices, 0, outer_end, true);
+		if (!outer_node || outer_node->next == outer_node->prev)
+			return 0;
+
+		if (!hole_starts.empty())
+			outer_node = ctx.eliminate_holes(vertices, hole_starts, outer_node);
+
+		/// If the shape is not too simple, we'll use z-order curve hash later; calculate polygon bbox
+		if (vertices.size() > 80)
+		{
+			auto min = vertices[0], max = vertices[0];
+			for (auto const& v : vertices.subspan(0, outer_end))
+			{
+				min = glm::min(min, v);
+				max = glm::max(max, v);
+			}
+			ctx.min_x = min.x;
+			ctx.min_y = min.y;
+			const auto size = std::max(max.x - min.x, max.y - min.y);
+			ctx.inv_size = size != T{} ? T(32767) / size : T{};
+		}
+
+		ctx.earcut_linked(outer_node, 0);
+
+		return ctx.written;
+	}
+
+	template <std::floating_point T>
+	size_t triangulate(std::span<glm::tvec2<T> const> vertices, std::span<uint32_t> out_indices, std::pmr::memory_resource* arena = std::pmr::get_default_resource())
+	{
+		return triangulate(vertices, std::span<uint32_t const>{}, out_indices, arena);
+	}
+
+	template <std::floating_point T>
+	size_t triangulate(glm::tpolygon2<T> const& polygon, std::span<uint32_t> out_indices, std::pmr::memory_resource* arena = std::pmr::get_default_resource())
+	{
+		return triangulate(std::span<glm::tvec2<T> const>{ polygon.vertices }, std::span<uint32_t const>{}, out_indices, arena);
+	}
+
+	/// Function: decompose_convex
+	/// Merges the triangles given by `triangle_indices` (eg. the output of <triangulate>) into convex polygons, using the Hertel-Mehlhorn algorithm.
+	/// The vertex indices of the polygons (counter-clockwise in a y-up coordinate system) are written to `out_indices`, which needs to be at least
+	/// as large as `triangle_indices`. Polygon `n` spans `out_indices[out_polygon_starts[n]]` to `out_indices[out_polygon_starts[n + 1]]`,
+	/// so `out_polygon_starts` needs space for (triangle count + 1) elements.
+	/// Returns: the number of polygons written
+	template <std::floating_point T>
+	size_t decompose_convex(std::span<glm::tvec2<T> const> vertices, std::span<uint32_t const> triangle_indices, std::span<uint32_t> out_indices, std::span<uint32_t> out_polygon_starts, std::pmr::memory_resource* arena = std::pmr::get_default_resource())
+	{
+		const auto triangle_count = triangle_indices.size() / 3;
+		if (triangle_count == 0 || out_polygon_starts.empty())
+			return 0;
+
+		struct corner
+		{
+			uint32_t vertex;
+			uint32_t next;
+			uint32_t prev;
+			uint32_t polygon;
+			bool alive;
+		};
+
+		struct edge
+		{
+			uint32_t a, b;
+			uint32_t corner;
+		};
+
+		std::pmr::polymorphic_allocator<> alloc{ arena };
+		std::pmr::vector<corner> corners{ triangle_count * 3, alloc };
+		std::pmr::vector<uint32_t> polygon_parent{ triangle_count, alloc };
+		std::pmr::vector<edge> edges{ alloc };
+		edges.reserve(triangle_count * 3);
+
+		const auto cross = [&](uint32_t a, uint32_t b, uint32_t c) {
+			const auto ab = vertices[b] - vertices[a];
+			const auto bc = vertices[c] - vertices[b];
+			return ab.x * bc.y - ab.y * bc.x;
+		};
+
+		/// Build counter-clockwise triangle loops
+		for (uint32_t t = 0; t < triangle_count; ++t)
+		{
+			uint32_t v[3] = { triangle_indices[t * 3 + 0], triangle_indices[t * 3 + 1], triangle_indices[t * 3 + 2] };
+			if (cross(v[0], v[1], v[2]) < 0)
+				std::swap(v[1], v[2]);
+
+			polygon_parent[t] = t;
+			for (uint32_t k = 0; k < 3; ++k)
+			{
+				const auto c = t * 3 + k;
+				corners[c] = { v[k], t * 3 + (k + 1) % 3, t * 3 + (k + 2) % 3, t, true };
+				edges.push_back({ std::min(v[k], v[(k + 1) % 3]), std::max(v[k], v[(k + 1) % 3]), c });
+			}
+		}
+
+		/// Interior edges (diagonals) are the ones shared by two triangles
+		std::sort(edges.begin(), edges.end(), [](edge const& e1, edge const& e2) { return e1.a != e2.a ? e1.a < e2.a : e1.b < e2.b; });
+
+		const auto find = [&](uint32_t p) {
+			while (polygon_parent[p] != p)
+				p = polygon_parent[p] = polygon_parent[polygon_parent[p]];
+			return p;
+		};
+
+		for (size_t e = 0; e + 1 < edges.size(); ++e)
+		{
+			if (edges[e].a != edges[e + 1].a || edges[e].b != edges[e + 1].b)
+				continue;
+
+			/// `p` goes a->b in one polygon, `q` goes b->a in the other
+			const auto p = edges[e].corner;
+			const auto q = edges[e + 1].corner;
+			++e;
+
+			const auto poly_p = find(corners[p].polygon);
+			const auto poly_q = find(corners[q].polygon);
+			if (poly_p == poly_q)
+				continue;
+
+			const auto pn = corners[p].next;
+			const auto qn = corners[q].next;
+			if (corners[pn].vertex != corners[q].vertex || corners[qn].vertex != corners[p].vertex)
+				continue;
+
+			/// Removing the diagonal must keep both of its endpoints convex
+			const auto a = corners[p].vertex;
+			const auto b = corners[q].vertex;
+			if (cross(corners[corners[p].prev].vertex, a, corners[corners[qn].next].vertex) < 0)
+				continue;
+			if (cross(corners[corners[q].prev].vertex, b, corners[corners[pn].next].vertex) < 0)
+				continue;
+
+			/// Splice: keep `qn` as the `a` corner and `pn` as the `b` corner, drop `p` and `q`
+			corners[corners[p].prev].next = qn;
+			corners[qn].prev = corners[p].prev;
+			corners[corners[q].prev].next = pn;
+			corners[pn].prev = corners[q].prev;
+			corners[p].alive = false;
+			corners[q].alive = false;
+
+			polygon_parent[poly_q] = poly_p;
+		}
+
+		/// Gather the resulting loops
+		size_t written = 0;
+		size_t polygon_count = 0;
+		std::pmr::vector<bool> visited{ corners.size(), false, alloc };
+		for (uint32_t c = 0; c < corners.size(); ++c)
+		{
+			if (!corners[c].alive || visited[c])
+				continue;
+			if (polygon_count + 1 >= out_polygon_starts.size())
+				break;
+
+			out_polygon_starts[polygon_count++] = (uint32_t)written;
+			auto it = c;
+			do
+			{
+				visited[it] = true;
+				if (written < out_indices.size())
+					out_indices[written++] = corners[it].vertex;
+				it = corners[it].next;
+			} while (it != c);
+		}
+		out_polygon_starts[polygon_count] = (uint32_t)written;
+
+		return polygon_count;
+	}
+}
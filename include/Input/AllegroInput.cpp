@@ -553,6 +553,7 @@ namespace gamelib
 		case ALLEGRO_EVENT_KEY_DOWN:
 			static_cast<AllegroKeyboard*>(Keyboard())->KeyPressed(event.keyboard.keycode);
 			SetLastActiveDevice(Keyboard(), event.any.timestamp);
+			QueueInputEvent(Keyboard(), event.keyboard.keycode, true, event.any.timestamp);
 			break;
 		case ALLEGRO_EVENT_KEY_CHAR:
 			SetLastActiveDevice(Keyboard(), event.any.timestamp);
@@ -560,6 +561,7 @@ namespace gamelib
 		case ALLEGRO_EVENT_KEY_UP:
 			static_cast<AllegroKeyboard*>(Keyboard())->KeyReleased(event.keyboard.keycode);
 			SetLastActiveDevice(Keyboard(), event.any.timestamp);
+			QueueInputEvent(Keyboard(), event.keyboard.keycode, false, event.any.timestamp);
 			break;
 		case ALLEGRO_EVENT_MOUSE_AXES:
 			static_cast<AllegroMouse*>(Mouse())->MouseWheelScrolled(event.mouse.dz, event.mouse.dw);
@@ -569,10 +571,12 @@ namespace gamelib
 		case ALLEGRO_EVENT_MOUSE_BUTTON_DOWN:
 			static_cast<AllegroMouse*>(Mouse())->MouseButtonPressed(MouseButton(event.mouse.button - 1));
 			SetLastActiveDevice(Mouse(), event.any.timestamp);
+			QueueInputEvent(Mouse(), event.mouse.button - 1, true, event.any.timestamp);
 			break;
 		case ALLEGRO_EVENT_MOUSE_BUTTON_UP:
 			static_cast<AllegroMouse*>(Mouse())->MouseButtonReleased(MouseButton(event.mouse.button - 1));
 			SetLastActiveDevice(Mouse(), event.any.timestamp);
+			QueueInputEvent(Mouse(), event.mouse.button - 1, false, event.any.timestamp);
 			break;
 		case ALLEGRO_EVENT_MOUSE_ENTER_DISPLAY:
 			static_cast<AllegroMouse*>(Mouse())->MouseEntered();
@@ -592,11 +596,13 @@ namespace gamelib
 			Assuming(mJoystickMap.contains(event.joystick.id));
 			SetLastActiveDevice(mJoystickMap[event.joystick.id], event.any.timestamp);
 			dynamic_cast<AllegroGamepad*>(mLastActiveDevice)->CurrentState.Button[event.joystick.button] = 1;
+			QueueInputEvent(mLastActiveDevice, event.joystick.button, true, event.any.timestamp);
 			break;
 		case ALLEGRO_EVENT_JOYSTICK_BUTTON_UP:
 			Assuming(mJoystickMap.contains(event.joystick.id));
 			SetLastActiveDevice(mJoystickMap[event.joystick.id], event.any.timestamp);
 			dynamic_cast<AllegroGamepad*>(mLastActiveDevice)->CurrentState.Button[event.joystick.button] = 0;
+			QueueInputEvent(mLastActiveDevice, event.joystick.button, false, event.any.timestamp);
 			break;
 		case ALLEGRO_EVENT_JOYSTICK_CONFIGURATION:
 			RefreshJoysticks();
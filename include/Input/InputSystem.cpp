@@ -17,6 +17,12 @@ namespace gamelib
 		mLastActiveDevice = device;
 	}
 
+	void IInputSystem::QueueInputEvent(IInputDevice* device, DeviceInputID input, bool pressed, seconds_t time)
+	{
+		if (DeviceInputEvents.Listeners)
+			DeviceInputEvents.Queue({ device, input, pressed, time });
+	}
+
 	void IInputSystem::Init()
 	{
 		SetLastActiveDevice(Keyboard(), 0);
@@ -24,6 +30,7 @@ namespace gamelib
 
 	void IInputSystem::Update()
 	{
+		DispatchEvents();
 		for (auto& device : mInputDevices)
 		{
 			if (device) device->NewFrame();
@@ -7,6 +7,7 @@
 
 #include "InputDevice.h"
 #include "../ErrorReporter.h"
+#include "../../Signals.h"
 
 union ALLEGRO_EVENT;
 
@@ -161,6 +162,21 @@ namespace gamelib
 
 		IInputDevice* LastDeviceActive() const { return mLastActiveDevice; }
 
+		/// A physical button of a device was pressed or released
+		struct DeviceInputEvent
+		{
+			IInputDevice* Device = nullptr;
+			DeviceInputID Input = InvalidDeviceInputID;
+			bool Pressed = false;
+			seconds_t Time{};
+		};
+
+		/// Button events processed since the last dispatch; listeners receive all of them at once
+		BatchedSignal<DeviceInputEvent> DeviceInputEvents;
+
+		/// Called by `Update`
+		void DispatchEvents() { DeviceInputEvents.Dispatch(); }
+
 		std::string ButtonNamesForInput(Input input, std::string_view button_format);
 		std::string ButtonNameForInput(Input input, std::string_view button_format);
 
@@ -184,6 +200,7 @@ namespace gamelib
 
 		IInputDevice* mLastActiveDevice = nullptr;
 		void SetLastActiveDevice(IInputDevice* device, seconds_t current_time);
+		void QueueInputEvent(IInputDevice* device, DeviceInputID input, bool pressed, seconds_t time);
 
 		std::vector<std::unique_ptr<IInputDevice>> mInputDevices;
 		std::map<void*, IGamepadDevice*> mJoystickMap;
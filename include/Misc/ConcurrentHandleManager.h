@@ -0,0 +1,168 @@
+#pragma once
+
+#include "HandleManager.h"
+#include <atomic>
+#include <array>
+#include <bit>
+
+namespace gamelib
+{
+	/// A `HandleManager` that any number of threads can create and free handles in without locking.
+	/// Free entries form a lock-free stack whose head is tagged with a counter, so a head that was popped and pushed back
+	/// in the meantime (the ABA problem) is not mistaken for an unchanged one.
+	/// Entries live in segments of doubling size that are never moved or freed while the manager lives, so `IsValid` is wait-free.
+	/// Unlike `HandleManager`, freed entries are reused last-in, first-out.
+	template <typename HANDLE = Handle>
+	class BasicConcurrentHandleManager
+	{
+	public:
+
+		using handle_type = HANDLE;
+
+		static_assert(HANDLE::INDEX_BITS <= 32, "the free list is indexed with 32 bits");
+
+		/// The last 32-bit index is reserved to mark the end of the free list
+		static constexpr uint32_t MaxHandles = uint32_t(std::min<uint64_t>(uint64_t(HANDLE::MAX_INDEX) + 1, ~uint32_t{}));
+
+		BasicConcurrentHandleManager() = default;
+		~BasicConcurrentHandleManager() { Clear(); }
+
+		BasicConcurrentHandleManager(BasicConcurrentHandleManager const&) = delete;
+		BasicConcurrentHandleManager& operator=(BasicConcurrentHandleManager const&) = delete;
+
+		HANDLE CreateHandle()
+		{
+			const auto index = PopFree();
+			auto& entry = EntryAt(index);
+
+			/// Counter 0 is skipped, so `Handle{ 0, 0 }` is never valid
+			const auto previous = entry.State.load(std::memory_order_relaxed) >> 1;
+			const auto counter = previous == HANDLE::MAX_COUNTER ? 1 : previous + 1;
+			entry.State.store(counter << 1 | 1, std::memory_order_release);
+			return HANDLE(index, typename HANDLE::storage_type(counter));
+		}
+
+		/// Returns false if the handle was not valid (eg. it was already freed)
+		bool FreeHandle(HANDLE h)
+		{
+			if (!h.IsValid())
+				return false;
+			const auto entry = FindEntry(h.Index);
+			if (!entry)
+				return false;
+
+			auto used = state_type(h.Counter) << 1 | 1;
+			if (!entry->State.compare_exchange_strong(used, used & ~state_type{ 1 }, std::memory_order_acq_rel))
+				return false;
+
+			PushFree(h.Index);
+			return true;
+		}
+
+		bool IsValid(HANDLE h) const noexcept
+		{
+			if (!h.IsValid()) return false;
+			const auto entry = FindEntry(h.Index);
+			return entry && entry->State.load(std::memory_order_acquire) == (state_type(h.Counter) << 1 | 1);
+		}
+
+		/// Number of entries ever created (not the number of live handles)
+		uint32_t Capacity() const noexcept { return std::min(mNextUnused.load(std::memory_order_acquire), MaxHandles); }
+
+		/// Not thread-safe; invalidates all handles
+		void Clear()
+		{
+			for (auto& segment : mSegments)
+				delete[] segment.exchange(nullptr);
+			mNextUnused = 0;
+			mFreeHead = Tagged(0, None);
+		}
+
+	private:
+
+		static constexpr uint32_t None = ~uint32_t{};
+
+		/// Wide enough for the counter and the in-use bit
+		using state_type = std::conditional_t<(HANDLE::COUNTER_BITS < 32), uint32_t, uint64_t>;
+
+		/// Segment `k` holds `FirstSegmentSize << k` entries
+		static constexpr uint32_t FirstSegmentSize = 256;
+		static constexpr size_t SegmentCount = std::bit_width(MaxHandles / FirstSegmentSize + 1);
+
+		struct Entry
+		{
+			/// Counter in the upper bits, and whether the entry is in use in the lowest bit
+			std::atomic<state_type> State = 0;
+			std::atomic<uint32_t> NextFree = None;
+		};
+
+		std::array<std::atomic<Entry*>, SegmentCount> mSegments{};
+		std::atomic<uint32_t> mNextUnused = 0;
+
+		/// Index of the first free entry in the lower 32 bits, and a tag incremented on every change in the upper ones
+		std::atomic<uint64_t> mFreeHead = Tagged(0, None);
+
+		static constexpr uint64_t Tagged(uint64_t tag, uint32_t index) noexcept { return tag << 32 | index; }
+		static constexpr uint32_t IndexOf(uint64_t head) noexcept { return uint32_t(head); }
+		static constexpr uint64_t TagOf(uint64_t head) noexcept { return head >> 32; }
+
+		static std::pair<size_t, uint32_t> SegmentOf(uint32_t index) noexcept
+		{
+			const auto segment = size_t(std::bit_width(index / FirstSegmentSize + 1) - 1);
+			return { segment, index - FirstSegmentSize * ((uint32_t{ 1 } << segment) - 1) };
+		}
+
+		Entry* FindEntry(uint32_t index) const noexcept
+		{
+			const auto [segment, offset] = SegmentOf(index);
+			if (segment >= SegmentCount)
+				return nullptr;
+			const auto entries = mSegments[segment].load(std::memory_order_acquire);
+			return entries ? entries + offset : nullptr;
+		}
+
+		/// Only for indices that were handed out, so their segment exists
+		Entry& EntryAt(uint32_t index) const noexcept { return *FindEntry(index); }
+
+		uint32_t PopFree()
+		{
+			auto head = mFreeHead.load(std::memory_order_acquire);
+			while (IndexOf(head) != None)
+			{
+				/// Even if another thread pops this entry first, reading it is safe as entries are never freed; the tag makes our CAS fail then
+				const auto next = EntryAt(IndexOf(head)).NextFree.load(std::memory_order_relaxed);
+				if (mFreeHead.compare_exchange_weak(head, Tagged(TagOf(head) + 1, next), std::memory_order_acquire))
+					return IndexOf(head);
+			}
+			return AllocateEntry();
+		}
+
+		void PushFree(uint32_t index)
+		{
+			auto& entry = EntryAt(index);
+			auto head = mFreeHead.load(std::memory_order_relaxed);
+			do
+				entry.NextFree.store(IndexOf(head), std::memory_order_relaxed);
+			while (!mFreeHead.compare_exchange_weak(head, Tagged(TagOf(head) + 1, index), std::memory_order_release, std::memory_order_relaxed));
+		}
+
+		uint32_t AllocateEntry()
+		{
+			const auto index = mNextUnused.fetch_add(1, std::memory_order_relaxed);
+			AssumingLess(index, MaxHandles, "Out of handles");
+
+			const auto [segment, offset] = SegmentOf(index);
+			if (!mSegments[segment].load(std::memory_order_acquire))
+			{
+				/// Several threads may race to create the segment; only one of them wins
+				const auto entries = new Entry[size_t{ FirstSegmentSize } << segment];
+				Entry* expected = nullptr;
+				if (!mSegments[segment].compare_exchange_strong(expected, entries, std::memory_order_acq_rel))
+					delete[] entries;
+			}
+			return index;
+		}
+	};
+
+	using ConcurrentHandleManager = BasicConcurrentHandleManager<Handle>;
+}
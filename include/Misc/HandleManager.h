@@ -1,69 +1,95 @@
 #pragma once
 
 #include "../Common.h"
-#include "../Errors.h"
+#include "../Includes/Assuming.h"
+#include <vector>
 
 /// Shamelessly stolen from https://github.com/epyon/nova-ecs/blob/master/nova-ecs/handle_manager.hh
 
 namespace gamelib
 {
-	class Handle
+	/// A handle is an index into a `HandleManager`, and a counter that's incremented every time the index is reused,
+	/// so handles to freed objects can be detected. Both are packed into a single integer of the smallest fitting size.
+	template <int INDEX_BITS_, int COUNTER_BITS_>
+	class BasicHandle
 	{
 	public:
-		static constexpr int INDEX_BITS = 16;
-		static constexpr int COUNTER_BITS = 16;
+		static constexpr int INDEX_BITS = INDEX_BITS_;
+		static constexpr int COUNTER_BITS = COUNTER_BITS_;
 
-		constexpr Handle() : Index(0), Counter(0) {}
-		constexpr Handle(unsigned a_index, unsigned a_counter)
+		static_assert(INDEX_BITS > 0 && COUNTER_BITS > 0 && INDEX_BITS + COUNTER_BITS <= 64, "handle must fit in 64 bits");
+
+		using storage_type = std::conditional_t<(INDEX_BITS + COUNTER_BITS <= 32), uint32_t, uint64_t>;
+
+		static constexpr storage_type MAX_INDEX = (storage_type{ 1 } << (INDEX_BITS - 1) << 1) - 1;
+		static constexpr storage_type MAX_COUNTER = (storage_type{ 1 } << (COUNTER_BITS - 1) << 1) - 1;
+
+		constexpr BasicHandle() : Index(0), Counter(0) {}
+		constexpr BasicHandle(storage_type a_index, storage_type a_counter)
 			: Index(a_index), Counter(a_counter) {}
 
-		constexpr inline bool operator==(const Handle& rhs) const {
+		constexpr inline bool operator==(const BasicHandle& rhs) const {
 			return Index == rhs.Index && Counter == rhs.Counter;
 		}
-		constexpr inline bool operator!=(const Handle& rhs) const { return !(*this == rhs); }
+		constexpr inline bool operator!=(const BasicHandle& rhs) const { return !(*this == rhs); }
 
 		constexpr bool IsValid()    const { return !(Index == 0 && Counter == 0); }
 		constexpr operator bool()    const { return IsValid(); }
-		constexpr unsigned Hash()    const { return Counter << INDEX_BITS | Index; }
-		unsigned Index : INDEX_BITS;
-		unsigned Counter : COUNTER_BITS;
+		constexpr storage_type Hash()    const { return storage_type(Counter) << INDEX_BITS | Index; }
+		storage_type Index : INDEX_BITS;
+		storage_type Counter : COUNTER_BITS;
 	};
+
+	/// Up to 65,536 live handles, in 32 bits
+	using Handle = BasicHandle<16, 16>;
+
+	/// Up to 4 billion live handles, with counters that take as many reuses to wrap around
+	using Handle64 = BasicHandle<32, 32>;
 }
 
 namespace std
 {
-	template<> struct hash<gamelib::Handle>
+	template<int INDEX_BITS, int COUNTER_BITS> struct hash<gamelib::BasicHandle<INDEX_BITS, COUNTER_BITS>>
 	{
-		size_t operator()(const gamelib::Handle& s) const noexcept
+		size_t operator()(const gamelib::BasicHandle<INDEX_BITS, COUNTER_BITS>& s) const noexcept
 		{
-			return s.Hash();
+			return size_t(s.Hash());
 		}
 	};
 }
 
 namespace gamelib
 {
-	class HandleManager : public IErrorReportingInterface
+	/// Counters wrap around (skipping 0) when they overflow `COUNTER_BITS`, so a handle that outlived that many reuses
+	/// of its index would be seen as valid again; pick a wider handle if that's a concern.
+	template <typename HANDLE = Handle>
+	class BasicHandleManager
 	{
-		typedef int      index_type;
-		typedef unsigned value_type;
-		static const index_type NONE = index_type(-1);
-		static const index_type USED = index_type(-2);
-	
 	public:
 
-		HandleManager(IErrorReporter& error_reporter) : IErrorReportingInterface(error_reporter), mFirstFree(NONE), mLastFree(NONE) {}
+		using handle_type = HANDLE;
+		using index_type = typename HANDLE::storage_type;
+		using value_type = typename HANDLE::storage_type;
+
+	private:
+
+		static constexpr index_type NONE = index_type(-1);
+		static constexpr index_type USED = index_type(-2);
+
+	public:
+
+		BasicHandleManager() : mFirstFree(NONE), mLastFree(NONE) {}
 
-		Handle CreateHandle()
+		HANDLE CreateHandle()
 		{
 			value_type i = get_free_entry();
-			mEntries[i].Counter++;
-			AssumingNotEqual(mEntries[i].Counter, 0, "Out of handles");
-			mEntries[i].NextFree = USED;
-			return Handle(i, mEntries[i].Counter);
+			auto& entry = mEntries[i];
+			entry.Counter = entry.Counter == HANDLE::MAX_COUNTER ? 1 : entry.Counter + 1;
+			entry.NextFree = USED;
+			return HANDLE(i, entry.Counter);
 		}
 
-		void FreeHandle(Handle h)
+		void FreeHandle(HANDLE h)
 		{
 			value_type index = h.Index;
 			mEntries[index].NextFree = NONE;
@@ -76,7 +102,7 @@ namespace gamelib
 			mLastFree = index;
 		}
 
-		bool IsValid(Handle h) const
+		bool IsValid(HANDLE h) const
 		{
 			if (!h.IsValid()) return false;
 			if (h.Index >= mEntries.size()) return false;
@@ -84,6 +110,28 @@ namespace gamelib
 			return entry.NextFree == USED && entry.Counter == h.Counter;
 		}
 
+		/// Creates `count` more free entries at once, so handle creation doesn't grow the entry array one by one
+		void Reserve(size_t count)
+		{
+			const auto first = index_type(mEntries.size());
+			AssumingLessEqual(mEntries.size() + count, size_t(HANDLE::MAX_INDEX) + 1, "Out of handles");
+			if (count == 0)
+				return;
+
+			mEntries.resize(mEntries.size() + count);
+			const auto last = index_type(mEntries.size() - 1);
+			for (auto i = first; i < last; ++i)
+				mEntries[i].NextFree = i + 1;
+
+			if (mLastFree == NONE)
+				mFirstFree = first;
+			else
+				mEntries[mLastFree].NextFree = first;
+			mLastFree = last;
+		}
+
+		size_t Capacity() const noexcept { return mEntries.size(); }
+
 		void Clear()
 		{
 			mFirstFree = NONE;
@@ -91,10 +139,10 @@ namespace gamelib
 			mEntries.clear();
 		}
 
-		Handle GetHandle(index_type i) const
+		HANDLE GetHandle(index_type i) const
 		{
-			if (i >= 0 && i < mEntries.size())
-				return Handle(i, mEntries[i].Counter);
+			if (i < mEntries.size())
+				return HANDLE(i, mEntries[i].Counter);
 			return {};
 		}
 
@@ -117,6 +165,7 @@ namespace gamelib
 				if (mFirstFree == NONE) mLastFree = NONE;
 				return result;
 			}
+			AssumingLessEqual(mEntries.size(), size_t(HANDLE::MAX_INDEX), "Out of handles");
 			mEntries.emplace_back();
 			return value_type(mEntries.size() - 1);
 		}
@@ -126,4 +175,7 @@ namespace gamelib
 		std::vector< index_entry > mEntries;
 	};
 
-}
\ No newline at end of file
+	using HandleManager = BasicHandleManager<Handle>;
+	using HandleManager64 = BasicHandleManager<Handle64>;
+
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "HandleManager.h"
+#include <span>
+#include <utility>
+
+namespace gamelib
+{
+	/// Owns values addressed by `Handle`s. The values are stored densely, so iterating over them is a linear walk,
+	/// and a sparse table maps the index of a handle to the position of its value.
+	/// Insertion, erasure and lookup are O(1); erasure moves the last value into the hole, so it doesn't preserve order.
+	/// Handles of erased values are detected as stale by the counter in `HandleManager`.
+	/// Use `Handle64` for more than 65,536 values.
+	template <typename T, typename HANDLE = Handle>
+	class SlotMap
+	{
+	public:
+
+		using value_type = T;
+		using handle_type = HANDLE;
+		using iterator = typename std::vector<T>::iterator;
+		using const_iterator = typename std::vector<T>::const_iterator;
+
+		template <typename... ARGS>
+		HANDLE Emplace(ARGS&&... args)
+		{
+			const auto handle = mHandles.CreateHandle();
+			if (handle.Index >= mDenseIndices.size())
+				mDenseIndices.resize(handle.Index + 1);
+			mDenseIndices[handle.Index] = uint32_t(mValues.size());
+			mValues.emplace_back(std::forward<ARGS>(args)...);
+			mDenseHandles.push_back(handle);
+			return handle;
+		}
+
+		HANDLE Insert(T value) { return Emplace(std::move(value)); }
+
+		/// Returns false if the handle is stale
+		bool Erase(HANDLE handle)
+		{
+			if (!Contains(handle))
+				return false;
+
+			const auto index = mDenseIndices[handle.Index];
+			const auto last = uint32_t(mValues.size() - 1);
+			if (index != last)
+			{
+				mValues[index] = std::move(mValues[last]);
+				mDenseHandles[index] = mDenseHandles[last];
+				mDenseIndices[mDenseHandles[index].Index] = index;
+			}
+			mValues.pop_back();
+			mDenseHandles.pop_back();
+			mHandles.FreeHandle(handle);
+			return true;
+		}
+
+		/// Erases all values for which `predicate(T const&)` returns true
+		template <typename FUNC>
+		size_t EraseIf(FUNC&& predicate)
+		{
+			size_t erased = 0;
+			/// Iterating backwards, so the value swapped into an erased slot has already been checked
+			for (auto index = mValues.size(); index-- > 0;)
+			{
+				if (predicate(std::as_const(mValues[index])))
+				{
+					Erase(mDenseHandles[index]);
+					++erased;
+				}
+			}
+			return erased;
+		}
+
+		bool Contains(HANDLE handle) const noexcept { return mHandles.IsValid(handle); }
+
+		/// Returns null if the handle is stale. The pointer is invalidated by insertions and erasures.
+		T* Get(HANDLE handle) noexcept { return Contains(handle) ? &mValues[mDenseIndices[handle.Index]] : nullptr; }
+		T const* Get(HANDLE handle) const noexcept { return Contains(handle) ? &mValues[mDenseIndices[handle.Index]] : nullptr; }
+
+		void Clear()
+		{
+			for (auto handle : mDenseHandles)
+				mHandles.FreeHandle(handle);
+			mValues.clear();
+			mDenseHandles.clear();
+		}
+
+		/// Also preallocates the handles, so inserting up to `count` values doesn't allocate
+		void Reserve(size_t count)
+		{
+			if (count > mHandles.Capacity())
+			{
+				mHandles.Reserve(count - mHandles.Capacity());
+				mDenseIndices.resize(count);
+			}
+			mValues.reserve(count);
+			mDenseHandles.reserve(count);
+		}
+
+		size_t Size() const noexcept { return mValues.size(); }
+		bool Empty() const noexcept { return mValues.empty(); }
+
+		/// The values in no particular order, and the handle of each, in the same order
+		std::span<T> Values() noexcept { return mValues; }
+		std::span<T const> Values() const noexcept { return mValues; }
+		std::span<HANDLE const> Handles() const noexcept { return mDenseHandles; }
+
+		iterator begin() noexcept { return mValues.begin(); }
+		iterator end() noexcept { return mValues.end(); }
+		const_iterator begin() const noexcept { return mValues.begin(); }
+		const_iterator end() const noexcept { return mValues.end(); }
+
+	private:
+
+		BasicHandleManager<HANDLE> mHandles;
+
+		/// Position in `mValues` of the value of each handle index; only meaningful for valid handles
+		std::vector<uint32_t> mDenseIndices;
+
+		std::vector<T> mValues;
+		std::vector<HANDLE> mDenseHandles;
+	};
+}
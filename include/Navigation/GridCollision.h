@@ -0,0 +1,152 @@
+#pragma once
+
+#include "Grid.h"
+#include "../Parallel.h"
+#include <span>
+
+namespace gamelib::squares
+{
+	enum class GridContact
+	{
+		Top,
+		Right,
+		Bottom,
+		Left,
+	};
+
+	using GridContacts = enum_flags<GridContact, uint8_t>;
+
+	/// A structure-of-arrays view of axis-aligned movers (eg. platformer mobs).
+	/// All spans must be of equal size, except `Contacts`, which may be empty if you don't care about them.
+	struct GridMovers
+	{
+		std::span<vec2> Positions; /// left-top corner
+		std::span<vec2 const> Sizes;
+		std::span<vec2> Velocities;
+		std::span<GridContacts> Contacts;
+
+		size_t Count() const noexcept { return Positions.size(); }
+	};
+
+	/// An owning version of `GridMovers`, so you don't have to reallocate the arrays every frame
+	struct GridMoverArrays
+	{
+		std::vector<vec2> Positions;
+		std::vector<vec2> Sizes;
+		std::vector<vec2> Velocities;
+		std::vector<GridContacts> Contacts;
+
+		size_t Add(vec2 position, vec2 size, vec2 velocity)
+		{
+			Positions.push_back(position);
+			Sizes.push_back(size);
+			Velocities.push_back(velocity);
+			Contacts.emplace_back();
+			return Positions.size() - 1;
+		}
+
+		void Clear() noexcept
+		{
+			Positions.clear();
+			Sizes.clear();
+			Velocities.clear();
+			Contacts.clear();
+		}
+
+		size_t Count() const noexcept { return Positions.size(); }
+
+		GridMovers View() noexcept { return { Positions, Sizes, Velocities, Contacts }; }
+	};
+
+	struct GridCollisionParameters
+	{
+		vec2 TileSize{ 1.0f, 1.0f };
+
+		/// Added to every velocity (times `dt`) before resolving
+		vec2 Gravity{};
+
+		/// Maximum distance a mover is probed ahead in a single step; keep it below the tile size to avoid tunneling
+		vec2 MaxStep{ 0.5f, 0.5f };
+
+		/// How far inside the far (right/bottom) edges of a mover the tiles are sampled, so that a mover flush with a wall doesn't touch it
+		float EdgeInset = 0.001f;
+
+		/// If non-zero, movers are resolved in batches of this size on multiple threads
+		size_t ParallelBatchSize = 0;
+	};
+
+	/// Function: ResolveGridCollisions
+	/// Moves all `movers` by their velocities, stopping them at tiles for which `is_solid(ivec2, TILE_DATA const&)` returns true.
+	/// Tiles outside the grid are never solid. The Y axis is resolved first, then X.
+	/// The grid is only read, so movers are resolved independently of each other, and can be split across threads.
+	template <typename TILE_DATA, typename SOLID_FUNC>
+	void ResolveGridCollisions(Grid<TILE_DATA> const& grid, GridMovers const& movers, seconds_t dt, GridCollisionParameters const& params, SOLID_FUNC&& is_solid)
+	{
+		const auto fdt = (float)dt;
+		const auto tile_size = params.TileSize;
+		const auto has_contacts = !movers.Contacts.empty();
+
+		/// Returns whether any tile in the given span of tiles perpendicular to `axis` is solid
+		auto any_solid = [&](int axis, int tile_on_axis, float from, float to) {
+			const auto other = 1 - axis;
+			const auto first = (int)std::floor(from / tile_size[other]);
+			const auto last = (int)std::floor(to / tile_size[other]);
+			ivec2 pos{};
+			pos[axis] = tile_on_axis;
+			for (pos[other] = first; pos[other] <= last; ++pos[other])
+			{
+				if (auto tile = grid.At(pos); tile && is_solid(pos, *tile))
+					return true;
+			}
+			return false;
+		};
+
+		auto resolve_axis = [&](int axis, vec2& pos, vec2 const size, vec2& vel, GridContacts& contacts) {
+			const auto other = 1 - axis;
+			const auto step = std::clamp(vel[axis] * fdt, -params.MaxStep[axis], params.MaxStep[axis]);
+			const auto span_from = pos[other];
+			const auto span_to = pos[other] + size[other] - params.EdgeInset;
+
+			if (vel[axis] > 0)
+			{
+				const auto tile = (int)std::floor((pos[axis] + size[axis] + step) / tile_size[axis]);
+				if (any_solid(axis, tile, span_from, span_to))
+				{
+					pos[axis] = tile * tile_size[axis] - size[axis];
+					vel[axis] = 0;
+					contacts.set(axis == 0 ? GridContact::Right : GridContact::Bottom);
+				}
+			}
+			else if (vel[axis] < 0)
+			{
+				const auto tile = (int)std::floor((pos[axis] + step) / tile_size[axis]);
+				if (any_solid(axis, tile, span_from, span_to))
+				{
+					pos[axis] = (tile + 1) * tile_size[axis];
+					vel[axis] = 0;
+					contacts.set(axis == 0 ? GridContact::Left : GridContact::Top);
+				}
+			}
+
+			pos[axis] += vel[axis] * fdt;
+		};
+
+		ParallelForBatches(movers.Count(), params.ParallelBatchSize, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i)
+			{
+				auto pos = movers.Positions[i];
+				auto vel = movers.Velocities[i] + params.Gravity * fdt;
+				const auto size = movers.Sizes[i];
+				GridContacts contacts{};
+
+				resolve_axis(1, pos, size, vel, contacts);
+				resolve_axis(0, pos, size, vel, contacts);
+
+				movers.Positions[i] = pos;
+				movers.Velocities[i] = vel;
+				if (has_contacts)
+					movers.Contacts[i] = contacts;
+			}
+		});
+	}
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+#include "Grid.h"
+#include "../Parallel.h"
+#include "../Includes/Assuming.h"
+#include <span>
+
+namespace gamelib::squares
+{
+	/// A spatial index of objects (eg. pointers or handles) over the tiles of a grid, meant to be rebuilt from scratch every frame.
+	/// Objects are bucketed by the tile their position is in (objects outside the grid go to the nearest edge tile),
+	/// and stored sorted by tile index, so a row of tiles is a single contiguous range, and queries need no hashing.
+	template <typename OBJECT>
+	struct GridObjectIndex
+	{
+		void Reset(ivec2 grid_size, vec2 tile_size)
+		{
+			mGridSize = glm::max(grid_size, ivec2{ 1, 1 });
+			mTileSize = tile_size;
+			mTileStarts.assign(size_t(mGridSize.x) * size_t(mGridSize.y) + 1, 0);
+			mObjects.clear();
+			mPositions.clear();
+		}
+
+		template <typename TILE_DATA>
+		void Reset(Grid<TILE_DATA> const& grid, vec2 tile_size) { Reset(grid.Size(), tile_size); }
+
+		/// Rebuilds the index using a counting sort, with `positions[i]` being the world position of `objects[i]`.
+		/// If `parallel_batch_size` is non-zero, objects are split into contiguous ranges of at least this size (one per hardware thread at most),
+		/// which are processed on multiple threads. The order of objects within a tile is the same as in `objects` regardless of threading.
+		void Rebuild(std::span<OBJECT const> objects, std::span<vec2 const> positions, size_t parallel_batch_size = 0);
+
+		/// Calls `func(OBJECT const&, vec2 position)` for every object in the given tiles.
+		/// Tiles outside the grid are clamped to its edge tiles, which is where objects outside the grid are.
+		/// If `func` returns a value convertible to `true`, iteration stops and true is returned.
+		template <typename FUNC>
+		auto ForEachObjectInTiles(irec2 tile_rect, FUNC&& func) const;
+
+		/// Like `ForEachObjectInTiles`, but only for objects whose position is within `world_rect`
+		template <typename FUNC>
+		auto ForEachObjectInRect(rec2 const& world_rect, FUNC&& func) const;
+
+		/// Like `ForEachObjectInTiles`, but only for objects whose position is within `radius` of `center`
+		template <typename FUNC>
+		auto ForEachObjectInRadius(vec2 center, float radius, FUNC&& func) const;
+
+		std::span<OBJECT const> ObjectsInTile(ivec2 tile) const noexcept
+		{
+			if (!IsValid(tile)) return {};
+			const auto index = TileIndex(tile);
+			return std::span{ mObjects }.subspan(mTileStarts[index], mTileStarts[index + 1] - mTileStarts[index]);
+		}
+
+		size_t ObjectCount() const noexcept { return mObjects.size(); }
+		ivec2 GridSize() const noexcept { return mGridSize; }
+		vec2 TileSize() const noexcept { return mTileSize; }
+
+	private:
+
+		bool IsValid(ivec2 tile) const noexcept { return tile.x >= 0 && tile.y >= 0 && tile.x < mGridSize.x && tile.y < mGridSize.y; }
+		size_t TileIndex(ivec2 tile) const noexcept { return size_t(tile.y) * size_t(mGridSize.x) + size_t(tile.x); }
+		uint32_t TileIndexOf(vec2 position) const noexcept
+		{
+			const auto tile = glm::clamp(ivec2(glm::floor(position / mTileSize)), ivec2{ 0, 0 }, mGridSize - 1);
+			return uint32_t(TileIndex(tile));
+		}
+
+		ivec2 mGridSize{ 1, 1 };
+		vec2 mTileSize{ 1.0f, 1.0f };
+
+		/// Objects in tile `i` are at [mTileStarts[i], mTileStarts[i + 1])
+		std::vector<uint32_t> mTileStarts = { 0, 0 };
+		std::vector<OBJECT> mObjects;
+		std::vector<vec2> mPositions;
+
+		/// Scratch space for rebuilding
+		std::vector<uint32_t> mObjectTiles;
+		std::vector<uint32_t> mRangeCounts;
+	};
+
+	template <typename OBJECT>
+	void GridObjectIndex<OBJECT>::Rebuild(std::span<OBJECT const> objects, std::span<vec2 const> positions, size_t parallel_batch_size)
+	{
+		AssumingEqual(objects.size(), positions.size());
+
+		const auto count = objects.size();
+		const auto tile_count = mTileStarts.size() - 1;
+		const auto max_ranges = parallel_batch_size == 0 ? size_t{ 1 } : (count + parallel_batch_size - 1) / parallel_batch_size;
+		const auto range_count = std::clamp<size_t>(max_ranges, 1, std::max(1U, std::thread::hardware_concurrency()));
+		const auto range_size = std::max<size_t>((count + range_count - 1) / range_count, 1);
+
+		/// Every range counts its objects per tile into its own row, so no atomics are needed and the sort stays stable;
+		/// there are no more rows than threads, which keeps the serial prefix pass below short
+		mObjectTiles.resize(count);
+		mRangeCounts.assign(range_count * tile_count, 0);
+		ParallelForBatches(count, range_size, [&](size_t begin, size_t end) {
+			const auto counts = mRangeCounts.data() + (begin / range_size) * tile_count;
+			for (size_t i = begin; i < end; ++i)
+			{
+				const auto tile = TileIndexOf(positions[i]);
+				mObjectTiles[i] = tile;
+				++counts[tile];
+			}
+		});
+
+		/// Turn the counts into the first destination index for each (range, tile)
+		uint32_t running = 0;
+		for (size_t tile = 0; tile < tile_count; ++tile)
+		{
+			mTileStarts[tile] = running;
+			for (size_t range = 0; range < range_count; ++range)
+			{
+				auto& slot = mRangeCounts[range * tile_count + tile];
+				running += std::exchange(slot, running);
+			}
+		}
+		mTileStarts[tile_count] = running;
+
+		mObjects.resize(count);
+		mPositions.resize(count);
+		ParallelForBatches(count, range_size, [&](size_t begin, size_t end) {
+			const auto cursors = mRangeCounts.data() + (begin / range_size) * tile_count;
+			for (size_t i = begin; i < end; ++i)
+			{
+				const auto destination = cursors[mObjectTiles[i]]++;
+				mObjects[destination] = objects[i];
+				mPositions[destination] = positions[i];
+			}
+		});
+	}
+
+	template <typename OBJECT>
+	template <typename FUNC>
+	auto GridObjectIndex<OBJECT>::ForEachObjectInTiles(irec2 tile_rect, FUNC&& func) const
+	{
+		using return_type = decltype(func(std::declval<OBJECT const&>(), vec2{}));
+		static_assert(std::is_void_v<return_type> || std::is_convertible_v<return_type, bool>, "return type of object callback must be either void or convertible to bool");
+
+		if (tile_rect.p1.x >= tile_rect.p2.x || tile_rect.p1.y >= tile_rect.p2.y)
+		{
+			if constexpr (!std::is_void_v<return_type>)
+				return false;
+			else
+				return;
+		}
+
+		const auto from = glm::clamp(tile_rect.p1, ivec2{ 0, 0 }, mGridSize - 1);
+		const auto last_tile = glm::clamp(tile_rect.p2 - 1, ivec2{ 0, 0 }, mGridSize - 1);
+
+		/// Tiles in a row are consecutive, so their objects form one range
+		for (int y = from.y; y <= last_tile.y; ++y)
+		{
+			const auto first = mTileStarts[TileIndex({ from.x, y })];
+			const auto last = mTileStarts[TileIndex({ last_tile.x, y }) + 1];
+			for (auto i = first; i < last; ++i)
+			{
+				if constexpr (std::is_void_v<return_type>)
+					func(mObjects[i], mPositions[i]);
+				else if (func(mObjects[i], mPositions[i]))
+					return true;
+			}
+		}
+
+		if constexpr (!std::is_void_v<return_type>)
+			return false;
+	}
+
+	template <typename OBJECT>
+	template <typename FUNC>
+	auto GridObjectIndex<OBJECT>::ForEachObjectInRect(rec2 const& world_rect, FUNC&& func) const
+	{
+		const irec2 tile_rect{ ivec2(glm::floor(world_rect.p1 / mTileSize)), ivec2(glm::floor(world_rect.p2 / mTileSize)) + 1 };
+		return ForEachObjectInTiles(tile_rect, [&](OBJECT const& object, vec2 position) {
+			using return_type = decltype(func(object, position));
+			if (!world_rect.contains(position))
+				return return_type();
+			return func(object, position);
+		});
+	}
+
+	template <typename OBJECT>
+	template <typename FUNC>
+	auto GridObjectIndex<OBJECT>::ForEachObjectInRadius(vec2 center, float radius, FUNC&& func) const
+	{
+		const auto radius_squared = radius * radius;
+		const irec2 tile_rect{ ivec2(glm::floor((center - radius) / mTileSize)), ivec2(glm::floor((center + radius) / mTileSize)) + 1 };
+		return ForEachObjectInTiles(tile_rect, [&](OBJECT const& object, vec2 position) {
+			using return_type = decltype(func(object, position));
+			const auto d = position - center;
+			if (glm::dot(d, d) > radius_squared)
+				return return_type();
+			return func(object, position);
+		});
+	}
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include "Grid.h"
+#include "../Buffers.h"
+#include "../Serialization/MappedFileBuffers.h"
+#include <span>
+#include <cstring>
+#include <stdexcept>
+
+namespace gamelib::squares
+{
+	/// The start of a grid snapshot; the tiles follow at `TilesOffset`, which is aligned to `GridSnapshotHeader::TileArrayAlignment`
+	struct GridSnapshotHeader
+	{
+		static constexpr uint32_t Signature = 'G' | ('R' << 8) | ('I' << 16) | ('D' << 24);
+		/// Enough for any tile type, and for the tiles to start on a cache line
+		static constexpr uint32_t TileArrayAlignment = 64;
+
+		uint32_t Magic = Signature;
+		/// Chosen by the user, and bumped whenever the tile type changes
+		uint32_t Version = 0;
+		int32_t Width = 0;
+		int32_t Height = 0;
+		uint32_t TileSize = 0;
+		uint32_t TileAlignment = 0;
+		uint64_t TilesOffset = 0;
+	};
+	static_assert(sizeof(GridSnapshotHeader) == 32);
+
+	/// A read-only grid over tiles that live elsewhere, usually in a memory-mapped snapshot (see `MappedGrid`).
+	/// Has the same accessors as `Grid`.
+	template <typename TILE_DATA>
+	struct GridView
+	{
+		GridView() noexcept = default;
+		GridView(ivec2 size, std::span<TILE_DATA const> tiles) noexcept : mWidth(size.x), mHeight(size.y), mTiles(tiles) {}
+		GridView(Grid<TILE_DATA> const& grid) noexcept : GridView(grid.Size(), grid.Tiles()) {}
+
+		TILE_DATA const& operator[](int i) const { return mTiles[i]; }
+
+		bool IsValid(int x, int y) const noexcept { return x >= 0 && y >= 0 && x < mWidth && y < mHeight; }
+		bool IsValid(ivec2 pos) const noexcept { return IsValid(pos.x, pos.y); }
+		bool IsIndexValid(int index) const noexcept { return index >= 0 && index < (int)mTiles.size(); }
+
+		TILE_DATA const* At(ivec2 pos) const noexcept { return IsValid(pos) ? &mTiles[pos.x + pos.y * mWidth] : nullptr; }
+		TILE_DATA const* At(int x, int y) const noexcept { return At(ivec2{ x, y }); }
+		TILE_DATA const* AtIndex(int index) const noexcept { return IsIndexValid(index) ? &mTiles[index] : nullptr; }
+		TILE_DATA const& SafeAt(ivec2 pos, TILE_DATA const& outside) const noexcept { if (auto at = At(pos)) return *at; return outside; }
+
+		int Width() const noexcept { return mWidth; }
+		int Height() const noexcept { return mHeight; }
+		ivec2 Size() const noexcept { return { mWidth, mHeight }; }
+		irec2 Perimeter() const noexcept { return irec2::from_size({}, Size()); }
+		std::span<TILE_DATA const> Tiles() const noexcept { return mTiles; }
+
+		/// Copies the tiles into a grid that can be modified
+		Grid<TILE_DATA> ToGrid() const
+		{
+			Grid<TILE_DATA> result{ Size() };
+			std::copy(mTiles.begin(), mTiles.end(), result.AtIndex(0));
+			return result;
+		}
+
+	private:
+
+		int mWidth = 0;
+		int mHeight = 0;
+		std::span<TILE_DATA const> mTiles;
+	};
+
+	/// Writes the snapshot of a grid to an output buffer: a `GridSnapshotHeader`, then the raw tile array.
+	/// Returns the number of bytes appended.
+	template <typename BUFFER, typename TILE_DATA>
+	size_t SaveGridSnapshot(BUFFER& output, Grid<TILE_DATA> const& grid, uint32_t version = 0)
+	{
+		static_assert(std::is_trivially_copyable_v<TILE_DATA>, "only grids of trivially copyable tiles can be snapshotted");
+		static_assert(alignof(TILE_DATA) <= GridSnapshotHeader::TileArrayAlignment);
+
+		GridSnapshotHeader header;
+		header.Version = version;
+		header.Width = grid.Width();
+		header.Height = grid.Height();
+		header.TileSize = sizeof(TILE_DATA);
+		header.TileAlignment = alignof(TILE_DATA);
+		header.TilesOffset = GridSnapshotHeader::TileArrayAlignment;
+
+		char start[GridSnapshotHeader::TileArrayAlignment]{};
+		std::memcpy(start, &header, sizeof(header));
+		const auto tiles = grid.Tiles();
+		return buffer_append_read_chunk(output, std::span<char const>{ start })
+			+ buffer_append_read_chunk(output, std::span<char const>{ reinterpret_cast<char const*>(tiles.data()), tiles.size_bytes() });
+	}
+
+	/// Views a snapshot in place, without copying or parsing the tiles. The snapshot memory has to be aligned for the tiles
+	/// (mapped files always are) and has to outlive the view.
+	/// Throws `std::runtime_error` if the snapshot is not of a grid of `TILE_DATA` of the given version, or is truncated.
+	template <typename TILE_DATA>
+	GridView<TILE_DATA> ViewGridSnapshot(std::span<char const> snapshot, uint32_t version = 0)
+	{
+		static_assert(std::is_trivially_copyable_v<TILE_DATA>, "only grids of trivially copyable tiles can be snapshotted");
+
+		GridSnapshotHeader header;
+		if (snapshot.size() < sizeof(header))
+			throw std::runtime_error("grid snapshot is truncated");
+		std::memcpy(&header, snapshot.data(), sizeof(header));
+
+		if (header.Magic != GridSnapshotHeader::Signature)
+			throw std::runtime_error("not a grid snapshot");
+		if (header.Version != version)
+			throw std::runtime_error("grid snapshot has a different version");
+		if (header.TileSize != sizeof(TILE_DATA) || header.TileAlignment != alignof(TILE_DATA))
+			throw std::runtime_error("grid snapshot has a different tile type");
+		if (header.Width < 0 || header.Height < 0)
+			throw std::runtime_error("grid snapshot has an invalid size");
+
+		const auto tile_count = size_t(header.Width) * size_t(header.Height);
+		if (header.TilesOffset > snapshot.size() || (snapshot.size() - header.TilesOffset) / sizeof(TILE_DATA) < tile_count)
+			throw std::runtime_error("grid snapshot is truncated");
+
+		const auto tiles = snapshot.data() + header.TilesOffset;
+		if (reinterpret_cast<uintptr_t>(tiles) % alignof(TILE_DATA) != 0)
+			throw std::runtime_error("grid snapshot tiles are misaligned");
+
+		return { { header.Width, header.Height }, { reinterpret_cast<TILE_DATA const*>(tiles), tile_count } };
+	}
+
+	/// Copies a snapshot into an existing grid, which can be one of the navigation grids
+	template <typename TILE_DATA>
+	void LoadGridSnapshot(std::span<char const> snapshot, Grid<TILE_DATA>& into, uint32_t version = 0)
+	{
+		const auto view = ViewGridSnapshot<TILE_DATA>(snapshot, version);
+		into.Reset(view.Size());
+		std::copy(view.Tiles().begin(), view.Tiles().end(), into.AtIndex(0));
+	}
+
+	/// A grid snapshot file mapped into memory and viewed as a read-only grid; loading is just mapping the file,
+	/// and tiles are paged in by the OS as they are accessed. Moving keeps the view valid.
+	template <typename TILE_DATA>
+	class MappedGrid
+	{
+	public:
+
+		/// Throws `std::system_error` if the file can't be mapped, and `std::runtime_error` if it isn't a snapshot of the right grid
+		explicit MappedGrid(std::filesystem::path const& path, uint32_t version = 0, FileAccessPattern access = FileAccessPattern::Random)
+			: mFile(path, access), mView(ViewGridSnapshot<TILE_DATA>(mFile.View(), version))
+		{
+		}
+
+		GridView<TILE_DATA> const& View() const noexcept { return mView; }
+		GridView<TILE_DATA> const* operator->() const noexcept { return &mView; }
+		GridView<TILE_DATA> const& operator*() const noexcept { return mView; }
+
+	private:
+
+		MappedFile mFile;
+		GridView<TILE_DATA> mView;
+	};
+}
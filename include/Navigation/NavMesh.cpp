@@ -0,0 +1,384 @@
+#include "NavMesh.h"
+#include "../Geometry/Triangulate.h"
+#include "../Includes/Assuming.h"
+
+namespace gamelib
+{
+	namespace
+	{
+		/// Twice the signed area of the triangle (a, b, c)
+		float TriArea2(vec2 a, vec2 b, vec2 c) noexcept
+		{
+			const auto ab = b - a;
+			const auto ac = c - a;
+			return ac.x * ab.y - ab.x * ac.y;
+		}
+
+		vec2 PolygonCenter(std::span<vec2 const> vertices) noexcept
+		{
+			vec2 sum{};
+			for (auto& v : vertices)
+				sum += v;
+			return sum / float(vertices.size());
+		}
+
+		bool IsPassable(ivec2, squares::BlockNavigationTile const& tile) noexcept
+		{
+			return !tile.Flags.is_set(squares::BlockNavigationTile::TileFlags::BlocksPassage);
+		}
+	}
+
+	bool NavMesh::Polygon::Contains(vec2 point) const noexcept
+	{
+		/// Convex, so the point must be on the same side of every edge, regardless of winding
+		bool has_positive = false, has_negative = false;
+		for (size_t i = 0, j = Vertices.size() - 1; i < Vertices.size(); j = i++)
+		{
+			const auto area = TriArea2(Vertices[j], Vertices[i], point);
+			has_positive |= area > 0;
+			has_negative |= area < 0;
+			if (has_positive && has_negative)
+				return false;
+		}
+		return !Vertices.empty();
+	}
+
+	void NavMesh::Clear()
+	{
+		mPolygons.clear();
+		mFreePolygons.clear();
+		mTileOwners.Reset(0, 0);
+		mSearchNodes.clear();
+	}
+
+	void NavMesh::BuildFromGrid(squares::BlockNavigationGrid const& grid, vec2 tile_size)
+	{
+		BuildFromGrid(grid, tile_size, IsPassable);
+	}
+
+	void NavMesh::RebuildGridRect(squares::BlockNavigationGrid const& grid, irec2 dirty_tiles)
+	{
+		RebuildGridRect(grid, dirty_tiles, IsPassable);
+	}
+
+	uint32_t NavMesh::AllocatePolygon()
+	{
+		uint32_t index;
+		if (!mFreePolygons.empty())
+		{
+			index = mFreePolygons.back();
+			mFreePolygons.pop_back();
+		}
+		else
+		{
+			index = uint32_t(mPolygons.size());
+			mPolygons.emplace_back();
+		}
+		mPolygons[index].Alive = true;
+		return index;
+	}
+
+	void NavMesh::FreePolygon(uint32_t index)
+	{
+		auto& polygon = mPolygons[index];
+		polygon.Alive = false;
+		polygon.Vertices.clear();
+		polygon.Portals.clear();
+		mFreePolygons.push_back(index);
+	}
+
+	uint32_t NavMesh::AddGridPolygon(irec2 tile_rect)
+	{
+		const auto index = AllocatePolygon();
+		auto& polygon = mPolygons[index];
+		polygon.TileRect = tile_rect;
+
+		const rec2 world_rect{ vec2(tile_rect.p1) * mTileSize, vec2(tile_rect.p2) * mTileSize };
+		polygon.Vertices = { world_rect.left_top(), world_rect.right_top(), world_rect.right_bottom(), world_rect.left_bottom() };
+		polygon.Center = world_rect.center();
+
+		for (int y = tile_rect.top(); y < tile_rect.bottom(); ++y)
+			for (int x = tile_rect.left(); x < tile_rect.right(); ++x)
+				*mTileOwners.At(x, y) = index;
+
+		return index;
+	}
+
+	void NavMesh::RemoveGridPolygon(uint32_t index)
+	{
+		auto& polygon = mPolygons[index];
+
+		for (auto& portal : polygon.Portals)
+			std::erase_if(mPolygons[portal.Neighbor].Portals, [index](Portal const& back) { return back.Neighbor == index; });
+
+		const auto rect = polygon.TileRect;
+		for (int y = rect.top(); y < rect.bottom(); ++y)
+			for (int x = rect.left(); x < rect.right(); ++x)
+				*mTileOwners.At(x, y) = InvalidPolygon;
+
+		FreePolygon(index);
+	}
+
+	void NavMesh::LinkGridPolygons(std::span<uint32_t const> new_polygons)
+	{
+		std::vector<bool> is_new(mPolygons.size(), false);
+		for (auto index : new_polygons)
+			is_new[index] = true;
+
+		for (auto index : new_polygons)
+		{
+			const auto rect = mPolygons[index].TileRect;
+
+			/// Walks the tiles just outside one side of the rect, adding a portal for every run of tiles with the same owner
+			auto link_side = [&](int axis, int outside, int edge, int from, int to) {
+				uint32_t run_owner = InvalidPolygon;
+				int run_start = from;
+				for (int along = from; along <= to; ++along)
+				{
+					uint32_t owner = InvalidPolygon;
+					if (along < to)
+					{
+						ivec2 pos{};
+						pos[axis] = outside;
+						pos[1 - axis] = along;
+						if (auto tile = mTileOwners.At(pos))
+							owner = *tile;
+					}
+
+					if (owner == run_owner)
+						continue;
+
+					if (run_owner != InvalidPolygon)
+					{
+						Portal portal{ run_owner };
+						portal.Start[axis] = portal.End[axis] = float(edge) * mTileSize[axis];
+						portal.Start[1 - axis] = float(run_start) * mTileSize[1 - axis];
+						portal.End[1 - axis] = float(along) * mTileSize[1 - axis];
+						mPolygons[index].Portals.push_back(portal);
+
+						/// New neighbors will add their own portals when it's their turn
+						if (!is_new[run_owner])
+							mPolygons[run_owner].Portals.push_back({ index, portal.Start, portal.End });
+					}
+
+					run_owner = owner;
+					run_start = along;
+				}
+			};
+
+			link_side(0, rect.left() - 1, rect.left(), rect.top(), rect.bottom());
+			link_side(0, rect.right(), rect.right(), rect.top(), rect.bottom());
+			link_side(1, rect.top() - 1, rect.top(), rect.left(), rect.right());
+			link_side(1, rect.bottom(), rect.bottom(), rect.left(), rect.right());
+		}
+	}
+
+	void NavMesh::BuildFromPolygons(rec2 bounds, std::span<glm::tpolygon2<float> const> obstacles)
+	{
+		Clear();
+
+		std::vector<vec2> vertices{ bounds.left_top(), bounds.right_top(), bounds.right_bottom(), bounds.left_bottom() };
+		std::vector<uint32_t> hole_starts;
+		for (auto& obstacle : obstacles)
+		{
+			hole_starts.push_back(uint32_t(vertices.size()));
+			vertices.insert(vertices.end(), obstacle.vertices.begin(), obstacle.vertices.end());
+		}
+
+		std::vector<uint32_t> triangles(max_triangulation_indices(vertices.size(), hole_starts.size()));
+		triangles.resize(triangulate<float>(vertices, hole_starts, triangles));
+
+		std::vector<uint32_t> polygon_indices(triangles.size());
+		std::vector<uint32_t> polygon_starts(triangles.size() / 3 + 1);
+		const auto polygon_count = decompose_convex<float>(vertices, triangles, polygon_indices, polygon_starts);
+
+		/// Edges keyed by their (sorted) vertex indices; an edge shared by two polygons becomes a portal between them
+		struct Edge { uint32_t A, B, Polygon; };
+		std::vector<Edge> edges;
+		edges.reserve(polygon_starts[polygon_count]);
+
+		mPolygons.resize(polygon_count);
+		for (uint32_t p = 0; p < polygon_count; ++p)
+		{
+			auto& polygon = mPolygons[p];
+			polygon.Alive = true;
+			const auto first = polygon_starts[p], last = polygon_starts[p + 1];
+			for (auto i = first; i < last; ++i)
+			{
+				const auto a = polygon_indices[i], b = polygon_indices[i + 1 < last ? i + 1 : first];
+				polygon.Vertices.push_back(vertices[a]);
+				edges.push_back({ std::min(a, b), std::max(a, b), p });
+			}
+			polygon.Center = PolygonCenter(polygon.Vertices);
+		}
+
+		std::ranges::sort(edges, [](Edge const& l, Edge const& r) { return std::tie(l.A, l.B) < std::tie(r.A, r.B); });
+		for (size_t i = 1; i < edges.size(); ++i)
+		{
+			auto& prev = edges[i - 1];
+			auto& edge = edges[i];
+			if (prev.A != edge.A || prev.B != edge.B || prev.Polygon == edge.Polygon)
+				continue;
+			mPolygons[prev.Polygon].Portals.push_back({ edge.Polygon, vertices[edge.A], vertices[edge.B] });
+			mPolygons[edge.Polygon].Portals.push_back({ prev.Polygon, vertices[edge.A], vertices[edge.B] });
+		}
+	}
+
+	uint32_t NavMesh::FindPolygon(vec2 point) const
+	{
+		if (mTileOwners.Size() != ivec2{})
+		{
+			if (auto owner = mTileOwners.At(ivec2(glm::floor(point / mTileSize))))
+				return *owner;
+			return InvalidPolygon;
+		}
+
+		for (uint32_t i = 0; i < mPolygons.size(); ++i)
+		{
+			if (mPolygons[i].Alive && mPolygons[i].Contains(point))
+				return i;
+		}
+		return InvalidPolygon;
+	}
+
+	NavMesh::Portal const* NavMesh::FindPortal(uint32_t from, uint32_t to) const
+	{
+		for (auto& portal : mPolygons[from].Portals)
+		{
+			if (portal.Neighbor == to)
+				return &portal;
+		}
+		return nullptr;
+	}
+
+	std::vector<vec2> NavMesh::FindPath(vec2 start, vec2 goal)
+	{
+		const auto start_polygon = FindPolygon(start);
+		const auto goal_polygon = FindPolygon(goal);
+		if (start_polygon == InvalidPolygon || goal_polygon == InvalidPolygon)
+			return {};
+
+		const auto polygon_path = FindPolygonPath(start_polygon, goal_polygon, start, goal);
+		if (polygon_path.empty())
+			return {};
+
+		auto path = StringPull(start, goal, polygon_path);
+		std::ranges::reverse(path);
+		return path;
+	}
+
+	std::vector<uint32_t> NavMesh::FindPolygonPath(uint32_t start_polygon, uint32_t goal_polygon, vec2 start, vec2 goal)
+	{
+		AssumingLess(start_polygon, mPolygons.size());
+		AssumingLess(goal_polygon, mPolygons.size());
+
+		mSearchNodes.assign(mPolygons.size(), SearchNode{});
+		mSearchFrontier.clear();
+
+		/// Nodes are positioned at the center of the portal they were entered through
+		mSearchNodes[start_polygon] = { 0.0f, InvalidPolygon, start, true };
+		mSearchFrontier.emplace_back(-glm::distance(start, goal), start_polygon);
+
+		while (!mSearchFrontier.empty())
+		{
+			std::ranges::pop_heap(mSearchFrontier);
+			const auto current = mSearchFrontier.back().second;
+			mSearchFrontier.pop_back();
+
+			if (current == goal_polygon)
+				break;
+
+			const auto& node = mSearchNodes[current];
+			for (auto& portal : mPolygons[current].Portals)
+			{
+				const auto position = portal.Center();
+				const auto new_cost = node.Cost + glm::distance(node.Position, position);
+				auto& next = mSearchNodes[portal.Neighbor];
+				if (next.Visited && new_cost >= next.Cost)
+					continue;
+
+				next = { new_cost, current, position, true };
+				mSearchFrontier.emplace_back(-(new_cost + glm::distance(position, goal)), portal.Neighbor);
+				std::ranges::push_heap(mSearchFrontier);
+			}
+		}
+
+		if (!mSearchNodes[goal_polygon].Visited)
+			return {};
+
+		std::vector<uint32_t> result;
+		for (auto polygon = goal_polygon; polygon != InvalidPolygon; polygon = mSearchNodes[polygon].Predecessor)
+			result.push_back(polygon);
+		std::ranges::reverse(result);
+		return result;
+	}
+
+	std::vector<vec2> NavMesh::StringPull(vec2 start, vec2 goal, std::span<uint32_t const> polygon_path) const
+	{
+		/// Left/right portal endpoints, as seen when walking the path
+		std::vector<std::pair<vec2, vec2>> portals;
+		portals.reserve(polygon_path.size() + 1);
+		portals.emplace_back(start, start);
+		for (size_t i = 1; i < polygon_path.size(); ++i)
+		{
+			auto portal = FindPortal(polygon_path[i - 1], polygon_path[i]);
+			AssumingNotNull(portal);
+			if (TriArea2(mPolygons[polygon_path[i - 1]].Center, portal->Start, portal->End) >= 0)
+				portals.emplace_back(portal->Start, portal->End);
+			else
+				portals.emplace_back(portal->End, portal->Start);
+		}
+		portals.emplace_back(goal, goal);
+
+		/// The "simple stupid funnel algorithm"
+		std::vector<vec2> path{ start };
+		vec2 apex = start, left = start, right = start;
+		size_t apex_index = 0, left_index = 0, right_index = 0;
+
+		for (size_t i = 1; i < portals.size(); ++i)
+		{
+			const auto [new_left, new_right] = portals[i];
+
+			/// Try to narrow the funnel from the right
+			if (TriArea2(apex, right, new_right) <= 0)
+			{
+				if (apex == right || TriArea2(apex, left, new_right) > 0)
+				{
+					right = new_right;
+					right_index = i;
+				}
+				else
+				{
+					/// Right crossed over left, so left becomes a corner of the path
+					path.push_back(left);
+					apex = right = left;
+					apex_index = right_index = left_index;
+					i = apex_index;
+					continue;
+				}
+			}
+
+			/// Try to narrow the funnel from the left
+			if (TriArea2(apex, left, new_left) >= 0)
+			{
+				if (apex == left || TriArea2(apex, right, new_left) < 0)
+				{
+					left = new_left;
+					left_index = i;
+				}
+				else
+				{
+					path.push_back(right);
+					apex = left = right;
+					apex_index = left_index = right_index;
+					i = apex_index;
+					continue;
+				}
+			}
+		}
+
+		if (path.back() != goal)
+			path.push_back(goal);
+		return path;
+	}
+}
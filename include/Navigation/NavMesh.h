@@ -0,0 +1,176 @@
+#pragma once
+
+#include "Navigation.h"
+#include "../Geometry/Polygon.h"
+#include <span>
+
+namespace gamelib
+{
+	/// A navigation mesh made of convex polygons connected by portals (shared edges).
+	/// Can be built from a tile grid (by merging passable tiles into rectangles, which can later be rebuilt locally),
+	/// or from a bounding rectangle and a set of polygonal obstacles.
+	struct NavMesh
+	{
+		static constexpr uint32_t InvalidPolygon = ~uint32_t{};
+
+		struct Portal
+		{
+			uint32_t Neighbor = InvalidPolygon;
+			vec2 Start{};
+			vec2 End{};
+
+			vec2 Center() const noexcept { return (Start + End) * 0.5f; }
+		};
+
+		struct Polygon
+		{
+			std::vector<vec2> Vertices;
+			std::vector<Portal> Portals;
+			vec2 Center{};
+
+			/// For meshes built from grids, the rectangle of tiles covered by this polygon
+			irec2 TileRect{};
+
+			bool Alive = false;
+
+			bool Contains(vec2 point) const noexcept;
+		};
+
+		void Clear();
+
+		/// Builds the mesh by greedily merging tiles for which `passable(ivec2, TILE_DATA const&)` returns true into rectangles
+		template <typename TILE_DATA, typename PASSABLE_FUNC>
+		void BuildFromGrid(squares::Grid<TILE_DATA> const& grid, vec2 tile_size, PASSABLE_FUNC&& passable);
+
+		/// Uses the `BlocksPassage` flag to determine whether tiles are passable
+		void BuildFromGrid(squares::BlockNavigationGrid const& grid, vec2 tile_size);
+
+		/// Rebuilds only the polygons of a grid-built mesh that cover the `dirty_tiles` rectangle (eg. after tiles in it changed passability).
+		/// Polygons outside of that rectangle (and their portals) are left untouched.
+		template <typename TILE_DATA, typename PASSABLE_FUNC>
+		void RebuildGridRect(squares::Grid<TILE_DATA> const& grid, irec2 dirty_tiles, PASSABLE_FUNC&& passable);
+
+		/// Uses the `BlocksPassage` flag to determine whether tiles are passable
+		void RebuildGridRect(squares::BlockNavigationGrid const& grid, irec2 dirty_tiles);
+
+		/// Builds the mesh from the walkable area of `bounds` minus `obstacles` (which must lie inside `bounds` and not overlap each other).
+		/// Meshes built this way cannot be rebuilt locally.
+		void BuildFromPolygons(rec2 bounds, std::span<glm::tpolygon2<float> const> obstacles);
+
+		/// Returns the index of the polygon containing `point`, or `InvalidPolygon` if none does
+		uint32_t FindPolygon(vec2 point) const;
+
+		/// Returns the REVERSED path, for ease of popping
+		std::vector<vec2> FindPath(vec2 start, vec2 goal);
+
+		/// Runs A* over the polygon adjacency graph; returns the polygons to go through, from `start_polygon` to `goal_polygon`
+		std::vector<uint32_t> FindPolygonPath(uint32_t start_polygon, uint32_t goal_polygon, vec2 start, vec2 goal);
+
+		/// Applies the funnel algorithm to get the shortest path from `start` to `goal` through the portals between `polygon_path`
+		std::vector<vec2> StringPull(vec2 start, vec2 goal, std::span<uint32_t const> polygon_path) const;
+
+		std::span<Polygon const> Polygons() const noexcept { return mPolygons; }
+		Polygon const* At(uint32_t index) const noexcept { return index < mPolygons.size() && mPolygons[index].Alive ? &mPolygons[index] : nullptr; }
+		size_t PolygonCount() const noexcept { return mPolygons.size() - mFreePolygons.size(); }
+
+	private:
+
+		template <typename TILE_DATA, typename PASSABLE_FUNC>
+		void MeshGridRegion(squares::Grid<TILE_DATA> const& grid, irec2 region, PASSABLE_FUNC&& passable);
+
+		uint32_t AllocatePolygon();
+		void FreePolygon(uint32_t index);
+		uint32_t AddGridPolygon(irec2 tile_rect);
+		void RemoveGridPolygon(uint32_t index);
+		void LinkGridPolygons(std::span<uint32_t const> new_polygons);
+		Portal const* FindPortal(uint32_t from, uint32_t to) const;
+
+		std::vector<Polygon> mPolygons;
+		std::vector<uint32_t> mFreePolygons;
+
+		squares::Grid<uint32_t> mTileOwners;
+		vec2 mTileSize{ 1.0f, 1.0f };
+
+		struct SearchNode
+		{
+			float Cost = 0;
+			uint32_t Predecessor = InvalidPolygon;
+			vec2 Position{};
+			bool Visited = false;
+		};
+
+		std::vector<SearchNode> mSearchNodes;
+		std::vector<std::pair<float, uint32_t>> mSearchFrontier;
+	};
+
+	template <typename TILE_DATA, typename PASSABLE_FUNC>
+	void NavMesh::BuildFromGrid(squares::Grid<TILE_DATA> const& grid, vec2 tile_size, PASSABLE_FUNC&& passable)
+	{
+		Clear();
+		mTileSize = tile_size;
+		mTileOwners.Reset(grid.Size(), InvalidPolygon);
+		MeshGridRegion(grid, grid.Perimeter(), passable);
+	}
+
+	template <typename TILE_DATA, typename PASSABLE_FUNC>
+	void NavMesh::RebuildGridRect(squares::Grid<TILE_DATA> const& grid, irec2 dirty_tiles, PASSABLE_FUNC&& passable)
+	{
+		if (mTileOwners.Size() != grid.Size())
+			return BuildFromGrid(grid, mTileSize, passable);
+
+		const auto perimeter = grid.Perimeter();
+		dirty_tiles = irec2{ glm::max(dirty_tiles.p1, perimeter.p1), glm::min(dirty_tiles.p2, perimeter.p2) };
+		if (!dirty_tiles.is_valid())
+			return;
+
+		/// Remove every polygon touching the dirty rect, and remesh the area they covered
+		auto region = dirty_tiles;
+		mTileOwners.ForEachInRect(dirty_tiles, [&](ivec2 pos) {
+			if (const auto owner = *mTileOwners.At(pos); owner != InvalidPolygon)
+			{
+				region = region.include(mPolygons[owner].TileRect);
+				RemoveGridPolygon(owner);
+			}
+		});
+
+		MeshGridRegion(grid, region, passable);
+	}
+
+	template <typename TILE_DATA, typename PASSABLE_FUNC>
+	void NavMesh::MeshGridRegion(squares::Grid<TILE_DATA> const& grid, irec2 region, PASSABLE_FUNC&& passable)
+	{
+		const auto is_free = [&](int x, int y) {
+			const ivec2 pos{ x, y };
+			return *mTileOwners.At(pos) == InvalidPolygon && passable(pos, *grid.At(pos));
+		};
+
+		std::vector<uint32_t> new_polygons;
+		for (int y = region.top(); y < region.bottom(); ++y)
+		{
+			for (int x = region.left(); x < region.right(); ++x)
+			{
+				if (!is_free(x, y))
+					continue;
+
+				/// Grow as wide as possible, then as tall as possible
+				int right = x + 1;
+				while (right < region.right() && is_free(right, y))
+					++right;
+
+				int bottom = y + 1;
+				for (; bottom < region.bottom(); ++bottom)
+				{
+					bool row_free = true;
+					for (int rx = x; rx < right && row_free; ++rx)
+						row_free = is_free(rx, bottom);
+					if (!row_free)
+						break;
+				}
+
+				new_polygons.push_back(AddGridPolygon({ x, y, right, bottom }));
+			}
+		}
+
+		LinkGridPolygons(new_polygons);
+	}
+}
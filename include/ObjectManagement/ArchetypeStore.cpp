@@ -0,0 +1,230 @@
+#include "ArchetypeStore.h"
+#include <bit>
+
+namespace gamelib
+{
+	namespace
+	{
+		template <typename FUNC>
+		void ForEachComponent(ComponentMask mask, FUNC&& func)
+		{
+			while (mask)
+			{
+				func(size_t(std::countr_zero(mask)));
+				mask &= mask - 1;
+			}
+		}
+	}
+
+	ArchetypeStore::ArchetypeStore()
+	{
+		FindOrCreateArchetype(0);
+	}
+
+	ArchetypeStore::~ArchetypeStore()
+	{
+		for (auto& archetype : mArchetypes)
+		{
+			for (auto& chunk : archetype.Chunks)
+			{
+				ForEachComponent(archetype.Mask, [&](size_t component) {
+					const auto destroy = detail::GetComponentType(component).Destroy;
+					for (uint32_t row = 0; row < chunk.Count; ++row)
+						destroy(ComponentAt(archetype, chunk, component, row));
+				});
+			}
+		}
+	}
+
+	uint32_t ArchetypeStore::FindOrCreateArchetype(ComponentMask mask)
+	{
+		if (auto it = mArchetypesByMask.find(mask); it != mArchetypesByMask.end())
+			return it->second;
+
+		Archetype archetype;
+		archetype.Mask = mask;
+		archetype.ColumnOffsets.fill(NoColumn);
+
+		/// Find the largest capacity whose columns (each aligned) fit in a chunk
+		size_t row_size = sizeof(EntityID);
+		ForEachComponent(mask, [&](size_t component) { row_size += detail::GetComponentType(component).Size; });
+
+		const auto layout = [&](size_t capacity) {
+			size_t offset = sizeof(EntityID) * capacity;
+			ForEachComponent(mask, [&](size_t component) {
+				auto const& type = detail::GetComponentType(component);
+				offset = (offset + type.Alignment - 1) / type.Alignment * type.Alignment;
+				archetype.ColumnOffsets[component] = uint32_t(offset);
+				offset += type.Size * capacity;
+			});
+			return offset;
+		};
+
+		size_t capacity = std::max<size_t>(ChunkSize / row_size, 1);
+		while (capacity > 1 && layout(capacity) > ChunkSize)
+			--capacity;
+		const auto chunk_bytes = std::max(layout(capacity), ChunkSize);
+		AssumingLessEqual(chunk_bytes, ChunkSize, "a single entity of this archetype does not fit in a chunk");
+		archetype.Capacity = uint32_t(capacity);
+
+		const auto index = uint32_t(mArchetypes.size());
+		mArchetypes.push_back(std::move(archetype));
+		mArchetypesByMask.emplace(mask, index);
+
+		for (auto& group : mGroups)
+		{
+			if (group.Query.Matches(mask))
+				group.Archetypes.push_back(index);
+		}
+
+		return index;
+	}
+
+	EntityID ArchetypeStore::AllocateID()
+	{
+		if (!mFreeIDSlots.empty())
+		{
+			const auto index = mFreeIDSlots.back();
+			mFreeIDSlots.pop_back();
+			return MakeEntityID(index, mIDSlots[index].Generation);
+		}
+		mIDSlots.emplace_back();
+		return MakeEntityID(uint32_t(mIDSlots.size() - 1), 0);
+	}
+
+	ArchetypeStore::EntityRecord ArchetypeStore::AllocateRow(uint32_t archetype_index, EntityID id)
+	{
+		auto& archetype = mArchetypes[archetype_index];
+		if (archetype.Chunks.empty() || archetype.Chunks.back().Count == archetype.Capacity)
+		{
+			Chunk chunk;
+			chunk.Data.reset(static_cast<std::byte*>(::operator new(ChunkSize, std::align_val_t{ ChunkAlignment })));
+			archetype.Chunks.push_back(std::move(chunk));
+		}
+
+		auto& chunk = archetype.Chunks.back();
+		const EntityRecord record{ archetype_index, uint32_t(archetype.Chunks.size() - 1), chunk.Count++ };
+		IDsOf(chunk)[record.Row] = id;
+		return record;
+	}
+
+	void ArchetypeStore::RemoveRow(EntityRecord const& record)
+	{
+		auto& archetype = mArchetypes[record.Archetype];
+		auto& chunk = archetype.Chunks[record.Chunk];
+		auto& last_chunk = archetype.Chunks.back();
+		const auto last_row = last_chunk.Count - 1;
+		const bool is_last = &chunk == &last_chunk && record.Row == last_row;
+
+		ForEachComponent(archetype.Mask, [&](size_t component) {
+			auto const& type = detail::GetComponentType(component);
+			const auto target = ComponentAt(archetype, chunk, component, record.Row);
+			type.Destroy(target);
+			if (!is_last)
+			{
+				const auto source = ComponentAt(archetype, last_chunk, component, last_row);
+				type.MoveConstruct(target, source);
+				type.Destroy(source);
+			}
+		});
+
+		if (!is_last)
+		{
+			const auto moved = IDsOf(last_chunk)[last_row];
+			IDsOf(chunk)[record.Row] = moved;
+			RecordOf(moved) = record;
+		}
+
+		if (--last_chunk.Count == 0)
+			archetype.Chunks.pop_back();
+	}
+
+	ArchetypeStore::EntityRecord ArchetypeStore::MoveEntity(EntityID id, ComponentMask new_mask)
+	{
+		const auto old_record = RecordOf(id);
+		const auto new_archetype_index = FindOrCreateArchetype(new_mask);
+
+		const auto new_record = AllocateRow(new_archetype_index, id);
+		auto& old_archetype = mArchetypes[old_record.Archetype];
+		auto& new_archetype = mArchetypes[new_archetype_index];
+		const auto old_mask = old_archetype.Mask;
+
+		/// Move shared components over; RemoveRow will destroy the moved-from husks
+		ForEachComponent(old_mask & new_mask, [&](size_t component) {
+			detail::GetComponentType(component).MoveConstruct(
+				ComponentAt(new_archetype, new_archetype.Chunks[new_record.Chunk], component, new_record.Row),
+				ComponentAt(old_archetype, old_archetype.Chunks[old_record.Chunk], component, old_record.Row));
+		});
+
+		RemoveRow(old_record);
+		RecordOf(id) = new_record;
+
+		EmitGroupChanges(id, old_mask, new_mask);
+		return new_record;
+	}
+
+	bool ArchetypeStore::Destroy(EntityID id)
+	{
+		if (!IsValid(id))
+			return false;
+
+		const auto record = RecordOf(id);
+		auto id_ref = id;
+		EmitGroupChanges(id, mArchetypes[record.Archetype].Mask, std::nullopt);
+		if (Removed) Removed(id_ref);
+
+		RemoveRow(record);
+		auto& slot = mIDSlots[IndexOf(id)];
+		slot.Record = {};
+		++slot.Generation;
+		mFreeIDSlots.push_back(IndexOf(id));
+		return true;
+	}
+
+	void ArchetypeStore::EmitGroupChanges(EntityID id, std::optional<ComponentMask> old_mask, std::optional<ComponentMask> new_mask)
+	{
+		if (!AddedToGroup && !RemovedFromGroup)
+			return;
+
+		for (auto& group : mGroups)
+		{
+			const auto was_in = old_mask && group.Query.Matches(*old_mask);
+			const auto is_in = new_mask && group.Query.Matches(*new_mask);
+			auto id_ref = id;
+			if (is_in && !was_in && AddedToGroup)
+				AddedToGroup(group.Name, id_ref);
+			else if (was_in && !is_in && RemovedFromGroup)
+				RemovedFromGroup(group.Name, id_ref);
+		}
+	}
+
+	void ArchetypeStore::AddGroup(std::string name, EntityQuery query)
+	{
+		Assuming(!mGroupsByName.contains(name));
+		Group group{ std::move(name), query };
+		for (uint32_t i = 0; i < mArchetypes.size(); ++i)
+		{
+			if (query.Matches(mArchetypes[i].Mask))
+				group.Archetypes.push_back(i);
+		}
+		mGroupsByName.emplace(group.Name, mGroups.size());
+		mGroups.push_back(std::move(group));
+	}
+
+	bool ArchetypeStore::IsInGroup(EntityID id, std::string_view group_name) const
+	{
+		const auto it = mGroupsByName.find(group_name);
+		return it != mGroupsByName.end() && IsValid(id) && mGroups[it->second].Query.Matches(ComponentsOf(id));
+	}
+
+	size_t ArchetypeStore::GroupSize(std::string_view group_name) const
+	{
+		const auto it = mGroupsByName.find(group_name);
+		if (it == mGroupsByName.end())
+			return 0;
+		size_t result = 0;
+		for (auto archetype : mGroups[it->second].Archetypes)
+			result += mArchetypes[archetype].Count();
+		return result;
+	}
+}
@@ -0,0 +1,283 @@
+#pragma once
+
+#include "EntityPool_.h"
+#include "Components.h"
+#include <memory>
+#include <array>
+#include <new>
+#include <optional>
+
+namespace gamelib
+{
+	/// Selects entities by the components they have; used to define groups
+	struct EntityQuery
+	{
+		ComponentMask All = 0;
+		ComponentMask None = 0;
+
+		template <typename... COMPONENTS>
+		static EntityQuery With() { return { ComponentMaskOf<COMPONENTS...>(), 0 }; }
+
+		template <typename... COMPONENTS>
+		EntityQuery& Without() { None |= ComponentMaskOf<COMPONENTS...>(); return *this; }
+
+		bool Matches(ComponentMask mask) const noexcept { return (mask & All) == All && (mask & None) == 0; }
+	};
+
+	/// Stores the components of entities in archetypes: all entities with the same set of components share
+	/// fixed-size chunks, in which each component type has its own contiguous array (structure-of-arrays).
+	/// Iterating over a component query goes over these arrays linearly.
+	/// Adding or removing components moves the entity to another archetype.
+	/// Removals swap the last entity of the archetype into the hole, so structural changes (creating and destroying entities,
+	/// adding and removing components) must not be done while iterating.
+	/// Groups are named `EntityQuery`s, for which `AddedToGroup` and `RemovedFromGroup` events are emitted.
+	struct ArchetypeStore : EntityEventReceiver<EntityID>
+	{
+		static constexpr size_t ChunkSize = 16 * 1024;
+		static constexpr size_t ChunkAlignment = 64;
+
+		ArchetypeStore();
+		~ArchetypeStore();
+		ArchetypeStore(ArchetypeStore const&) = delete;
+		ArchetypeStore& operator=(ArchetypeStore const&) = delete;
+
+		template <typename... COMPONENTS>
+		EntityID Create(COMPONENTS&&... components);
+
+		bool Destroy(EntityID id);
+
+		/// False for the IDs of destroyed entities, even if their slot was reused
+		bool IsValid(EntityID id) const noexcept
+		{
+			const auto index = IndexOf(id);
+			return index < mIDSlots.size() && mIDSlots[index].Generation == GenerationOf(id) && mIDSlots[index].Record.Archetype != Free;
+		}
+
+		ComponentMask ComponentsOf(EntityID id) const noexcept { return IsValid(id) ? mArchetypes[RecordOf(id).Archetype].Mask : 0; }
+
+		template <typename T>
+		bool Has(EntityID id) const noexcept { return (ComponentsOf(id) & ComponentMaskOf<T>()) != 0; }
+
+		/// Returns null if the entity doesn't have the component. The pointer is invalidated by structural changes.
+		template <typename T>
+		T* Get(EntityID id) noexcept;
+
+		/// Sets the component (adding it if the entity doesn't have it)
+		template <typename T>
+		T& Set(EntityID id, T value);
+
+		template <typename T>
+		bool Remove(EntityID id);
+
+		void AddGroup(std::string name, EntityQuery query);
+		bool IsInGroup(EntityID id, std::string_view group_name) const;
+		size_t GroupSize(std::string_view group_name) const;
+
+		/// Calls `func(COMPONENTS&...)` (or `func(EntityID, COMPONENTS&...)`) for every entity that has all of the components
+		template <typename... COMPONENTS, typename FUNC>
+		void ForEach(FUNC&& func);
+
+		/// Calls `func(std::span<EntityID const>, std::span<COMPONENTS>...)` for every chunk that contains all of the components
+		template <typename... COMPONENTS, typename FUNC>
+		void ForEachChunk(FUNC&& func);
+
+		/// Like `ForEach`, but only for entities in the group (which must require all of the `COMPONENTS`)
+		template <typename... COMPONENTS, typename FUNC>
+		void ForEachInGroup(std::string_view group_name, FUNC&& func);
+
+		size_t EntityCount() const noexcept { return mIDSlots.size() - mFreeIDSlots.size(); }
+		size_t ArchetypeCount() const noexcept { return mArchetypes.size(); }
+
+	private:
+
+		static constexpr uint32_t Free = ~uint32_t{};
+		static constexpr uint32_t NoColumn = ~uint32_t{};
+
+		struct ChunkDeleter { void operator()(std::byte* data) const noexcept { ::operator delete(data, std::align_val_t{ ChunkAlignment }); } };
+
+		struct Chunk
+		{
+			std::unique_ptr<std::byte, ChunkDeleter> Data;
+			uint32_t Count = 0;
+		};
+
+		struct Archetype
+		{
+			ComponentMask Mask = 0;
+			uint32_t Capacity = 0;
+			/// Byte offset in a chunk of the array for each component type (or `NoColumn`); the entity ID array is at offset 0
+			std::array<uint32_t, MaxComponentTypes> ColumnOffsets;
+			std::vector<Chunk> Chunks;
+
+			size_t Count() const noexcept { return Chunks.empty() ? 0 : (Chunks.size() - 1) * Capacity + Chunks.back().Count; }
+		};
+
+		struct EntityRecord
+		{
+			uint32_t Archetype = Free;
+			uint32_t Chunk = 0;
+			uint32_t Row = 0;
+		};
+
+		struct Group
+		{
+			std::string Name;
+			EntityQuery Query;
+			std::vector<uint32_t> Archetypes;
+		};
+
+		std::vector<Archetype> mArchetypes;
+		std::map<ComponentMask, uint32_t> mArchetypesByMask;
+		struct IDSlot
+		{
+			EntityRecord Record;
+			/// Generation of the IDs this slot hands out; bumped when the entity is destroyed
+			uint32_t Generation = 0;
+		};
+
+		std::vector<IDSlot> mIDSlots;
+		std::vector<uint32_t> mFreeIDSlots;
+		std::vector<Group> mGroups;
+		std::map<std::string, size_t, std::less<>> mGroupsByName;
+
+		uint32_t FindOrCreateArchetype(ComponentMask mask);
+
+		/// Returns the address of the component of the given type in the given row
+		static void* ComponentAt(Archetype const& archetype, Chunk const& chunk, size_t component, uint32_t row) noexcept
+		{
+			return chunk.Data.get() + archetype.ColumnOffsets[component] + GetComponentSize(component) * row;
+		}
+		static EntityID* IDsOf(Chunk const& chunk) noexcept { return reinterpret_cast<EntityID*>(chunk.Data.get()); }
+		static size_t GetComponentSize(size_t component) { return detail::GetComponentType(component).Size; }
+
+		template <typename T>
+		static T* ColumnOf(Archetype const& archetype, Chunk const& chunk) noexcept
+		{
+			return reinterpret_cast<T*>(chunk.Data.get() + archetype.ColumnOffsets[ComponentIndex<T>()]);
+		}
+
+		EntityID AllocateID();
+
+		/// The ID must be valid
+		EntityRecord& RecordOf(EntityID id) noexcept { return mIDSlots[IndexOf(id)].Record; }
+		EntityRecord const& RecordOf(EntityID id) const noexcept { return mIDSlots[IndexOf(id)].Record; }
+
+		/// Appends an uninitialized row to the archetype
+		EntityRecord AllocateRow(uint32_t archetype, EntityID id);
+
+		/// Destroys the components in the row and swaps the last row of the archetype into it
+		void RemoveRow(EntityRecord const& record);
+
+		/// Moves the entity to an archetype with the given mask, moving over the components they share; returns the new record.
+		/// Components of the new archetype that the entity didn't have are left uninitialized.
+		EntityRecord MoveEntity(EntityID id, ComponentMask new_mask);
+
+		/// Old or new mask is empty if the entity is being created or destroyed
+		void EmitGroupChanges(EntityID id, std::optional<ComponentMask> old_mask, std::optional<ComponentMask> new_mask);
+
+		template <typename... COMPONENTS, typename FUNC>
+		void ForEachInArchetype(Archetype& archetype, FUNC& func);
+	};
+
+	template <typename... COMPONENTS>
+	EntityID ArchetypeStore::Create(COMPONENTS&&... components)
+	{
+		const auto id = AllocateID();
+		const auto archetype_index = FindOrCreateArchetype(ComponentMaskOf<std::remove_cvref_t<COMPONENTS>...>());
+		const auto record = RecordOf(id) = AllocateRow(archetype_index, id);
+
+		auto& archetype = mArchetypes[archetype_index];
+		auto& chunk = archetype.Chunks[record.Chunk];
+		(new (ColumnOf<std::remove_cvref_t<COMPONENTS>>(archetype, chunk) + record.Row) std::remove_cvref_t<COMPONENTS>(std::forward<COMPONENTS>(components)), ...);
+
+		auto id_ref = id;
+		if (this->Added) this->Added(id_ref);
+		EmitGroupChanges(id, std::nullopt, archetype.Mask);
+		return id;
+	}
+
+	template <typename T>
+	T* ArchetypeStore::Get(EntityID id) noexcept
+	{
+		if (!Has<T>(id))
+			return nullptr;
+		const auto& record = RecordOf(id);
+		auto& archetype = mArchetypes[record.Archetype];
+		return ColumnOf<T>(archetype, archetype.Chunks[record.Chunk]) + record.Row;
+	}
+
+	template <typename T>
+	T& ArchetypeStore::Set(EntityID id, T value)
+	{
+		Assuming(IsValid(id));
+		if (auto existing = Get<T>(id))
+			return *existing = std::move(value);
+
+		const auto record = MoveEntity(id, ComponentsOf(id) | ComponentMaskOf<T>());
+		auto& archetype = mArchetypes[record.Archetype];
+		return *new (ColumnOf<T>(archetype, archetype.Chunks[record.Chunk]) + record.Row) T(std::move(value));
+	}
+
+	template <typename T>
+	bool ArchetypeStore::Remove(EntityID id)
+	{
+		if (!Has<T>(id))
+			return false;
+		MoveEntity(id, ComponentsOf(id) & ~ComponentMaskOf<T>());
+		return true;
+	}
+
+	template <typename... COMPONENTS, typename FUNC>
+	void ArchetypeStore::ForEachInArchetype(Archetype& archetype, FUNC& func)
+	{
+		for (auto& chunk : archetype.Chunks)
+		{
+			const auto ids = IDsOf(chunk);
+			const auto columns = std::tuple{ ColumnOf<COMPONENTS>(archetype, chunk)... };
+			for (uint32_t row = 0; row < chunk.Count; ++row)
+			{
+				if constexpr (std::invocable<FUNC&, EntityID, COMPONENTS&...>)
+					func(ids[row], std::get<COMPONENTS*>(columns)[row]...);
+				else
+					func(std::get<COMPONENTS*>(columns)[row]...);
+			}
+		}
+	}
+
+	template <typename... COMPONENTS, typename FUNC>
+	void ArchetypeStore::ForEach(FUNC&& func)
+	{
+		const auto mask = ComponentMaskOf<COMPONENTS...>();
+		for (auto& archetype : mArchetypes)
+		{
+			if ((archetype.Mask & mask) == mask)
+				ForEachInArchetype<COMPONENTS...>(archetype, func);
+		}
+	}
+
+	template <typename... COMPONENTS, typename FUNC>
+	void ArchetypeStore::ForEachChunk(FUNC&& func)
+	{
+		const auto mask = ComponentMaskOf<COMPONENTS...>();
+		for (auto& archetype : mArchetypes)
+		{
+			if ((archetype.Mask & mask) != mask)
+				continue;
+			for (auto& chunk : archetype.Chunks)
+				func(std::span<EntityID const>{ IDsOf(chunk), chunk.Count }, std::span<COMPONENTS>{ ColumnOf<COMPONENTS>(archetype, chunk), chunk.Count }...);
+		}
+	}
+
+	template <typename... COMPONENTS, typename FUNC>
+	void ArchetypeStore::ForEachInGroup(std::string_view group_name, FUNC&& func)
+	{
+		const auto it = mGroupsByName.find(group_name);
+		if (it == mGroupsByName.end())
+			return;
+
+		auto& group = mGroups[it->second];
+		AssumingEqual(group.Query.All & ComponentMaskOf<COMPONENTS...>(), ComponentMaskOf<COMPONENTS...>(), "group does not require all iterated components");
+		for (auto archetype : group.Archetypes)
+			ForEachInArchetype<COMPONENTS...>(mArchetypes[archetype], func);
+	}
+}
@@ -0,0 +1,26 @@
+#include "Components.h"
+#include <mutex>
+#include <array>
+
+namespace gamelib::detail
+{
+	namespace
+	{
+		std::mutex ComponentTypesMutex;
+		std::array<ComponentType, MaxComponentTypes> ComponentTypes;
+		size_t ComponentTypeCount = 0;
+	}
+
+	size_t RegisterComponentType(ComponentType const& type)
+	{
+		std::lock_guard lock{ ComponentTypesMutex };
+		AssumingLess(ComponentTypeCount, MaxComponentTypes, "too many component types");
+		ComponentTypes[ComponentTypeCount] = type;
+		return ComponentTypeCount++;
+	}
+
+	ComponentType const& GetComponentType(size_t index)
+	{
+		return ComponentTypes[index];
+	}
+}
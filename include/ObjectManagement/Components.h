@@ -0,0 +1,51 @@
+#pragma once
+
+#include "../Includes/Assuming.h"
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+#include <new>
+#include <utility>
+
+namespace gamelib
+{
+	/// A bit for each registered component type
+	using ComponentMask = uint64_t;
+
+	static constexpr size_t MaxComponentTypes = 64;
+
+	/// Type-erased information about a component type
+	struct ComponentType
+	{
+		size_t Size = 0;
+		size_t Alignment = 0;
+		void (*MoveConstruct)(void* to, void* from) = nullptr;
+		void (*Destroy)(void* what) = nullptr;
+	};
+
+	namespace detail
+	{
+		size_t RegisterComponentType(ComponentType const& type);
+		ComponentType const& GetComponentType(size_t index);
+	}
+
+	/// Returns the index of the component type `T`, registering it the first time it's used
+	template <typename T>
+	size_t ComponentIndex()
+	{
+		static_assert(std::is_nothrow_move_constructible_v<T>, "components must be nothrow move constructible, as they are moved around between chunks");
+		static const size_t index = detail::RegisterComponentType({
+			.Size = sizeof(T),
+			.Alignment = alignof(T),
+			.MoveConstruct = [](void* to, void* from) { new (to) T(std::move(*static_cast<T*>(from))); },
+			.Destroy = [](void* what) { static_cast<T*>(what)->~T(); },
+		});
+		return index;
+	}
+
+	template <typename... COMPONENTS>
+	ComponentMask ComponentMaskOf()
+	{
+		return ((ComponentMask{ 1 } << ComponentIndex<COMPONENTS>()) | ... | ComponentMask{});
+	}
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include "EntityPool_.h"
+#include <mutex>
+#include <thread>
+#include <memory>
+#include <atomic>
+
+namespace gamelib
+{
+	/// Records changes to an `EntityPool` that can't be made right away, eg. from systems running on worker threads.
+	/// Every thread records into its own buffer (see `Local`), so recording takes no locks after the first call on a thread.
+	/// `Playback` applies everything at a sync point, when no thread is recording.
+	template <typename ENTITY_TYPE>
+	class EntityCommandBuffers
+	{
+	public:
+
+		class Buffer
+		{
+		public:
+
+			void Spawn(ENTITY_TYPE entity) { mSpawns.push_back(std::move(entity)); }
+			/// Ignored on playback if the entity is already gone; its ID never refers to an entity spawned since
+			void Destroy(EntityID id) { mDestroys.push_back(id); }
+
+			/// `func(ENTITY_TYPE&)` is called on playback if the entity is still in the pool (and was flushed); its groups are re-evaluated afterwards
+			template <typename FUNC>
+			void Modify(EntityID id, FUNC&& func) { mModifications.push_back({ id, std::forward<FUNC>(func) }); }
+
+			bool Empty() const noexcept { return mSpawns.empty() && mDestroys.empty() && mModifications.empty(); }
+
+		private:
+
+			friend class EntityCommandBuffers;
+
+			struct Modification
+			{
+				EntityID ID;
+				std::function<void(ENTITY_TYPE&)> Apply;
+			};
+
+			std::vector<ENTITY_TYPE> mSpawns;
+			std::vector<EntityID> mDestroys;
+			std::vector<Modification> mModifications;
+
+			void Clear()
+			{
+				mSpawns.clear();
+				mDestroys.clear();
+				mModifications.clear();
+			}
+		};
+
+		EntityCommandBuffers() = default;
+		EntityCommandBuffers(EntityCommandBuffers const&) = delete;
+		EntityCommandBuffers& operator=(EntityCommandBuffers const&) = delete;
+
+		/// The buffer of the calling thread
+		Buffer& Local();
+
+		/// Applies all recorded commands in batches: first modifications, in the order of the entities in the pool
+		/// (modifications of one entity are applied in the order they were recorded on each thread; the order between threads is unspecified),
+		/// then destructions, then spawns, which are flushed into the pool.
+		/// Must not be called while other threads are recording.
+		void Playback(EntityPool<ENTITY_TYPE>& pool);
+
+		bool Empty() const
+		{
+			std::lock_guard lock{ mMutex };
+			return std::ranges::all_of(mBuffers, [](auto const& buffer) { return buffer.second->Empty(); });
+		}
+
+	private:
+
+		mutable std::mutex mMutex;
+		std::vector<std::pair<std::thread::id, std::unique_ptr<Buffer>>> mBuffers;
+
+		/// Identifies this object in the per-thread cache, as addresses can be reused by later objects
+		const uint64_t mInstance = NextInstance++;
+		static inline std::atomic<uint64_t> NextInstance = 1;
+
+		struct PendingModification
+		{
+			ENTITY_TYPE* Entity;
+			uint32_t BufferIndex;
+			uint32_t Order;
+		};
+
+		/// Scratch space for playback
+		std::vector<PendingModification> mPendingModifications;
+		std::vector<EntityID> mPendingDestroys;
+	};
+
+	template <typename ENTITY_TYPE>
+	auto EntityCommandBuffers<ENTITY_TYPE>::Local() -> Buffer&
+	{
+		/// Remembers the buffer this thread used last, so the lookup is only done when switching between command buffer sets
+		thread_local struct { uint64_t Instance = 0; Buffer* LocalBuffer = nullptr; } cached;
+		if (cached.Instance == mInstance)
+			return *cached.LocalBuffer;
+
+		std::lock_guard lock{ mMutex };
+		const auto thread = std::this_thread::get_id();
+		auto it = std::ranges::find(mBuffers, thread, [](auto const& buffer) { return buffer.first; });
+		if (it == mBuffers.end())
+		{
+			mBuffers.emplace_back(thread, std::make_unique<Buffer>());
+			it = std::prev(mBuffers.end());
+		}
+
+		cached = { mInstance, it->second.get() };
+		return *cached.LocalBuffer;
+	}
+
+	template <typename ENTITY_TYPE>
+	void EntityCommandBuffers<ENTITY_TYPE>::Playback(EntityPool<ENTITY_TYPE>& pool)
+	{
+		std::lock_guard lock{ mMutex };
+
+		/// Modifications sorted by where their entity is in the pool, so they're applied in one forward sweep over memory
+		mPendingModifications.clear();
+		for (uint32_t buffer = 0; buffer < mBuffers.size(); ++buffer)
+		{
+			auto const& modifications = mBuffers[buffer].second->mModifications;
+			for (uint32_t order = 0; order < modifications.size(); ++order)
+			{
+				if (const auto entity = pool.Get(modifications[order].ID))
+					mPendingModifications.push_back({ entity, buffer, order });
+			}
+		}
+		std::ranges::sort(mPendingModifications, [](PendingModification const& a, PendingModification const& b) {
+			return std::tie(a.Entity, a.BufferIndex, a.Order) < std::tie(b.Entity, b.BufferIndex, b.Order);
+		});
+		for (size_t i = 0; i < mPendingModifications.size(); ++i)
+		{
+			auto const& modification = mPendingModifications[i];
+			mBuffers[modification.BufferIndex].second->mModifications[modification.Order].Apply(*modification.Entity);
+			const auto last_of_entity = i + 1 == mPendingModifications.size() || mPendingModifications[i + 1].Entity != modification.Entity;
+			if (last_of_entity)
+				pool.Queue(pool.IDOf(*modification.Entity));
+		}
+
+		mPendingDestroys.clear();
+		for (auto const& [thread, buffer] : mBuffers)
+			mPendingDestroys.insert(mPendingDestroys.end(), buffer->mDestroys.begin(), buffer->mDestroys.end());
+		std::ranges::sort(mPendingDestroys);
+		mPendingDestroys.erase(std::unique(mPendingDestroys.begin(), mPendingDestroys.end()), mPendingDestroys.end());
+		for (auto id : mPendingDestroys)
+			pool.Remove(id);
+
+		for (auto const& [thread, buffer] : mBuffers)
+		{
+			for (auto& entity : buffer->mSpawns)
+				pool.Add(std::move(entity));
+			buffer->Clear();
+		}
+
+		pool.Flush();
+	}
+}
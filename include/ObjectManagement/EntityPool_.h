@@ -1,11 +1,16 @@
 #pragma once
 
 #include "../Common.h"
+#include "../Includes/Assuming.h"
+#include "SystemScheduler.h"
+#include "../../Signals.h"
 #include <vector>
 #include <map>
 #include <string>
 #include <functional>
 #include <set>
+#include <utility>
+#include <algorithm>
 
 /// Shamelessly stolen from: https://github.com/tesselode/nata/
 namespace gamelib
@@ -19,22 +24,51 @@ namespace gamelib
 			return std::addressof(ptr);
 	}
 
+	/// Stable identifier of an entity in an `EntityPool`; unlike the entity's position in the pool, it doesn't change when other entities are removed.
+	/// The low half is the index of the ID's slot, the high half the generation of the slot, which is bumped when the slot is freed,
+	/// so the IDs of removed entities don't refer to the entities that reuse their slots.
+	enum class EntityID : uint64_t { Invalid = ~uint64_t{} };
+
+	constexpr uint32_t IndexOf(EntityID id) noexcept { return uint32_t(uint64_t(id)); }
+	constexpr uint32_t GenerationOf(EntityID id) noexcept { return uint32_t(uint64_t(id) >> 32); }
+	constexpr EntityID MakeEntityID(uint32_t index, uint32_t generation) noexcept { return EntityID(uint64_t(generation) << 32 | index); }
+
 	template <typename ENTITY_TYPE>
 	struct EntityEventReceiver
 	{
-		std::function<void(ENTITY_TYPE&)> Added;
-		std::function<void(ENTITY_TYPE&)> Removed;
-		std::function<void(std::string_view, ENTITY_TYPE&)> AddedToGroup;
-		std::function<void(std::string_view, ENTITY_TYPE&)> RemovedFromGroup;
+		Signal<ENTITY_TYPE&> Added;
+		Signal<ENTITY_TYPE&> Removed;
+		Signal<std::string_view, ENTITY_TYPE&> AddedToGroup;
+		Signal<std::string_view, ENTITY_TYPE&> RemovedFromGroup;
 	};
 
 	template <typename ENTITY_TYPE>
 	struct EntityGroupOptions
 	{
+		/// If empty, all entities are in the group
 		std::function<bool(ENTITY_TYPE const&)> Filter;
+		/// If set, members of the group are kept ordered by this comparator: new members are inserted in place,
+		/// and members marked as changed (see `EntityPool::MarkChanged`) are moved to their place on `Flush`
 		std::function<bool(ENTITY_TYPE const&, ENTITY_TYPE const&)> Sort;
 	};
 
+	template <typename ENTITY_TYPE>
+	struct SystemDefinition
+	{
+		std::string Name;
+
+		/// Components (see `ComponentMaskOf`) the system reads and writes. The component types can just be tags for parts of the entity.
+		/// Systems whose accesses don't conflict run concurrently, so the system must not touch anything it didn't declare.
+		ComponentMask Reads = 0;
+		ComponentMask Writes = 0;
+
+		/// If not empty, `Update` is only called for entities in this group
+		std::string Group;
+
+		/// Called for every entity (in the group). Must not add or remove entities.
+		std::function<void(ENTITY_TYPE&)> Update;
+	};
+
 	template <typename ENTITY_TYPE>
 	struct EntityPoolOptions
 	{
@@ -42,120 +76,543 @@ namespace gamelib
 		std::vector<SystemDefinition<ENTITY_TYPE>> Systems;
 	};
 
+	/// Entities are stored densely, and each of them knows its slot in every group,
+	/// so membership checks, group updates and removals are O(1) (removal doesn't preserve order).
+	/// Sorted groups are the exception: inserting into or removing from them shifts the members after the slot.
 	template <typename ENTITY_TYPE>
 	struct EntityPool : EntityEventReceiver<ENTITY_TYPE>
 	{
 		using entity_ptr = decltype(to_address(*(ENTITY_TYPE*)nullptr));
 
-		void Flush()
+		EntityPool() = default;
+		explicit EntityPool(EntityPoolOptions<ENTITY_TYPE> options)
 		{
-			auto to_flush = std::move(mQueue);
-			for (auto& entity : to_flush)
-			{
-				auto ptr = to_address(entity);
-				if (!Contains(ptr))
+			for (auto& [name, group] : options.Groups)
+				AddGroup(name, std::move(group));
+			for (auto& system : options.Systems)
+				AddSystem(std::move(system));
+		}
+
+		/// Systems refer to the pool, so it can't be copied
+		EntityPool(EntityPool const&) = delete;
+		EntityPool& operator=(EntityPool const&) = delete;
+
+		/// Emitted by `Flush` with all the entities it added, before their individual `Added` events.
+		/// Every listener gets the same span, so entities its listeners remove are only removed after all of them ran
+		/// (see `Remove`); listeners must not flush the pool.
+		Signal<std::span<ENTITY_TYPE>> AddedBatch;
+
+		/// Systems that access the same components run in the order they were added
+		void AddSystem(SystemDefinition<ENTITY_TYPE> definition)
+		{
+			auto run = [this, group = std::move(definition.Group), update = std::move(definition.Update)] {
+				if (group.empty())
 				{
-					mEntities.push_back(std::move(entity));
-					ptr = to_address(mEntities.back());
+					for (auto& entity : mEntities)
+						update(entity);
 				}
-				Emit(&EntityEventReceiver<ENTITY_TYPE>::Added, *ptr);
+				else
+					ForEachInGroup(group, update);
+			};
+			mSystems.Add(std::move(definition.Name), definition.Reads, definition.Writes, std::move(run));
+		}
+
+		/// Runs every system once over the flushed entities, concurrently where their component accesses allow
+		void RunSystems(WorkStealingPool& pool) { mSystems.Run(pool); }
+		void RunSystemsSerially() { mSystems.RunSerially(); }
+
+		SystemScheduler& Systems() noexcept { return mSystems; }
+		SystemScheduler const& Systems() const noexcept { return mSystems; }
+
+		/// Groups should be added before entities, but if they're not, existing entities are filtered into the group immediately
+		void AddGroup(std::string name, EntityGroupOptions<ENTITY_TYPE> options)
+		{
+			Assuming(!mGroupsByName.contains(name));
+			const auto group_index = mGroups.size();
+			mGroupsByName.emplace(name, group_index);
+			mGroups.push_back({ std::move(name), std::move(options) });
+
+			/// Widen the per-entity slot table by one column
+			const auto old_count = group_index;
+			std::vector<uint32_t> slots(mEntities.size() * mGroups.size(), NotInGroup);
+			for (size_t entity = 0; entity < mEntities.size(); ++entity)
+				std::copy_n(mGroupSlots.begin() + entity * old_count, old_count, slots.begin() + entity * mGroups.size());
+			mGroupSlots = std::move(slots);
 
-				for (auto& [name, group] : mGroups)
+			for (uint32_t entity = 0; entity < mEntities.size(); ++entity)
+				UpdateGroup(group_index, entity);
+		}
+
+		/// Queues the entity to be added on the next `Flush`. The returned ID is valid immediately.
+		EntityID Add(ENTITY_TYPE entity)
+		{
+			const auto id = AllocateID();
+			mIDSlots[IndexOf(id)].DenseIndex = Queued;
+			mQueue.emplace_back(id, std::move(entity));
+			return id;
+		}
+
+		/// Queues an entity that's already in the pool to have its group membership re-evaluated on the next `Flush` (eg. after it changed)
+		void Queue(EntityID id)
+		{
+			if (!IsFlushed(id))
+				return;
+			mRequeued.push_back(id);
+			MarkChanged(id);
+		}
+
+		/// Marks that the entity changed in a way that may affect its order in sorted groups; it's moved to its place on the next `Flush`.
+		/// Unlike `Queue`, doesn't re-evaluate group membership.
+		void MarkChanged(EntityID id)
+		{
+			if (!IsFlushed(id))
+				return;
+			const auto index = DenseIndexOf(id);
+			for (size_t group = 0; group < mGroups.size(); ++group)
+			{
+				if (mGroups[group].Options.Sort && GroupSlot(index, group) != NotInGroup)
+					mGroups[group].Changed.push_back(id);
+			}
+		}
+
+		/// Re-sorts the changed members of sorted groups; called by `Flush`
+		void SortGroups()
+		{
+			for (size_t group = 0; group < mGroups.size(); ++group)
+			{
+				if (!mGroups[group].Changed.empty())
+					SortChanged(group);
+			}
+		}
+
+		void Flush()
+		{
+			auto to_add = std::move(mQueue);
+			auto to_update = std::move(mRequeued);
+			const auto first_added = mEntities.size();
+
+			for (auto& [id, entity] : to_add)
+			{
+				/// Removed before it was flushed
+				if (DenseIndexOf(id) == Cancelled)
 				{
-					if (!group.Options.Filter && group.Options.Filter(*ptr))
-					{
-						if (!Contains(group.Entities, ptr))
-						{
-							group.Entities.push_back(ptr);
-							Emit(&EntityEventReceiver<ENTITY_TYPE>::AddedToGroup, name, *ptr);
-						}
-					}
-					else if (Contains(group.Entities, ptr))
-					{
-						Erase(group.Entities, ptr);
-						Emit(&EntityEventReceiver<ENTITY_TYPE>::RemovedFromGroup, name, *ptr);
-					}
+					FreeID(id);
+					continue;
 				}
+
+				const auto index = uint32_t(mEntities.size());
+				mEntities.push_back(std::move(entity));
+				mIDs.push_back(id);
+				mGroupSlots.resize(mGroupSlots.size() + mGroups.size(), NotInGroup);
+				mIDSlots[IndexOf(id)].DenseIndex = index;
+			}
+
+			/// The new entities are contiguous at the end of the pool until a listener removes one, so the batch goes first,
+			/// with removals deferred until all of its listeners ran; the per-entity events go by ID, since listeners can remove entities
+			auto added_ids = std::move(mAddedIDs);
+			added_ids.assign(mIDs.begin() + first_added, mIDs.end());
+			if (AddedBatch && first_added < mEntities.size())
+			{
+				++mDeferringRemovals;
+				AddedBatch(std::span{ mEntities }.subspan(first_added));
+				--mDeferringRemovals;
+				RemoveDeferred();
 			}
+
+			for (auto id : added_ids)
+			{
+				if (!IsFlushed(id))
+					continue;
+				Emit(&EntityEventReceiver<ENTITY_TYPE>::Added, mEntities[DenseIndexOf(id)]);
+				if (IsFlushed(id))
+					UpdateGroups(DenseIndexOf(id));
+			}
+			mAddedIDs = std::move(added_ids);
+
+			for (auto id : to_update)
+			{
+				if (IsFlushed(id))
+					UpdateGroups(DenseIndexOf(id));
+			}
+
+			SortGroups();
 		}
 
-		template <typename FUNC>
-		void RemoveIf(FUNC&& predicate)
+		/// Removes the entity immediately (or cancels its addition, if it wasn't flushed yet).
+		/// Removals requested by listeners of the removal events (eg. a parent removing its children) are deferred until the
+		/// entity that emitted them is gone, as they would move it; they're done before the outermost `Remove` returns.
+		/// Returns false if the entity isn't in the pool, or is already being removed.
+		bool Remove(EntityID id)
 		{
-			for (auto& [name, group] : mGroups)
+			if (!Contains(id))
+				return false;
+
+			/// The ID is only freed when the queue is flushed, so it can't be reused while still in the queue
+			auto& slot = mIDSlots[IndexOf(id)];
+			if (slot.DenseIndex == Queued)
 			{
-				std::erase_if(group.Entities, [&](entity_ptr entity) {
-					if (predicate(entity))
-					{
-						Emit(&EntityEventReceiver<ENTITY_TYPE>::RemovedFromGroup, name, entity);
-						return true;
-					}
+				slot.DenseIndex = Cancelled;
+				return true;
+			}
+
+			if (mDeferringRemovals)
+			{
+				if (std::ranges::find(mDeferredRemovals, id) != mDeferredRemovals.end())
 					return false;
-				});
+				mDeferredRemovals.push_back(id);
+				return true;
 			}
 
-			std::erase_if(mEntities, [&](ENTITY_TYPE const& entity) {
-				if (predicate(entity))
+			RemoveAt(slot.DenseIndex);
+			RemoveDeferred();
+			return true;
+		}
+
+		template <typename FUNC>
+		void RemoveIf(FUNC&& predicate)
+		{
+			/// Iterating backwards, so the entity swapped into a removed slot has already been checked.
+			/// Deferred removals can shrink the pool past the current index; the entities they swap into lower slots are still checked.
+			for (auto index = uint32_t(mEntities.size()); index-- > 0;)
+			{
+				if (index < mEntities.size() && predicate(std::as_const(mEntities[index])))
 				{
-					Emit(&EntityEventReceiver<ENTITY_TYPE>::Removed, entity);
-					return true;
+					RemoveAt(index);
+					RemoveDeferred();
 				}
-				return false;
-			});
+			}
 		}
 
-		bool Contains(entity_ptr ptr) const
+		/// Returns whether the ID refers to an entity in the pool, or one queued to be added; false for the IDs of removed entities,
+		/// and of the entity whose removal events are being emitted
+		bool Contains(EntityID id) const noexcept
 		{
-			return Contains(mEntities, ptr);
+			const auto index = DenseIndexOf(id);
+			return index != Free && index != Cancelled && id != mRemovingID;
 		}
 
-		bool Contains(ENTITY_TYPE const& entity) const
+		/// Returns whether the entity is in the given group; O(1)
+		bool IsInGroup(EntityID id, std::string_view group_name) const
+		{
+			const auto group = FindGroup(group_name);
+			return group != NotInGroup && IsFlushed(id) && GroupSlot(DenseIndexOf(id), group) != NotInGroup;
+		}
+
+		ENTITY_TYPE* Get(EntityID id) noexcept
+		{
+			const auto index = DenseIndexOf(id);
+			return index < Cancelled ? &mEntities[index] : nullptr;
+		}
+		ENTITY_TYPE const* Get(EntityID id) const noexcept
 		{
-			return Contains(mEntities, entity);
+			const auto index = DenseIndexOf(id);
+			return index < Cancelled ? &mEntities[index] : nullptr;
+		}
+
+		/// Entities in the pool, in no particular order
+		std::span<ENTITY_TYPE> Entities() noexcept { return mEntities; }
+		std::span<ENTITY_TYPE const> Entities() const noexcept { return mEntities; }
+		EntityID IDOf(size_t index) const noexcept { return mIDs[index]; }
+		/// The entity must be in the pool (eg. the one passed to a system's `Update`)
+		EntityID IDOf(ENTITY_TYPE const& entity) const noexcept { return mIDs[&entity - mEntities.data()]; }
+
+		size_t GroupSize(std::string_view group_name) const
+		{
+			const auto group = FindGroup(group_name);
+			return group != NotInGroup ? mGroups[group].Members.size() : 0;
+		}
+
+		template <typename FUNC>
+		void ForEachInGroup(std::string_view group_name, FUNC&& func)
+		{
+			const auto group = FindGroup(group_name);
+			if (group == NotInGroup)
+				return;
+			for (auto index : mGroups[group].Members)
+				func(mEntities[index]);
 		}
 
 	private:
 
+		static constexpr uint32_t NotInGroup = ~uint32_t{};
+		static constexpr uint32_t Free = ~uint32_t{};
+		static constexpr uint32_t Queued = Free - 1;
+		static constexpr uint32_t Cancelled = Free - 2;
+
 		struct EntityGroup
 		{
-			GroupOptions Options;
-			std::vector<entity_ptr> Entities;
+			std::string Name;
+			EntityGroupOptions<ENTITY_TYPE> Options;
+
+			/// Dense indices of the member entities
+			std::vector<uint32_t> Members;
+
+			/// Members of a sorted group whose sort key may have changed
+			std::vector<EntityID> Changed;
 		};
 
-		std::vector<ENTITY_TYPE> mQueue;
+		/// Entities, and data parallel to them
 		std::vector<ENTITY_TYPE> mEntities;
+		std::vector<EntityID> mIDs;
+		/// Slot of entity `e` in group `g` (or `NotInGroup`) is at `e * mGroups.size() + g`
+		std::vector<uint32_t> mGroupSlots;
 
-		template <typename FIELD_PTR, typename... ARGS>
-		void Emit(FIELD_PTR field, ARGS&&... args)
+		struct IDSlot
 		{
-			auto& function = (this->*field);
-			if (function)
-				function(args...);
+			/// Dense index of the entity (or `Free`/`Queued`/`Cancelled`)
+			uint32_t DenseIndex = Free;
+			/// Generation of the IDs this slot hands out
+			uint32_t Generation = 0;
+		};
+		std::vector<IDSlot> mIDSlots;
+		std::vector<uint32_t> mFreeIDSlots;
+
+		std::vector<std::pair<EntityID, ENTITY_TYPE>> mQueue;
+		std::vector<EntityID> mRequeued;
+		std::vector<EntityID> mAddedIDs;
+
+		/// While non-zero, `Remove` defers removals to `mDeferredRemovals` (see `RemoveAt` and `Flush`)
+		uint32_t mDeferringRemovals = 0;
+		std::vector<EntityID> mDeferredRemovals;
+		EntityID mRemovingID = EntityID::Invalid;
+
+		std::vector<EntityGroup> mGroups;
+		std::map<std::string, size_t, std::less<>> mGroupsByName;
+
+		SystemScheduler mSystems;
+
+		EntityID AllocateID()
+		{
+			if (!mFreeIDSlots.empty())
+			{
+				const auto index = mFreeIDSlots.back();
+				mFreeIDSlots.pop_back();
+				return MakeEntityID(index, mIDSlots[index].Generation);
+			}
+			mIDSlots.emplace_back();
+			return MakeEntityID(uint32_t(mIDSlots.size() - 1), 0);
+		}
+
+		/// Bumps the generation of the ID's slot, so the ID (and copies of it) no longer refer to anything
+		void FreeID(EntityID id)
+		{
+			auto& slot = mIDSlots[IndexOf(id)];
+			slot.DenseIndex = Free;
+			++slot.Generation;
+			mFreeIDSlots.push_back(IndexOf(id));
+		}
+
+		/// Dense index of the entity (or `Free`/`Queued`/`Cancelled`); `Free` for stale IDs
+		uint32_t DenseIndexOf(EntityID id) const noexcept
+		{
+			const auto index = IndexOf(id);
+			return index < mIDSlots.size() && mIDSlots[index].Generation == GenerationOf(id) ? mIDSlots[index].DenseIndex : Free;
+		}
+
+		bool IsFlushed(EntityID id) const noexcept { return DenseIndexOf(id) < Cancelled; }
+
+		size_t FindGroup(std::string_view name) const
+		{
+			const auto it = mGroupsByName.find(name);
+			return it != mGroupsByName.end() ? it->second : NotInGroup;
 		}
 
-		template <typename T>
-		static bool Contains(T const& span, entity_ptr ptr)
+		uint32_t& GroupSlot(uint32_t index, size_t group) noexcept { return mGroupSlots[index * mGroups.size() + group]; }
+		uint32_t GroupSlot(uint32_t index, size_t group) const noexcept { return mGroupSlots[index * mGroups.size() + group]; }
+
+		void UpdateGroups(uint32_t index)
 		{
-			return std::find_if(begin(span), end(span), [ptr](auto&& ref) {
-				return to_address(ref) == ptr;
-			}) != end(span);
+			for (size_t group = 0; group < mGroups.size(); ++group)
+				UpdateGroup(group, index);
 		}
 
-		template <typename T>
-		static bool Erase(T& span, entity_ptr ptr)
+		void UpdateGroup(size_t group_index, uint32_t index)
 		{
-			auto it = std::find_if(begin(span), end(span), [ptr](auto&& ref) {
-				return to_address(ref) == ptr;
-			});;
-			if (it != end(span))
+			auto& group = mGroups[group_index];
+			auto& slot = GroupSlot(index, group_index);
+			const auto belongs = !group.Options.Filter || group.Options.Filter(std::as_const(mEntities[index]));
+			if (belongs && slot == NotInGroup)
 			{
-				span.erase(it);
-				return true;
+				InsertIntoGroup(group_index, index);
+				Emit(&EntityEventReceiver<ENTITY_TYPE>::AddedToGroup, std::string_view{ group.Name }, mEntities[index]);
+			}
+			else if (!belongs && slot != NotInGroup)
+			{
+				RemoveFromGroup(group_index, index);
+				Emit(&EntityEventReceiver<ENTITY_TYPE>::RemovedFromGroup, std::string_view{ group.Name }, mEntities[index]);
+			}
+		}
+
+		/// Appends to the group's member list, or binary-inserts if the group is sorted (and has no pending changes)
+		void InsertIntoGroup(size_t group_index, uint32_t index)
+		{
+			auto& group = mGroups[group_index];
+			auto& members = group.Members;
+			if (!group.Options.Sort)
+			{
+				GroupSlot(index, group_index) = uint32_t(members.size());
+				members.push_back(index);
+				return;
+			}
+
+			/// Members marked as changed are out of place until `SortChanged`, so a binary search can't be trusted;
+			/// the new member is re-sorted along with them instead
+			if (!group.Changed.empty())
+			{
+				GroupSlot(index, group_index) = uint32_t(members.size());
+				members.push_back(index);
+				group.Changed.push_back(mIDs[index]);
+				return;
 			}
-			return false;
+
+			const auto position = std::upper_bound(members.begin(), members.end(), index, MemberComparator(group));
+			const auto slot = uint32_t(position - members.begin());
+			members.insert(position, index);
+			UpdateSlots(group_index, slot);
+		}
+
+		/// Swap-and-pop from the group's member list, or erases if the group is sorted
+		void RemoveFromGroup(size_t group_index, uint32_t index)
+		{
+			auto& members = mGroups[group_index].Members;
+			auto& slot = GroupSlot(index, group_index);
+			if (mGroups[group_index].Options.Sort)
+			{
+				const auto removed_slot = std::exchange(slot, NotInGroup);
+				members.erase(members.begin() + removed_slot);
+				UpdateSlots(group_index, removed_slot);
+				return;
+			}
+
+			const auto last = members.back();
+			members[slot] = last;
+			GroupSlot(last, group_index) = slot;
+			members.pop_back();
+			slot = NotInGroup;
 		}
 
-		std::map<std::string, EntityGroup, std::less<>> mGroups;
+		/// Takes the changed members out of the group, sorts them, and merges them back.
+		/// Only the part of the group from the first affected slot onwards is touched.
+		void SortChanged(size_t group_index)
+		{
+			auto& group = mGroups[group_index];
+			auto& members = group.Members;
+
+			std::vector<uint32_t> changed_slots;
+			for (auto id : std::exchange(group.Changed, {}))
+			{
+				if (!IsFlushed(id))
+					continue;
+				const auto slot = GroupSlot(DenseIndexOf(id), group_index);
+				if (slot != NotInGroup)
+					changed_slots.push_back(slot);
+			}
+			std::ranges::sort(changed_slots);
+			changed_slots.erase(std::unique(changed_slots.begin(), changed_slots.end()), changed_slots.end());
+			if (changed_slots.empty())
+				return;
+
+			/// Compact the unchanged members, keeping their order
+			std::vector<uint32_t> changed;
+			changed.reserve(changed_slots.size());
+			auto next_changed = changed_slots.begin();
+			auto write = changed_slots.front();
+			for (auto read = write; read < members.size(); ++read)
+			{
+				if (next_changed != changed_slots.end() && *next_changed == read)
+				{
+					changed.push_back(members[read]);
+					++next_changed;
+				}
+				else
+					members[write++] = members[read];
+			}
+			members.resize(write);
+
+			const auto compare = MemberComparator(group);
+			std::ranges::stable_sort(changed, compare);
+
+			/// Everything before the first removed slot, and before the place of the smallest changed member, stays where it was
+			const auto merge_start = std::min<size_t>(changed_slots.front(), std::upper_bound(members.begin(), members.end(), changed.front(), compare) - members.begin());
+			const auto clean_end = members.size();
+			members.insert(members.end(), changed.begin(), changed.end());
+			std::inplace_merge(members.begin() + merge_start, members.begin() + clean_end, members.end(), compare);
+			UpdateSlots(group_index, merge_start);
+		}
+
+		auto MemberComparator(EntityGroup const& group) const
+		{
+			return [this, &sort = group.Options.Sort](uint32_t a, uint32_t b) { return sort(mEntities[a], mEntities[b]); };
+		}
+
+		/// Updates the group slots of the entities at and after the given slot
+		void UpdateSlots(size_t group_index, size_t from_slot)
+		{
+			auto const& members = mGroups[group_index].Members;
+			for (auto slot = from_slot; slot < members.size(); ++slot)
+				GroupSlot(members[slot], group_index) = uint32_t(slot);
+		}
+
+		/// Swap-and-pop from the entity list; O(number of groups), plus the sizes of the sorted groups the entity is in
+		void RemoveAt(uint32_t index)
+		{
+			/// Listeners can't move the entity while it's being removed, as their removals are deferred
+			const auto previous_removing = std::exchange(mRemovingID, mIDs[index]);
+			++mDeferringRemovals;
+			for (size_t group = 0; group < mGroups.size(); ++group)
+			{
+				if (GroupSlot(index, group) == NotInGroup)
+					continue;
+				RemoveFromGroup(group, index);
+				Emit(&EntityEventReceiver<ENTITY_TYPE>::RemovedFromGroup, std::string_view{ mGroups[group].Name }, mEntities[index]);
+			}
+			Emit(&EntityEventReceiver<ENTITY_TYPE>::Removed, mEntities[index]);
+			--mDeferringRemovals;
+			mRemovingID = previous_removing;
+
+			FreeID(mIDs[index]);
+
+			const auto last = uint32_t(mEntities.size() - 1);
+			if (index != last)
+			{
+				mEntities[index] = std::move(mEntities[last]);
+				mIDs[index] = mIDs[last];
+				mIDSlots[IndexOf(mIDs[index])].DenseIndex = index;
+				for (size_t group = 0; group < mGroups.size(); ++group)
+				{
+					const auto slot = GroupSlot(last, group);
+					GroupSlot(index, group) = slot;
+					if (slot != NotInGroup)
+						mGroups[group].Members[slot] = index;
+				}
+			}
+
+			mEntities.pop_back();
+			mIDs.pop_back();
+			mGroupSlots.resize(mGroupSlots.size() - mGroups.size());
+		}
+
+		/// Does the removals deferred by `Remove`, including the ones their own events request
+		void RemoveDeferred()
+		{
+			if (mDeferringRemovals)
+				return;
+			for (size_t i = 0; i < mDeferredRemovals.size(); ++i)
+			{
+				const auto id = mDeferredRemovals[i];
+				if (IsFlushed(id))
+					RemoveAt(DenseIndexOf(id));
+			}
+			mDeferredRemovals.clear();
+		}
+
+		template <typename FIELD_PTR, typename... ARGS>
+		void Emit(FIELD_PTR field, ARGS&&... args)
+		{
+			auto& function = (this->*field);
+			if (function)
+				function(args...);
+		}
 	};
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,79 @@
+#include "SystemScheduler.h"
+#include "../Debugger.h"
+#include <chrono>
+
+namespace gamelib
+{
+	size_t SystemScheduler::Add(std::string name, ComponentMask reads, ComponentMask writes, std::function<void()> run)
+	{
+		const auto index = mSystems.size();
+		System system{ std::move(name), reads, writes, std::move(run) };
+
+		for (size_t other = 0; other < index; ++other)
+		{
+			auto& earlier = mSystems[other];
+			const auto conflicts = (earlier.Writes & (system.Reads | system.Writes)) != 0 || (system.Writes & earlier.Reads) != 0;
+			if (!conflicts)
+				continue;
+			system.Dependencies.push_back(other);
+			earlier.Dependents.push_back(index);
+		}
+
+		mSystems.push_back(std::move(system));
+		mRemaining = std::make_unique<std::atomic<size_t>[]>(mSystems.size());
+		return index;
+	}
+
+	void SystemScheduler::Run(WorkStealingPool& pool)
+	{
+		for (size_t i = 0; i < mSystems.size(); ++i)
+			mRemaining[i] = mSystems[i].Dependencies.size();
+
+		for (size_t i = 0; i < mSystems.size(); ++i)
+		{
+			if (mSystems[i].Dependencies.empty())
+				Schedule(pool, i);
+		}
+
+		pool.WaitIdle();
+	}
+
+	void SystemScheduler::RunSerially()
+	{
+		for (auto& system : mSystems)
+			RunTimed(system);
+	}
+
+	void SystemScheduler::Schedule(WorkStealingPool& pool, size_t system_index)
+	{
+		pool.Submit([this, &pool, system_index] {
+			auto& system = mSystems[system_index];
+			RunTimed(system);
+			for (auto dependent : system.Dependents)
+			{
+				if (--mRemaining[dependent] == 0)
+					Schedule(pool, dependent);
+			}
+		});
+	}
+
+	void SystemScheduler::RunTimed(System& system)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		if (system.Run)
+			system.Run();
+		system.Time = std::chrono::duration<seconds_t>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void SystemScheduler::ResetTimes()
+	{
+		for (auto& system : mSystems)
+			system.Time.reset();
+	}
+
+	void SystemScheduler::Debug(IDebugger& debugger)
+	{
+		for (auto& system : mSystems)
+			debugger.Value(system.Name, system.Time);
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Components.h"
+#include "../Common.h"
+#include "../Parallel.h"
+#include "../Debug/Statistics.h"
+#include <string>
+#include <vector>
+#include <functional>
+
+namespace gamelib
+{
+	struct IDebugger;
+
+	/// Runs a set of systems once per `Run`, each system declaring the components it reads and writes.
+	/// Two systems conflict if either writes a component the other one reads or writes; conflicting systems run in the order they were added,
+	/// and all others may run concurrently on a `WorkStealingPool`.
+	struct SystemScheduler
+	{
+		/// Returns the index of the system
+		size_t Add(std::string name, ComponentMask reads, ComponentMask writes, std::function<void()> run);
+
+		/// Runs every system once and waits for all of them to finish. The pool can be shared with other work.
+		void Run(WorkStealingPool& pool);
+
+		/// Runs every system once, in the order they were added, on the calling thread
+		void RunSerially();
+
+		size_t SystemCount() const noexcept { return mSystems.size(); }
+		std::string_view NameOf(size_t system) const noexcept { return mSystems[system].Name; }
+		std::span<size_t const> DependenciesOf(size_t system) const noexcept { return mSystems[system].Dependencies; }
+
+		/// How long the system took to run, in seconds
+		KPI<seconds_t> const& TimeOf(size_t system) const noexcept { return mSystems[system].Time; }
+
+		void ResetTimes();
+
+		void Debug(IDebugger& debugger);
+
+	private:
+
+		struct System
+		{
+			std::string Name;
+			ComponentMask Reads = 0;
+			ComponentMask Writes = 0;
+			std::function<void()> Run;
+
+			/// Earlier systems this one conflicts with, and later systems that conflict with it
+			std::vector<size_t> Dependencies;
+			std::vector<size_t> Dependents;
+
+			KPI<seconds_t> Time;
+		};
+
+		std::vector<System> mSystems;
+
+		/// Dependencies left to finish for each system during `Run`
+		std::unique_ptr<std::atomic<size_t>[]> mRemaining;
+
+		void RunTimed(System& system);
+		void Schedule(WorkStealingPool& pool, size_t system);
+	};
+}
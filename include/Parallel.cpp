@@ -0,0 +1,129 @@
+#include "Parallel.h"
+
+namespace gamelib
+{
+	namespace
+	{
+		/// The pool the current thread is a worker of, and the index of its queue
+		thread_local WorkStealingPool const* CurrentPool = nullptr;
+		thread_local size_t CurrentQueue = 0;
+	}
+
+	WorkStealingPool::WorkStealingPool(size_t thread_count)
+	{
+		for (size_t i = 0; i <= thread_count; ++i)
+			mQueues.push_back(std::make_unique<TaskQueue>());
+
+		mThreads.reserve(thread_count);
+		for (size_t i = 0; i < thread_count; ++i)
+			mThreads.emplace_back([this, i] { WorkerLoop(i + 1); });
+	}
+
+	WorkStealingPool::~WorkStealingPool()
+	{
+		{
+			std::lock_guard lock{ mSleepMutex };
+			mStopping = true;
+		}
+		mWake.notify_all();
+		mThreads.clear();
+	}
+
+	void WorkStealingPool::Submit(std::function<void()> task)
+	{
+		const auto queue_index = CurrentPool == this ? CurrentQueue : 0;
+		++mPending;
+		{
+			auto& queue = *mQueues[queue_index];
+			std::lock_guard lock{ queue.Mutex };
+			queue.Tasks.push_back(std::move(task));
+		}
+		++mQueued;
+		Notify();
+	}
+
+	void WorkStealingPool::WaitIdle()
+	{
+		while (mPending > 0)
+		{
+			if (TryRunOne(0))
+				continue;
+			std::unique_lock lock{ mSleepMutex };
+			mWake.wait(lock, [this] { return mPending == 0 || mQueued > 0; });
+		}
+
+		std::lock_guard lock{ mExceptionMutex };
+		if (auto exception = std::exchange(mException, nullptr))
+			std::rethrow_exception(exception);
+	}
+
+	void WorkStealingPool::WorkerLoop(size_t queue_index)
+	{
+		CurrentPool = this;
+		CurrentQueue = queue_index;
+
+		while (true)
+		{
+			if (TryRunOne(queue_index))
+				continue;
+			std::unique_lock lock{ mSleepMutex };
+			mWake.wait(lock, [this] { return mStopping || mQueued > 0; });
+			if (mStopping)
+				return;
+		}
+	}
+
+	bool WorkStealingPool::TryRunOne(size_t queue_index)
+	{
+		std::function<void()> task;
+
+		/// Newest task from our own queue, or the oldest one from someone else's
+		{
+			auto& own = *mQueues[queue_index];
+			std::lock_guard lock{ own.Mutex };
+			if (!own.Tasks.empty())
+			{
+				task = std::move(own.Tasks.back());
+				own.Tasks.pop_back();
+			}
+		}
+		for (size_t i = 1; !task && i < mQueues.size(); ++i)
+		{
+			auto& victim = *mQueues[(queue_index + i) % mQueues.size()];
+			std::lock_guard lock{ victim.Mutex };
+			if (!victim.Tasks.empty())
+			{
+				task = std::move(victim.Tasks.front());
+				victim.Tasks.pop_front();
+			}
+		}
+
+		if (!task)
+			return false;
+
+		--mQueued;
+		try
+		{
+			task();
+		}
+		catch (...)
+		{
+			std::lock_guard lock{ mExceptionMutex };
+			if (!mException)
+				mException = std::current_exception();
+		}
+
+		if (--mPending == 0)
+			Notify();
+		return true;
+	}
+
+	void WorkStealingPool::Notify()
+	{
+		/// Taking the lock ensures a thread that just checked its wait condition is already waiting
+		{
+			std::lock_guard lock{ mSleepMutex };
+		}
+		mWake.notify_all();
+	}
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <exception>
+#include <utility>
+
+namespace gamelib
+{
+	/// Function: ParallelForBatches
+	/// Calls `func(begin, end)` for consecutive ranges of at most `batch_size` elements covering [0, count).
+	/// Batches are handed out to up to `std::thread::hardware_concurrency()` threads (including the calling one).
+	/// If there is only one batch, or `batch_size` is 0, everything is done on the calling thread.
+	template <typename FUNC>
+	void ParallelForBatches(size_t count, size_t batch_size, FUNC&& func)
+	{
+		if (count == 0)
+			return;
+
+		if (batch_size == 0 || batch_size >= count)
+		{
+			func(size_t{ 0 }, count);
+			return;
+		}
+
+		const auto batch_count = (count + batch_size - 1) / batch_size;
+		const auto thread_count = std::min<size_t>(batch_count, std::max(1U, std::thread::hardware_concurrency()));
+
+		std::atomic<size_t> next_batch = 0;
+		auto worker = [&] {
+			for (auto batch = next_batch++; batch < batch_count; batch = next_batch++)
+			{
+				const auto begin = batch * batch_size;
+				func(begin, std::min(begin + batch_size, count));
+			}
+		};
+
+		{
+			std::vector<std::jthread> threads;
+			threads.reserve(thread_count - 1);
+			for (size_t i = 1; i < thread_count; ++i)
+				threads.emplace_back(worker);
+			worker();
+		}
+	}
+
+	/// A fixed set of worker threads, each with its own task queue.
+	/// Tasks submitted from a worker go to the back of its queue, and it takes its newest task first (so dependent work stays hot in its cache);
+	/// a worker with an empty queue steals the oldest task from another queue. Tasks submitted from other threads go to a shared queue.
+	class WorkStealingPool
+	{
+	public:
+
+		/// Uses `std::thread::hardware_concurrency() - 1` workers by default, as the thread calling `WaitIdle` works too
+		explicit WorkStealingPool(size_t thread_count = DefaultThreadCount());
+		~WorkStealingPool();
+
+		WorkStealingPool(WorkStealingPool const&) = delete;
+		WorkStealingPool& operator=(WorkStealingPool const&) = delete;
+
+		/// Can be called from within a task
+		void Submit(std::function<void()> task);
+
+		/// Runs tasks on the calling thread until all submitted tasks (including ones submitted by tasks) are finished.
+		/// Rethrows the first exception thrown by a task, if any.
+		void WaitIdle();
+
+		size_t ThreadCount() const noexcept { return mThreads.size(); }
+
+		static size_t DefaultThreadCount() noexcept { return std::max(1U, std::thread::hardware_concurrency()) - 1; }
+
+	private:
+
+		struct TaskQueue
+		{
+			std::mutex Mutex;
+			std::deque<std::function<void()>> Tasks;
+		};
+
+		/// Queue 0 is for tasks submitted from outside the pool, queue `i + 1` belongs to worker `i`
+		std::vector<std::unique_ptr<TaskQueue>> mQueues;
+		std::vector<std::jthread> mThreads;
+
+		/// Tasks waiting in the queues, and tasks not yet finished
+		std::atomic<size_t> mQueued = 0;
+		std::atomic<size_t> mPending = 0;
+
+		std::mutex mSleepMutex;
+		std::condition_variable mWake;
+		bool mStopping = false;
+
+		std::mutex mExceptionMutex;
+		std::exception_ptr mException;
+
+		void WorkerLoop(size_t queue_index);
+		bool TryRunOne(size_t queue_index);
+		void Notify();
+	};
+}
@@ -39,6 +39,57 @@ namespace gamelib::random
 		return dist(rng) + 1;
 	}
 
+	/// A counter-based random number generator: the n-th number of a stream is a pure function of (Key, n),
+	/// so batches can be generated without a dependency between iterations, and streams can be skipped ahead in O(1).
+	/// Uses the SplitMix64 mixing function. Satisfies `std::uniform_random_bit_generator`.
+	struct CounterRNG
+	{
+		using result_type = uint64_t;
+
+		uint64_t Key = 0;
+		uint64_t Counter = 0;
+
+		constexpr CounterRNG() noexcept = default;
+		constexpr explicit CounterRNG(uint64_t seed) noexcept : Key(seed) {}
+
+		static constexpr result_type min() noexcept { return 0; }
+		static constexpr result_type max() noexcept { return ~result_type{}; }
+
+		static constexpr uint64_t Mix(uint64_t z) noexcept
+		{
+			z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+			z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+			return z ^ (z >> 31);
+		}
+
+		constexpr result_type At(uint64_t counter) const noexcept { return Mix(Key + counter * 0x9e3779b97f4a7c15ULL); }
+		constexpr result_type operator()() noexcept { return At(Counter++); }
+
+		/// Reserves `count` consecutive counters and returns the first one
+		constexpr uint64_t Skip(uint64_t count) noexcept { const auto first = Counter; Counter += count; return first; }
+	};
+
+	/// Returns 64 uniformly distributed bits, without going through a distribution if the generator already produces them
+	template <typename RANDOM>
+	uint64_t Bits(RANDOM& rng)
+	{
+		using engine = std::remove_cvref_t<RANDOM>;
+		if constexpr (engine::min() == 0 && engine::max() == std::numeric_limits<uint64_t>::max())
+			return rng();
+		else
+			return Integer(rng);
+	}
+
+	/// Converts the top bits of `bits` to a real number in [0, 1)
+	template <std::floating_point T>
+	constexpr T UnitReal(uint64_t bits) noexcept
+	{
+		if constexpr (sizeof(T) <= sizeof(float))
+			return T(bits >> 40) * T(0x1p-24);
+		else
+			return T(bits >> 11) * T(0x1p-53);
+	}
+
 	namespace
 	{
 		inline static std::default_random_engine DefaultRandomEngine;
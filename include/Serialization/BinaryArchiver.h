@@ -0,0 +1,426 @@
+#pragma once
+
+#include "IArchiver.h"
+#include "../Buffers.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <cstring>
+#include <bit>
+
+namespace gamelib::archive
+{
+	/// How `BinaryArchiver` lays out fields
+	enum class BinaryFormat : uint8_t
+	{
+		/// Just the values, in the order they are archived; loading needs the exact same types and field order
+		Compact,
+		/// Every field is prefixed with its ID (an index into a table of field names at the start of the archive) and its size,
+		/// so fields can be added, removed and reordered between versions: unknown fields are skipped, missing ones left untouched
+		FieldIDs,
+	};
+
+	static_assert(std::endian::native == std::endian::little, "BinaryArchiver writes values as they are in memory");
+
+	namespace detail
+	{
+		template <typename T>
+		struct is_binary_string : std::false_type {};
+		template <typename CHAR, typename TRAITS, typename ALLOC>
+		struct is_binary_string<std::basic_string<CHAR, TRAITS, ALLOC>> : std::true_type {};
+
+		template <typename T>
+		struct is_binary_vector : std::false_type {};
+		template <typename T, typename ALLOC>
+		struct is_binary_vector<std::vector<T, ALLOC>> : std::true_type {};
+		/// `std::vector<bool>` isn't contiguous
+		template <typename ALLOC>
+		struct is_binary_vector<std::vector<bool, ALLOC>> : std::false_type {};
+
+		inline void AppendVarint(std::string& to, uint64_t value)
+		{
+			char bytes[10];
+			size_t count = 0;
+			while (value >= 0x80)
+			{
+				bytes[count++] = char(value | 0x80);
+				value >>= 7;
+			}
+			bytes[count++] = char(value);
+			to.append(bytes, count);
+		}
+	}
+
+	/// Saves values as their raw little-endian bytes, and loads them back.
+	/// Trivially copyable values (numbers, enums, vectors, POD structs) are memcpy'd, as are `std::string`s and `std::vector`s
+	/// of trivially copyable elements, after their varint-encoded length. Other vectors are archived element by element,
+	/// and other types need an `Archive(ARCHIVER&)` member, like the top-level object.
+	/// When saving, the archive is built in `Data`, then written to an output buffer with `WriteTo`.
+	/// When loading, the archive is read from contiguous memory, which has to outlive the archiver.
+	struct BinaryArchiver : IArchiver<BinaryArchiver>
+	{
+		/// The fields, without the header and field table
+		std::string Data;
+
+		/// For saving
+		explicit BinaryArchiver(IErrorReporter& reporter, BinaryFormat format = BinaryFormat::Compact)
+			: IArchiver(reporter, Mode::Saving), mFormat(format)
+		{
+		}
+
+		/// For loading; reads the header and field table
+		BinaryArchiver(IErrorReporter& reporter, std::span<char const> from)
+			: IArchiver(reporter, Mode::Loading), mInput(from.data(), from.size())
+		{
+			uint8_t format = 0;
+			ReadBytes(&format, 1, "header");
+			if (format > uint8_t(BinaryFormat::FieldIDs))
+				mReporter.ThrowError("Unknown binary archive format {}", format);
+			mFormat = BinaryFormat(format);
+
+			if (mFormat == BinaryFormat::FieldIDs)
+			{
+				mFieldNames.resize(ReadVarint("field table"));
+				for (auto& name : mFieldNames)
+					name = ReadSpan(ReadVarint("field table"), "field table");
+				mObjects.push_back({ mInput, 0 });
+			}
+		}
+
+		BinaryFormat Format() const noexcept { return mFormat; }
+
+		/// Appends the header, field table and fields to an output buffer; returns the number of bytes appended
+		template <typename BUFFER>
+		size_t WriteTo(BUFFER& output) const
+		{
+			std::string header(1, char(mFormat));
+			if (mFormat == BinaryFormat::FieldIDs)
+			{
+				detail::AppendVarint(header, mFieldNames.size());
+				for (auto const& name : mFieldNames)
+				{
+					detail::AppendVarint(header, name.size());
+					header += name;
+				}
+			}
+			return buffer_append_read_chunk(output, std::span<char const>{ header }) + buffer_append_read_chunk(output, std::span<char const>{ Data });
+		}
+
+		template <typename T>
+		void Value(std::string_view name, T& val)
+		{
+			switch (mMode)
+			{
+			case Mode::Saving:
+				if (mFormat == BinaryFormat::Compact)
+					Save(val);
+				else
+				{
+					detail::AppendVarint(Data, FieldID(name));
+					BeginObject();
+					Save(val);
+					EndObject();
+				}
+				break;
+			case Mode::Loading:
+				if (mFormat == BinaryFormat::Compact)
+					Load(name, val);
+				else if (const auto field = FindField(name); field.data())
+					LoadObject(field, name, val);
+				break;
+			case Mode::Modeling:
+				ModelField(name, val);
+				break;
+			case Mode::Updating:
+			default:
+				break;
+			}
+		}
+
+	private:
+
+		BinaryFormat mFormat = BinaryFormat::Compact;
+
+		/// Indexed by field ID
+		std::vector<std::string> mFieldNames;
+
+		/// Saving
+		std::map<std::string, uint64_t, std::less<>> mFieldIDs;
+		/// The ID of the field archived after each field last time, which is almost always the next one,
+		/// as records archive their fields in the same order
+		std::vector<uint64_t> mNextFieldIDs = { 0 };
+		uint64_t mPreviousFieldID = 0;
+		/// Where the payloads of the fields being saved start in `Data`, so their sizes can be written before them
+		std::vector<size_t> mObjectStarts;
+
+		/// Loading
+		std::string_view mInput;
+		struct Object
+		{
+			std::string_view Fields;
+			/// Offset of the field after the last one loaded, which is most likely the next one
+			size_t Cursor = 0;
+		};
+		std::vector<Object> mObjects;
+
+		uint64_t FieldID(std::string_view name)
+		{
+			auto id = mNextFieldIDs[mPreviousFieldID];
+			if (id >= mFieldNames.size() || mFieldNames[id] != name)
+			{
+				auto it = mFieldIDs.find(name);
+				if (it == mFieldIDs.end())
+				{
+					it = mFieldIDs.emplace(std::string{ name }, mFieldNames.size()).first;
+					mFieldNames.emplace_back(name);
+					mNextFieldIDs.resize(std::max(mNextFieldIDs.size(), mFieldNames.size()));
+				}
+				id = mNextFieldIDs[mPreviousFieldID] = it->second;
+			}
+			return mPreviousFieldID = id;
+		}
+
+		/// Leaves a byte for the size of the payload, which is enough for most fields
+		void BeginObject()
+		{
+			Data += '\0';
+			mObjectStarts.push_back(Data.size());
+		}
+
+		void EndObject()
+		{
+			const auto start = mObjectStarts.back();
+			mObjectStarts.pop_back();
+			const auto size = Data.size() - start;
+			if (size < 0x80)
+				Data[start - 1] = char(size);
+			else
+			{
+				std::string encoded;
+				detail::AppendVarint(encoded, size);
+				Data.replace(start - 1, 1, encoded);
+			}
+		}
+
+		void WriteBytes(void const* data, size_t size)
+		{
+			Data.append(static_cast<char const*>(data), size);
+		}
+
+		template <typename T>
+		static constexpr bool is_memcpyable = std::is_trivially_copyable_v<T> && !std::is_pointer_v<T>;
+
+		/// Records are archived field by field in the versioned format, so their fields can change between versions
+		template <typename T>
+		bool IsRaw() const noexcept
+		{
+			if constexpr (!is_memcpyable<T>)
+				return false;
+			else if constexpr (detail::archivable_record<T, BinaryArchiver>)
+				return mFormat == BinaryFormat::Compact;
+			else
+				return true;
+		}
+
+		template <typename T>
+		void Save(T const& val)
+		{
+			using value_type = std::remove_cvref_t<T>;
+			static_assert(!std::is_pointer_v<value_type>, "pointers cannot be archived");
+			if constexpr (detail::is_binary_string<value_type>::value)
+			{
+				detail::AppendVarint(Data, val.size());
+				WriteBytes(val.data(), val.size() * sizeof(typename value_type::value_type));
+			}
+			else if constexpr (detail::is_binary_vector<value_type>::value)
+			{
+				using element_type = typename value_type::value_type;
+				detail::AppendVarint(Data, val.size());
+				if (IsRaw<element_type>())
+					WriteBytes(val.data(), val.size() * sizeof(element_type));
+				else
+				{
+					for (auto const& element : val)
+					{
+						/// Each record gets its own list of fields
+						if (detail::archivable_record<element_type, BinaryArchiver> && mFormat == BinaryFormat::FieldIDs)
+						{
+							BeginObject();
+							Save(element);
+							EndObject();
+						}
+						else
+							Save(element);
+					}
+				}
+			}
+			else if constexpr (detail::archivable_record<value_type, BinaryArchiver>)
+			{
+				if (IsRaw<value_type>())
+					WriteBytes(&val, sizeof(val));
+				else
+					const_cast<value_type&>(val).Archive(*this);
+			}
+			else if constexpr (is_memcpyable<value_type>)
+				WriteBytes(&val, sizeof(val));
+			else
+				static_assert(!sizeof(T*), "BinaryArchiver does not support this type");
+		}
+
+		void ReadBytes(void* to, size_t size, std::string_view name)
+		{
+			std::memcpy(to, ReadSpan(size, name).data(), size);
+		}
+
+		std::string_view ReadSpan(uint64_t size, std::string_view name)
+		{
+			if (size > mInput.size())
+				mReporter.ThrowError("Binary archive ends in the middle of '{}'", name);
+			const auto result = mInput.substr(0, size_t(size));
+			mInput.remove_prefix(size_t(size));
+			return result;
+		}
+
+		uint64_t ReadVarint(std::string_view name)
+		{
+			uint64_t result = 0;
+			for (int shift = 0; shift < 64; shift += 7)
+			{
+				if (mInput.empty())
+					break;
+				const auto byte = uint8_t(mInput.front());
+				mInput.remove_prefix(1);
+				result |= uint64_t(byte & 0x7F) << shift;
+				if (!(byte & 0x80))
+					return result;
+			}
+			mReporter.ThrowError("Invalid length in '{}'", name);
+			return 0;
+		}
+
+		/// Finds the payload of the named field in the current object; the result has a null `data()` if the field isn't there
+		std::string_view FindField(std::string_view name)
+		{
+			auto& object = mObjects.back();
+			const auto rest = mInput;
+			std::string_view result;
+			/// Starting from the cursor, then wrapping around
+			for (int pass = 0; pass < 2 && !result.data(); ++pass)
+			{
+				const auto start = pass == 0 ? object.Cursor : 0;
+				const auto end = pass == 0 ? object.Fields.size() : object.Cursor;
+				mInput = object.Fields.substr(start, end - start);
+				while (!mInput.empty())
+				{
+					const auto id = ReadVarint(name);
+					const auto payload = ReadSpan(ReadVarint(name), name);
+					if (id < mFieldNames.size() && mFieldNames[id] == name)
+					{
+						object.Cursor = size_t(mInput.data() - object.Fields.data());
+						result = payload;
+						break;
+					}
+				}
+			}
+			mInput = rest;
+			return result;
+		}
+
+		/// Loads the fields of a record from their own span, so reading past its end is an error instead of reading the next field
+		template <typename T>
+		void LoadObject(std::string_view fields, std::string_view name, T& val)
+		{
+			const auto rest = std::exchange(mInput, fields);
+			mObjects.push_back({ fields, 0 });
+			Load(name, val);
+			mObjects.pop_back();
+			mInput = rest;
+		}
+
+		template <typename T>
+		void Load(std::string_view name, T& val)
+		{
+			static_assert(!std::is_pointer_v<T>, "pointers cannot be archived");
+			if constexpr (detail::is_binary_string<T>::value)
+			{
+				const auto size = ReadVarint(name);
+				const auto bytes = ReadSpan(size * sizeof(typename T::value_type), name);
+				val.resize(size_t(size));
+				if (size)
+					std::memcpy(static_cast<void*>(val.data()), bytes.data(), bytes.size());
+			}
+			else if constexpr (detail::is_binary_vector<T>::value)
+			{
+				using element_type = typename T::value_type;
+				constexpr bool is_record = detail::archivable_record<element_type, BinaryArchiver>;
+				const auto size = ReadVarint(name);
+				if (IsRaw<element_type>())
+				{
+					const auto bytes = ReadSpan(size * sizeof(element_type), name);
+					val.resize(size_t(size));
+					if (size)
+						std::memcpy(static_cast<void*>(val.data()), bytes.data(), bytes.size());
+					return;
+				}
+
+				/// Every element but a compact record without fields takes at least a byte, which keeps corrupt sizes from allocating huge vectors
+				if ((!is_record || mFormat == BinaryFormat::FieldIDs) && size > mInput.size())
+					mReporter.ThrowError("Binary archive ends in the middle of '{}'", name);
+				val.resize(size_t(size));
+				for (auto& element : val)
+				{
+					if (is_record && mFormat == BinaryFormat::FieldIDs)
+						LoadObject(ReadSpan(ReadVarint(name), name), name, element);
+					else
+						Load(name, element);
+				}
+			}
+			else if constexpr (detail::archivable_record<T, BinaryArchiver>)
+			{
+				if (IsRaw<T>())
+					ReadBytes(&val, sizeof(val), name);
+				else
+					val.Archive(*this);
+			}
+			else if constexpr (is_memcpyable<T>)
+				ReadBytes(&val, sizeof(val), name);
+			else
+				static_assert(!sizeof(T*), "BinaryArchiver does not support this type");
+		}
+	};
+
+	template <typename T>
+	void Archive(BinaryArchiver& archive, std::string_view name, T& val)
+	{
+		archive.Value(name, val);
+	}
+
+	/// Saves `object` (which needs an `Archive(ARCHIVER&)` member) to an output buffer; returns the number of bytes appended
+	template <typename BUFFER, typename T>
+	size_t SaveBinary(BUFFER& output, T& object, IErrorReporter& reporter, BinaryFormat format = BinaryFormat::Compact)
+	{
+		BinaryArchiver archiver{ reporter, format };
+		object.Archive(archiver);
+		return archiver.WriteTo(output);
+	}
+
+	/// Loads `object` (which needs an `Archive(ARCHIVER&)` member) from an input buffer.
+	/// Random-access buffers are read in place and not consumed; other buffers are read whole first.
+	template <typename BUFFER, typename T>
+	void LoadBinary(BUFFER& input, T& object, IErrorReporter& reporter)
+	{
+		if constexpr (input_buffer_traits<std::remove_cvref_t<BUFFER>>::is_random_access)
+		{
+			BinaryArchiver archiver{ reporter, buffer_remaining_span(input) };
+			object.Archive(archiver);
+		}
+		else
+		{
+			std::string contents;
+			buffer_copy(input, contents);
+			BinaryArchiver archiver{ reporter, std::span<char const>{ contents } };
+			object.Archive(archiver);
+		}
+	}
+}
@@ -2,71 +2,527 @@
 
 #include "../Includes/JSON.h"
 #include "../Buffers.h"
+#include "../ErrorReporter.h"
+#include "../Parallel.h"
+#include "IArchiver.h"
 #include "../../../string_ops/include/string_ops.h"
+#include <string_view>
+#include <span>
+#include <vector>
+#include <bit>
+#include <cstring>
+#include <charconv>
+#include <tuple>
+#include <array>
+#include <optional>
+#include <atomic>
+#include <deque>
+#include <exception>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GAMELIB_CSV_SSE2 1
+#endif
 
 namespace gamelib
 {
-	template <typename BUFFER, typename ROW_CALLBACK>
-	intptr_t LoadCSV(BUFFER& buffer, ROW_CALLBACK&& row_callback)
+	namespace detail
 	{
-		bool in_quote = false;
-		intptr_t line = 0;
+		/// Bitmasks of the quotes, commas and newlines in a 64-byte block of CSV
+		struct CSVBlockMasks
+		{
+			uint64_t Quotes = 0;
+			uint64_t Commas = 0;
+			uint64_t Newlines = 0;
+		};
 
-		std::vector<std::string> row;
-		std::string current_cell;
-		char cp = 0;
-		while (buffer_read_to(buffer, cp))
+		inline CSVBlockMasks ScanCSVBlock(char const* block) noexcept
 		{
-			if (in_quote)
+			CSVBlockMasks result;
+#if defined(__AVX2__)
+			const auto quote = _mm256_set1_epi8('"'), comma = _mm256_set1_epi8(','), newline = _mm256_set1_epi8('\n');
+			for (int i = 0; i < 2; ++i)
 			{
-				if (cp == '"')
+				const auto chars = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(block + i * 32));
+				const auto shift = i * 32;
+				result.Quotes |= uint64_t(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chars, quote)))) << shift;
+				result.Commas |= uint64_t(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chars, comma)))) << shift;
+				result.Newlines |= uint64_t(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chars, newline)))) << shift;
+			}
+#elif defined(GAMELIB_CSV_SSE2)
+			const auto quote = _mm_set1_epi8('"'), comma = _mm_set1_epi8(','), newline = _mm_set1_epi8('\n');
+			for (int i = 0; i < 4; ++i)
+			{
+				const auto chars = _mm_loadu_si128(reinterpret_cast<__m128i const*>(block + i * 16));
+				const auto shift = i * 16;
+				result.Quotes |= uint64_t(uint16_t(_mm_movemask_epi8(_mm_cmpeq_epi8(chars, quote)))) << shift;
+				result.Commas |= uint64_t(uint16_t(_mm_movemask_epi8(_mm_cmpeq_epi8(chars, comma)))) << shift;
+				result.Newlines |= uint64_t(uint16_t(_mm_movemask_epi8(_mm_cmpeq_epi8(chars, newline)))) << shift;
+			}
+#else
+			for (int i = 0; i < 64; ++i)
+			{
+				const auto bit = uint64_t{ 1 } << i;
+				result.Quotes |= block[i] == '"' ? bit : 0;
+				result.Commas |= block[i] == ',' ? bit : 0;
+				result.Newlines |= block[i] == '\n' ? bit : 0;
+			}
+#endif
+			return result;
+		}
+
+		/// Bit `i` of the result is the xor of bits `0..i` of `mask`; applied to the quote mask, it gives the bytes inside quotes
+		constexpr uint64_t PrefixXor(uint64_t mask) noexcept
+		{
+			mask ^= mask << 1;
+			mask ^= mask << 2;
+			mask ^= mask << 4;
+			mask ^= mask << 8;
+			mask ^= mask << 16;
+			mask ^= mask << 32;
+			return mask;
+		}
+
+		/// Appends the contents of a cell with quotes in it, the same way the char-by-char parser reads them
+		inline void UnescapeCSVCell(std::string_view raw, std::string& to)
+		{
+			bool in_quote = false;
+			for (size_t i = 0; i < raw.size(); ++i)
+			{
+				const auto c = raw[i];
+				if (c != '"')
+					to += c;
+				else if (!in_quote)
+					in_quote = true;
+				else if (i + 1 < raw.size() && raw[i + 1] == '"')
+					to += raw[++i];
+				else
+					in_quote = false;
+			}
+		}
+	}
+
+	/// Parses CSV in place: calls `row_callback(intptr_t line, std::span<std::string_view const> cells)` for every row.
+	/// Cells point into `source`, except for cells with escaped quotes, which are unescaped into a buffer that is reused
+	/// for the next row. The delimiters are found 64 bytes at a time with SIMD bitmasks, as in simdcsv.
+	/// Lines are numbered from `first_line`. Returns the number of rows.
+	template <typename ROW_CALLBACK>
+	intptr_t LoadCSVViews(std::string_view source, ROW_CALLBACK&& row_callback, intptr_t first_line = 0)
+	{
+		intptr_t line = first_line;
+
+		std::vector<std::string_view> cells;
+		std::string unescaped;
+		/// Unescaped cells are pointed at once the row is done, as `unescaped` may reallocate while it's built
+		struct UnescapedCell { size_t Cell, Offset, Length; };
+		std::vector<UnescapedCell> unescaped_cells;
+
+		char const* const data = source.data();
+
+		const auto add_cell = [&cells, data](size_t start, size_t end, bool at_newline) {
+			auto length = end - start;
+			if (at_newline && length && data[end - 1] == '\r')
+				--length;
+			cells.emplace_back(data + start, length);
+		};
+
+		/// Quoted cells without escaped quotes still point into the source
+		const auto add_quoted_cell = [&](size_t start, size_t end, bool at_newline) {
+			auto raw = source.substr(start, end - start);
+			if (at_newline && !raw.empty() && raw.back() == '\r')
+				raw.remove_suffix(1);
+
+			if (raw.size() >= 2 && raw.front() == '"' && raw.back() == '"' && raw.substr(1, raw.size() - 2).find('"') == std::string_view::npos)
+				cells.push_back(raw.substr(1, raw.size() - 2));
+			else
+			{
+				const auto offset = unescaped.size();
+				detail::UnescapeCSVCell(raw, unescaped);
+				unescaped_cells.push_back({ cells.size(), offset, unescaped.size() - offset });
+				cells.emplace_back();
+			}
+		};
+
+		const auto finish_row = [&] {
+			if (!unescaped_cells.empty())
+			{
+				for (auto const& cell : unescaped_cells)
+					cells[cell.Cell] = std::string_view{ unescaped }.substr(cell.Offset, cell.Length);
+			}
+			row_callback(line++, std::span<std::string_view const>{ cells });
+			cells.clear();
+			if (!unescaped_cells.empty())
+			{
+				unescaped.clear();
+				unescaped_cells.clear();
+			}
+		};
+
+		size_t cell_start = 0;
+		/// All ones while the previous block ended inside quotes
+		uint64_t inside_quotes_carry = 0;
+		/// Whether the current cell had quotes in previous blocks
+		bool cell_quotes_carry = false;
+		char tail[64];
+		for (size_t block_start = 0; block_start < source.size(); block_start += 64)
+		{
+			char const* block = data + block_start;
+			if (source.size() - block_start < 64)
+			{
+				std::memset(tail, 0, sizeof(tail));
+				std::memcpy(tail, block, source.size() - block_start);
+				block = tail;
+			}
+
+			const auto masks = detail::ScanCSVBlock(block);
+			const auto inside_quotes = detail::PrefixXor(masks.Quotes) ^ inside_quotes_carry;
+			inside_quotes_carry = uint64_t(int64_t(inside_quotes) >> 63);
+
+			auto delimiters = (masks.Commas | masks.Newlines) & ~inside_quotes;
+			auto quotes = masks.Quotes;
+			while (delimiters)
+			{
+				const auto bit = std::countr_zero(delimiters);
+				const auto before = (uint64_t{ 1 } << bit) - 1;
+				const auto is_newline = (masks.Newlines >> bit) & 1;
+				const auto end = block_start + bit;
+				if (cell_quotes_carry || (quotes & before)) [[unlikely]]
+					add_quoted_cell(cell_start, end, is_newline);
+				else
+					add_cell(cell_start, end, is_newline);
+				cell_start = end + 1;
+				if (is_newline)
+					finish_row();
+				quotes &= ~before;
+				cell_quotes_carry = false;
+				delimiters &= delimiters - 1;
+			}
+			cell_quotes_carry |= quotes != 0;
+		}
+
+		/// Like the char-by-char parser, a last row without a newline ends with its last non-empty cell
+		/// (and a CR at the very end is part of that cell, as no LF follows it)
+		if (cell_start < source.size())
+		{
+			if (cell_quotes_carry)
+				add_quoted_cell(cell_start, source.size(), false);
+			else
+				add_cell(cell_start, source.size(), false);
+			const bool unescaped_last = !unescaped_cells.empty() && unescaped_cells.back().Cell == cells.size() - 1;
+			if (unescaped_last ? unescaped_cells.back().Length == 0 : cells.back().empty())
+			{
+				cells.pop_back();
+				if (unescaped_last)
+					unescaped_cells.pop_back();
+			}
+		}
+		if (!cells.empty())
+			finish_row();
+
+		return line - first_line;
+	}
+
+	namespace detail
+	{
+		/// The remaining contents of a random-access buffer
+		template <typename BUFFER>
+		std::string_view CSVSourceOf(BUFFER& buffer)
+		{
+			const auto remaining = buffer_remaining_span(buffer);
+			return std::string_view{ remaining.data(), remaining.size() };
+		}
+
+		/// What a chunk of CSV looks like if it starts outside quotes (index 0) or inside quotes (index 1)
+		struct CSVChunkScan
+		{
+			/// Offset of the first newline that ends a row, or `npos`
+			size_t FirstNewline[2] = { std::string_view::npos, std::string_view::npos };
+			/// Number of newlines that end rows
+			size_t Newlines[2] = {};
+			/// Whether the chunk flips the quote state
+			bool OddQuotes = false;
+		};
+
+		/// Counts the newlines outside quotes for both possible quote states at the start of the chunk in one go:
+		/// inside quotes for one state is outside for the other.
+		inline CSVChunkScan ScanCSVChunk(std::string_view chunk) noexcept
+		{
+			CSVChunkScan result;
+			uint64_t inside_quotes_carry = 0;
+			char tail[64];
+			for (size_t block_start = 0; block_start < chunk.size(); block_start += 64)
+			{
+				char const* block = chunk.data() + block_start;
+				auto valid = ~uint64_t{};
+				if (chunk.size() - block_start < 64)
+				{
+					std::memset(tail, 0, sizeof(tail));
+					std::memcpy(tail, block, chunk.size() - block_start);
+					block = tail;
+					valid = (uint64_t{ 1 } << (chunk.size() - block_start)) - 1;
+				}
+
+				const auto masks = ScanCSVBlock(block);
+				const auto inside_quotes = PrefixXor(masks.Quotes) ^ inside_quotes_carry;
+				inside_quotes_carry = uint64_t(int64_t(inside_quotes) >> 63);
+
+				const uint64_t newlines[2] = { masks.Newlines & ~inside_quotes & valid, masks.Newlines & inside_quotes & valid };
+				for (int state = 0; state < 2; ++state)
+				{
+					if (newlines[state] && result.FirstNewline[state] == std::string_view::npos)
+						result.FirstNewline[state] = block_start + std::countr_zero(newlines[state]);
+					result.Newlines[state] += std::popcount(newlines[state]);
+				}
+			}
+			result.OddQuotes = inside_quotes_carry != 0;
+			return result;
+		}
+	}
+
+	/// How `LoadCSVViewsParallel` delivers rows
+	enum class CSVRowOrder
+	{
+		/// One row at a time, in order, though not necessarily on the calling thread
+		InOrder,
+		/// Concurrently from the worker threads, as soon as each chunk is parsed; use the `line` argument to put rows in place
+		Any,
+	};
+
+	/// Parses CSV in place like `LoadCSVViews`, splitting it into chunks of about `chunk_size` bytes that are parsed on
+	/// multiple threads (see `ParallelForBatches`). A first parallel pass counts the row-ending newlines of each chunk both as if it
+	/// started inside and outside quotes; the quote state at each chunk boundary is then resolved by going over the chunks in order,
+	/// which tells where the first row of each chunk starts and what its line number is, so the second pass can parse the rows.
+	/// With `CSVRowOrder::InOrder`, chunks that finish before the previous ones are buffered until it's their turn.
+	/// Exceptions thrown by `row_callback` stop the delivery and are rethrown on the calling thread.
+	/// Returns the number of rows.
+	template <typename ROW_CALLBACK>
+	intptr_t LoadCSVViewsParallel(std::string_view source, ROW_CALLBACK&& row_callback, CSVRowOrder order = CSVRowOrder::InOrder, size_t chunk_size = size_t{ 1 } << 20)
+	{
+		/// Whole blocks per chunk, so only the last chunk has a partial block
+		chunk_size = std::max<size_t>((chunk_size + 63) / 64 * 64, 64);
+		const auto chunk_count = (source.size() + chunk_size - 1) / chunk_size;
+		if (chunk_count <= 1)
+			return LoadCSVViews(source, row_callback);
+
+		std::vector<detail::CSVChunkScan> scans(chunk_count);
+		ParallelForBatches(chunk_count, 1, [&](size_t begin, size_t end) {
+			for (auto chunk = begin; chunk < end; ++chunk)
+				scans[chunk] = detail::ScanCSVChunk(source.substr(chunk * chunk_size, chunk_size));
+		});
+
+		/// Row ranges of the chunks start after their first newline (the first chunk at 0), and end where the next one starts;
+		/// chunks without a newline are empty
+		std::vector<size_t> starts(chunk_count + 1);
+		std::vector<intptr_t> first_lines(chunk_count);
+		std::vector<uint8_t> inside_quotes(chunk_count);
+		{
+			bool inside = false;
+			intptr_t line = 1;
+			for (size_t chunk = 0; chunk < chunk_count; ++chunk)
+			{
+				inside_quotes[chunk] = inside;
+				first_lines[chunk] = chunk == 0 ? 0 : line;
+				line += intptr_t(scans[chunk].Newlines[inside]);
+				inside ^= scans[chunk].OddQuotes;
+			}
+			starts[chunk_count] = source.size();
+			for (size_t chunk = chunk_count - 1; chunk > 0; --chunk)
+			{
+				const auto first_newline = scans[chunk].FirstNewline[inside_quotes[chunk]];
+				starts[chunk] = first_newline == std::string_view::npos ? starts[chunk + 1] : chunk * chunk_size + first_newline + 1;
+			}
+			starts[0] = 0;
+		}
+
+		std::atomic<intptr_t> row_count = 0;
+		std::atomic<size_t> next_to_deliver = 0;
+		std::atomic<bool> failed = false;
+		std::mutex exception_mutex;
+		std::exception_ptr exception;
+		const auto fail = [&] {
+			std::lock_guard lock{ exception_mutex };
+			if (!exception)
+				exception = std::current_exception();
+			failed = true;
+		};
+
+		ParallelForBatches(chunk_count, 1, [&](size_t begin, size_t end) {
+			for (auto chunk = begin; chunk < end; ++chunk)
+			{
+				const auto rows = source.substr(starts[chunk], starts[chunk + 1] - starts[chunk]);
+				if (order == CSVRowOrder::Any)
 				{
-					if (!buffer_read_to(buffer, cp))
-						break;
-					if (cp != '"')
+					try
 					{
-						in_quote = false;
-						goto no_quote;
+						if (!failed)
+							row_count += LoadCSVViews(rows, row_callback, first_lines[chunk]);
 					}
+					catch (...) { fail(); }
+					continue;
+				}
+
+				/// Chunks are handed out in order, so the ones before this are being parsed and the wait ends
+				const auto wait_for_turn = [&] {
+					for (auto current = next_to_deliver.load(); current != chunk; current = next_to_deliver.load())
+						next_to_deliver.wait(current);
+				};
+				const auto end_turn = [&] {
+					next_to_deliver = chunk + 1;
+					next_to_deliver.notify_all();
+				};
+
+				try
+				{
+					if (next_to_deliver == chunk)
+					{
+						if (!failed)
+							row_count += LoadCSVViews(rows, row_callback, first_lines[chunk]);
+						end_turn();
+						continue;
+					}
+
+					/// Unescaped cells point into a buffer that is reused for the next row, so they are copied
+					std::vector<std::string_view> cells;
+					std::vector<size_t> row_sizes;
+					std::deque<std::string> unescaped;
+					const auto parsed = LoadCSVViews(rows, [&](intptr_t, std::span<std::string_view const> row) {
+						for (auto cell : row)
+						{
+							if (cell.data() < rows.data() || cell.data() > rows.data() + rows.size())
+								cell = unescaped.emplace_back(cell);
+							cells.push_back(cell);
+						}
+						row_sizes.push_back(row.size());
+					}, first_lines[chunk]);
+
+					wait_for_turn();
+					if (!failed)
+					{
+						size_t cell = 0;
+						for (size_t row = 0; row < row_sizes.size(); ++row)
+						{
+							row_callback(first_lines[chunk] + intptr_t(row), std::span<std::string_view const>{ cells.data() + cell, row_sizes[row] });
+							cell += row_sizes[row];
+						}
+						row_count += parsed;
+					}
+				}
+				catch (...) { fail(); }
+				if (next_to_deliver != chunk + 1)
+				{
+					wait_for_turn();
+					end_turn();
 				}
-				current_cell += cp;
 			}
+		});
+
+		if (exception)
+			std::rethrow_exception(exception);
+		return row_count;
+	}
+
+	/// Parses the contents of a random-access buffer with `LoadCSVViewsParallel`, without consuming it.
+	/// `row_callback` can take the row either as a `std::vector<std::string>` or as a `std::span<std::string_view const>`.
+	template <typename BUFFER, typename ROW_CALLBACK>
+	intptr_t LoadCSVParallel(BUFFER& buffer, ROW_CALLBACK&& row_callback, CSVRowOrder order = CSVRowOrder::InOrder, size_t chunk_size = size_t{ 1 } << 20)
+	{
+		static_assert(input_buffer_traits<std::remove_cvref_t<BUFFER>>::is_random_access, "LoadCSVParallel requires a random-access buffer");
+		const auto source = detail::CSVSourceOf(buffer);
+		if constexpr (std::invocable<ROW_CALLBACK&, intptr_t, std::span<std::string_view const>>)
+			return LoadCSVViewsParallel(source, row_callback, order, chunk_size);
+		else
+			return LoadCSVViewsParallel(source, [&](intptr_t line, std::span<std::string_view const> cells) {
+				row_callback(line, std::vector<std::string>(cells.begin(), cells.end()));
+			}, order, chunk_size);
+	}
+
+	/// Random-access buffers are parsed in place (see `LoadCSVViews`), and not consumed; other buffers are read char by char.
+	/// Both parse the same way: rows end with LF or CRLF, and a CR that isn't followed by a LF is part of its cell.
+	/// `row_callback` can take the row either as a `std::vector<std::string>` or as a `std::span<std::string_view const>`,
+	/// the latter only for random-access buffers.
+	template <typename BUFFER, typename ROW_CALLBACK>
+	intptr_t LoadCSV(BUFFER& buffer, ROW_CALLBACK&& row_callback)
+	{
+		if constexpr (input_buffer_traits<std::remove_cvref_t<BUFFER>>::is_random_access)
+		{
+			const auto source = detail::CSVSourceOf(buffer);
+			if constexpr (std::invocable<ROW_CALLBACK&, intptr_t, std::span<std::string_view const>>)
+				return LoadCSVViews(source, row_callback);
 			else
+				return LoadCSVViews(source, [&](intptr_t line, std::span<std::string_view const> cells) {
+					row_callback(line, std::vector<std::string>(cells.begin(), cells.end()));
+				});
+		}
+
+		else
+		{
+			bool in_quote = false;
+			intptr_t line = 0;
+
+			std::vector<std::string> row;
+			std::string current_cell;
+			char cp = 0;
+			while (buffer_read_to(buffer, cp))
 			{
-			no_quote:
-				
-				if (cp == '\r')
+				if (in_quote)
 				{
-					if (!buffer_read_to(buffer, cp))
-						break;
-					if (cp != '\n')
+					if (cp == '"')
 					{
-						current_cell += '\r';
-						current_cell += cp;
-						continue;
+						if (!buffer_read_to(buffer, cp))
+							break;
+						if (cp != '"')
+						{
+							in_quote = false;
+							goto no_quote;
+						}
 					}
+					current_cell += cp;
 				}
-				
-				if (cp == '\n')
+				else
 				{
-					row.push_back(std::move(current_cell));
-					row_callback(line++, std::move(row));
+				no_quote:
+				
+					/// A CR is only part of a line break if a LF follows; otherwise it's part of the cell, and the char after it is handled as usual
+					if (cp == '\r')
+					{
+						char next = 0;
+						if (!buffer_read_to(buffer, next))
+						{
+							current_cell += '\r';
+							break;
+						}
+						if (next != '\n')
+						{
+							current_cell += '\r';
+							cp = next;
+							goto no_quote;
+						}
+						cp = next;
+					}
+				
+					if (cp == '\n')
+					{
+						row.push_back(std::move(current_cell));
+						row_callback(line++, std::move(row));
+					}
+					else if (cp == '"')
+						in_quote = true;
+					else if (cp == ',')
+						row.push_back(std::move(current_cell));
+					else
+						current_cell += cp;
 				}
-				else if (cp == '"')
-					in_quote = true;
-				else if (cp == ',')
-					row.push_back(std::move(current_cell));
-				else
-					current_cell += cp;
 			}
-		}
 
-		if (!current_cell.empty())
-			row.push_back(std::move(current_cell));
-		if (!row.empty())
-			row_callback(line++, std::move(row));
+			if (!current_cell.empty())
+				row.push_back(std::move(current_cell));
+			if (!row.empty())
+				row_callback(line++, std::move(row));
 
-		return line;
+			return line;
+		}
 	}
 
 	template <typename BUFFER>
@@ -106,4 +562,175 @@ namespace gamelib
 
 		return result;
 	}
+
+	/// Parses a cell into a value: arithmetic types with `std::from_chars`, bools as `true`/`false`/`1`/`0`,
+	/// enums as their underlying integers, strings as they are. Empty cells leave the value untouched.
+	/// Returns false if the cell doesn't hold a valid value of the type.
+	template <typename T>
+	bool ParseCSVCell(std::string_view cell, T& value)
+	{
+		if (cell.empty())
+			return true;
+
+		if constexpr (std::is_same_v<T, bool>)
+		{
+			if (cell == "1" || cell == "true" || cell == "TRUE" || cell == "True")
+				value = true;
+			else if (cell == "0" || cell == "false" || cell == "FALSE" || cell == "False")
+				value = false;
+			else
+				return false;
+			return true;
+		}
+		else if constexpr (std::is_enum_v<T>)
+		{
+			std::underlying_type_t<T> underlying{};
+			if (!ParseCSVCell(cell, underlying))
+				return false;
+			value = T(underlying);
+			return true;
+		}
+		else if constexpr (std::is_arithmetic_v<T>)
+		{
+			auto begin = cell.data();
+			const auto end = begin + cell.size();
+			/// `from_chars` doesn't take a leading plus
+			if (*begin == '+' && cell.size() > 1)
+				++begin;
+			const auto [ptr, error] = std::from_chars(begin, end, value);
+			return error == std::errc{} && ptr == end;
+		}
+		else if constexpr (std::is_assignable_v<T&, std::string_view>)
+		{
+			value = cell;
+			return true;
+		}
+		else
+			static_assert(!sizeof(T*), "ParseCSVCell does not support this type");
+	}
+
+	namespace detail
+	{
+		/// Calls `row_handler(line, std::span<std::string_view const>)` for every row, in place if the buffer is random-access
+		template <typename BUFFER, typename ROW_HANDLER>
+		intptr_t ForEachCSVRowView(BUFFER& buffer, ROW_HANDLER&& row_handler)
+		{
+			if constexpr (input_buffer_traits<std::remove_cvref_t<BUFFER>>::is_random_access)
+				return LoadCSV(buffer, row_handler);
+			else
+			{
+				std::vector<std::string_view> views;
+				return LoadCSV(buffer, [&](intptr_t line, std::vector<std::string> row) {
+					views.assign(row.begin(), row.end());
+					row_handler(line, std::span<std::string_view const>{ views });
+				});
+			}
+		}
+	}
+
+	namespace archive
+	{
+		/// Loads the fields of a record from a row of CSV cells, matching the field names to the column names in the header.
+		/// Fields without a column are left untouched. Records must visit their fields in the same order every time,
+		/// as the column of each field is only looked up for the first row.
+		struct CSVArchiver : IArchiver<CSVArchiver>
+		{
+			CSVArchiver(IErrorReporter& reporter, std::span<std::string_view const> header)
+				: IArchiver(reporter, Mode::Loading), mColumnNames(header.begin(), header.end())
+			{
+			}
+
+			void BeginRow(intptr_t line, std::span<std::string_view const> cells)
+			{
+				mLine = line;
+				mCells = cells;
+				mField = 0;
+			}
+
+			template <typename T>
+			void Value(std::string_view name, T& val)
+			{
+				if (mMode == Mode::Modeling)
+					return ModelField(name, val);
+
+				if (mField == mFieldColumns.size())
+					mFieldColumns.push_back(size_t(std::ranges::find(mColumnNames, name) - mColumnNames.begin()));
+				const auto column = mFieldColumns[mField++];
+				if (column < mCells.size() && !ParseCSVCell(mCells[column], val))
+					mReporter.ThrowError("Invalid value '{}' for field '{}' in line {}", mCells[column], name, mLine);
+			}
+
+		private:
+
+			std::vector<std::string> mColumnNames;
+			std::vector<size_t> mFieldColumns;
+			std::span<std::string_view const> mCells;
+			size_t mField = 0;
+			intptr_t mLine = 0;
+		};
+
+		template <typename T>
+		void Archive(CSVArchiver& archive, std::string_view name, T& val)
+		{
+			archive.Value(name, val);
+		}
+	}
+
+	/// Loads a `T` from every row after the header. Fields are bound to the columns of the same name with `ARCHIVE_NVP`:
+	///		struct Item
+	///		{
+	///			std::string Name;
+	///			int Cost = 0;
+	///			template <typename ARCHIVER>
+	///			void Archive(ARCHIVER& archiver) { archiver & ARCHIVE_NVP(Name) & ARCHIVE_NVP(Cost); }
+	///		};
+	/// Cells are parsed with `ParseCSVCell` straight into the records, without going through `json`.
+	template <typename T, typename BUFFER>
+	std::vector<T> LoadCSVRecords(BUFFER& buffer, IErrorReporter& reporter)
+	{
+		std::vector<T> result;
+		std::optional<archive::CSVArchiver> archiver;
+		detail::ForEachCSVRowView(buffer, [&](intptr_t line, std::span<std::string_view const> cells) {
+			if (!archiver)
+			{
+				archiver.emplace(reporter, cells);
+				return;
+			}
+			archiver->BeginRow(line, cells);
+			result.emplace_back().Archive(*archiver);
+		});
+		return result;
+	}
+
+	/// Loads the named columns into one vector each (structure-of-arrays), with the column types given up front:
+	///		auto [names, costs] = LoadCSVColumns<std::string, int>(buffer, { "Name", "Cost" }, reporter);
+	/// Rows that are too short get default values.
+	template <typename... COLUMNS, typename BUFFER>
+	std::tuple<std::vector<COLUMNS>...> LoadCSVColumns(BUFFER& buffer, std::array<std::string_view, sizeof...(COLUMNS)> const& column_names, IErrorReporter& reporter)
+	{
+		std::tuple<std::vector<COLUMNS>...> result;
+		std::array<size_t, sizeof...(COLUMNS)> columns{};
+		detail::ForEachCSVRowView(buffer, [&](intptr_t line, std::span<std::string_view const> cells) {
+			if (line == 0)
+			{
+				for (size_t i = 0; i < column_names.size(); ++i)
+				{
+					columns[i] = size_t(std::ranges::find(cells, column_names[i]) - cells.begin());
+					if (columns[i] == cells.size())
+						reporter.ThrowError("Column '{}' not found", column_names[i]);
+				}
+				return;
+			}
+
+			[&]<size_t... INDICES>(std::index_sequence<INDICES...>) {
+				(([&] {
+					auto& value = std::get<INDICES>(result).emplace_back();
+					const auto column = columns[INDICES];
+					if (column < cells.size() && !ParseCSVCell(cells[column], value))
+						reporter.ThrowError("Invalid value '{}' for column '{}' in line {}", cells[column], column_names[INDICES], line);
+				}()), ...);
+			}(std::index_sequence_for<COLUMNS...>{});
+		});
+		return result;
+	}
 }
\ No newline at end of file
@@ -0,0 +1,376 @@
+#pragma once
+
+#include "BinaryArchiver.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <functional>
+#include <optional>
+#include <algorithm>
+
+namespace gamelib::archive
+{
+	/// Archives only what changed in an object since it was last archived, for autosaves and the like.
+	///
+	/// When updating, the archiver remembers a hash of every field it saved, and `WriteDelta` writes out only the fields whose
+	/// hash changed since the previous call. The first delta after construction or `Reset` has every field, so it can serve
+	/// as the base snapshot. Fields are identified by their position in their record, and elements of vectors of records by
+	/// their index, so records have to archive the same fields in the same order in both modes.
+	/// Values are written as in a compact `BinaryArchiver` archive, so the same types are supported. Vectors of trivially copyable
+	/// values (like tiles) are hashed and written in chunks of `ChunkSize` bytes, so changing a few elements only writes their chunks.
+	///
+	/// When loading, a delta is applied on top of an object that is in the state the delta was made against:
+	/// a default-constructed object for the first delta, then the result of applying the previous deltas in order.
+	struct DeltaArchiver : IArchiver<DeltaArchiver>
+	{
+		static constexpr size_t ChunkSize = 4096;
+
+		/// For updating; keep the archiver between deltas
+		explicit DeltaArchiver(IErrorReporter& reporter) : IArchiver(reporter, Mode::Updating), mValues(reporter) {}
+
+		/// For applying a delta, which has to outlive the archiver
+		DeltaArchiver(IErrorReporter& reporter, std::span<char const> delta)
+			: IArchiver(reporter, Mode::Loading), mValues(reporter), mStructure(delta.data(), delta.size()), mDeltaSize(delta.size())
+		{
+			const auto structure_size = ReadVarint();
+			if (structure_size > mStructure.size())
+				mReporter.ThrowError("Delta is truncated");
+			const auto values = mStructure.substr(size_t(structure_size));
+			mStructure = mStructure.substr(0, size_t(structure_size));
+			mValueReader.emplace(reporter, std::span<char const>{ values });
+		}
+
+		/// Appends the fields of `object` that changed since the previous delta to an output buffer, and remembers them
+		/// for the next one; returns the number of bytes appended
+		template <typename BUFFER, typename T>
+		size_t WriteDelta(BUFFER& output, T& object)
+		{
+			mStructureData.clear();
+			mValues.Data.clear();
+			UpdateRecord(mRoot, object);
+
+			std::string header;
+			detail::AppendVarint(header, mStructureData.size());
+			return buffer_append_read_chunk(output, std::span<char const>{ header })
+				+ buffer_append_read_chunk(output, std::span<char const>{ mStructureData })
+				+ mValues.WriteTo(output);
+		}
+
+		/// Forgets the previous deltas, so the next one has every field
+		void Reset() { mRoot = {}; }
+
+		/// Applies the delta to `object`
+		template <typename T>
+		void ApplyTo(T& object)
+		{
+			ApplyRecord(object);
+			if (!mStructure.empty())
+				mReporter.ThrowError("Delta has {} bytes left over", mStructure.size());
+		}
+
+		template <typename T>
+		void Value(std::string_view name, T& val)
+		{
+			switch (mMode)
+			{
+			case Mode::Updating:
+				UpdateField(name, val);
+				break;
+			case Mode::Loading:
+				ApplyField(name, val);
+				break;
+			case Mode::Modeling:
+				ModelField(name, val);
+				break;
+			case Mode::Saving:
+			default:
+				break;
+			}
+		}
+
+	private:
+
+		struct Node
+		{
+			/// Of the value of a field, or the length of a vector of records
+			size_t Hash = 0;
+			bool Saved = false;
+			/// The fields of a record, or the elements of a vector of records
+			std::vector<Node> Children;
+		};
+
+		/// Updating
+		Node mRoot;
+		/// Which fields and elements changed: for each record, the position of every changed field plus one, then a 0.
+		/// Changed records are followed by their own changes; vectors of records by their length, then the index plus one
+		/// of every changed element and its changes, then a 0; chunked vectors by their length, then the index plus one
+		/// of every changed chunk, then a 0.
+		std::string mStructureData;
+		/// The values of the changed fields, in order
+		BinaryArchiver mValues;
+
+		/// Loading
+		std::string_view mStructure;
+		size_t mDeltaSize = 0;
+		std::optional<BinaryArchiver> mValueReader;
+		std::string mChunk;
+
+		struct Frame
+		{
+			Node* Record = nullptr;
+			size_t Field = 0;
+			/// When loading, the position plus one of the next changed field, or 0 if there are no more
+			uint64_t NextChanged = 0;
+		};
+		std::vector<Frame> mFrames;
+
+		template <typename T>
+		static constexpr bool is_record = detail::archivable_record<T, DeltaArchiver>;
+
+		template <typename T>
+		static constexpr bool IsRecordVector()
+		{
+			if constexpr (detail::is_binary_vector<T>::value)
+				return is_record<typename T::value_type>;
+			else
+				return false;
+		}
+
+		template <typename T>
+		static constexpr bool IsChunkedVector()
+		{
+			if constexpr (detail::is_binary_vector<T>::value)
+				return std::is_trivially_copyable_v<typename T::value_type> && !is_record<typename T::value_type>;
+			else
+				return false;
+		}
+
+		template <typename T>
+		static constexpr size_t ChunkElements = std::max<size_t>(1, ChunkSize / sizeof(T));
+
+		static size_t HashBytes(void const* data, size_t size)
+		{
+			return std::hash<std::string_view>{}(std::string_view{ static_cast<char const*>(data), size });
+		}
+
+		/// Hashes trivially copyable values and strings in place, and others through their archived form
+		template <typename T>
+		size_t HashValue(std::string_view name, T& val)
+		{
+			if constexpr (detail::is_binary_string<T>::value || detail::is_binary_vector<T>::value)
+			{
+				if constexpr (std::is_trivially_copyable_v<typename T::value_type>)
+					return HashBytes(val.data(), val.size() * sizeof(typename T::value_type)) ^ std::hash<size_t>{}(val.size());
+			}
+			if constexpr (std::is_trivially_copyable_v<T> && !std::is_pointer_v<T> && sizeof(T) <= sizeof(size_t))
+			{
+				/// Small values are their own hash, so they can't collide
+				size_t bits = 0;
+				std::memcpy(&bits, &val, sizeof(val));
+				return bits;
+			}
+			else if constexpr (std::is_trivially_copyable_v<T> && !std::is_pointer_v<T>)
+				return HashBytes(&val, sizeof(val));
+			else
+			{
+				const auto start = mValues.Data.size();
+				mValues.Value(name, val);
+				const auto hash = HashBytes(mValues.Data.data() + start, mValues.Data.size() - start);
+				mValues.Data.resize(start);
+				return hash;
+			}
+		}
+
+		/// Appends the changes to the fields of a record, and a 0; returns false if nothing changed
+		template <typename T>
+		bool UpdateRecord(Node& node, T& record)
+		{
+			const auto start = mStructureData.size();
+			mFrames.push_back({ &node });
+			record.Archive(*this);
+			mFrames.pop_back();
+			node.Saved = true;
+			detail::AppendVarint(mStructureData, 0);
+			return mStructureData.size() > start + 1;
+		}
+
+		template <typename T>
+		void UpdateField(std::string_view name, T& val)
+		{
+			auto& frame = mFrames.back();
+			const auto index = frame.Field++;
+			if (frame.Record->Children.size() <= index)
+				frame.Record->Children.resize(index + 1);
+			auto& node = frame.Record->Children[index];
+
+			if constexpr (!is_record<T> && !IsRecordVector<T>() && !IsChunkedVector<T>())
+			{
+				const auto hash = HashValue(name, val);
+				if (!node.Saved || node.Hash != hash)
+				{
+					node.Hash = hash;
+					node.Saved = true;
+					detail::AppendVarint(mStructureData, index + 1);
+					mValues.Value(name, val);
+				}
+				return;
+			}
+
+			/// Written before the changes inside the field, and taken back if there aren't any
+			const auto mark = mStructureData.size();
+			detail::AppendVarint(mStructureData, index + 1);
+			if constexpr (is_record<T>)
+			{
+				if (!UpdateRecord(node, val))
+					mStructureData.resize(mark);
+			}
+			else if constexpr (IsRecordVector<T>())
+			{
+				bool changed = !node.Saved || node.Hash != val.size();
+				node.Hash = val.size();
+				node.Saved = true;
+				node.Children.resize(val.size());
+				detail::AppendVarint(mStructureData, val.size());
+				for (size_t i = 0; i < val.size(); ++i)
+				{
+					const auto element_mark = mStructureData.size();
+					detail::AppendVarint(mStructureData, i + 1);
+					if (UpdateRecord(node.Children[i], val[i]))
+						changed = true;
+					else
+						mStructureData.resize(element_mark);
+				}
+				detail::AppendVarint(mStructureData, 0);
+				if (!changed)
+					mStructureData.resize(mark);
+			}
+			else if constexpr (IsChunkedVector<T>())
+			{
+				using element_type = typename T::value_type;
+				bool changed = !node.Saved || node.Hash != val.size();
+				node.Hash = val.size();
+				node.Saved = true;
+				node.Children.resize((val.size() + ChunkElements<element_type> - 1) / ChunkElements<element_type>);
+				detail::AppendVarint(mStructureData, val.size());
+				for (size_t i = 0; i < node.Children.size(); ++i)
+				{
+					const auto first = i * ChunkElements<element_type>;
+					const auto bytes = std::min(ChunkElements<element_type>, val.size() - first) * sizeof(element_type);
+					const auto hash = HashBytes(val.data() + first, bytes);
+					auto& chunk = node.Children[i];
+					if (chunk.Saved && chunk.Hash == hash)
+						continue;
+
+					chunk.Hash = hash;
+					chunk.Saved = true;
+					changed = true;
+					detail::AppendVarint(mStructureData, i + 1);
+					detail::AppendVarint(mValues.Data, bytes);
+					mValues.Data.append(reinterpret_cast<char const*>(val.data() + first), bytes);
+				}
+				detail::AppendVarint(mStructureData, 0);
+				if (!changed)
+					mStructureData.resize(mark);
+			}
+		}
+
+		uint64_t ReadVarint()
+		{
+			uint64_t result = 0;
+			for (int shift = 0; shift < 64 && !mStructure.empty(); shift += 7)
+			{
+				const auto byte = uint8_t(mStructure.front());
+				mStructure.remove_prefix(1);
+				result |= uint64_t(byte & 0x7F) << shift;
+				if (!(byte & 0x80))
+					return result;
+			}
+			mReporter.ThrowError("Delta is truncated");
+			return 0;
+		}
+
+		template <typename T>
+		void ApplyRecord(T& record)
+		{
+			mFrames.push_back({ nullptr, 0, ReadVarint() });
+			record.Archive(*this);
+			const auto left_over = mFrames.back().NextChanged;
+			mFrames.pop_back();
+			if (left_over != 0)
+				mReporter.ThrowError("Delta has changes to field {} of a record that doesn't have it", left_over - 1);
+		}
+
+		template <typename T>
+		void ApplyField(std::string_view name, T& val)
+		{
+			const auto index = mFrames.back().Field++;
+			if (mFrames.back().NextChanged != index + 1)
+				return;
+
+			if constexpr (is_record<T>)
+				ApplyRecord(val);
+			else if constexpr (IsRecordVector<T>())
+			{
+				const auto size = ReadVarint();
+				/// Every new element has its changes in the structure, which keeps corrupt sizes from allocating huge vectors
+				if (size > val.size() && size - val.size() > mStructure.size())
+					mReporter.ThrowError("Delta is truncated in '{}'", name);
+				val.resize(size_t(size));
+				for (auto element = ReadVarint(); element != 0; element = ReadVarint())
+				{
+					if (element > val.size())
+						mReporter.ThrowError("Delta has changes to element {} of '{}', which has {}", element - 1, name, val.size());
+					ApplyRecord(val[size_t(element - 1)]);
+				}
+			}
+			else if constexpr (IsChunkedVector<T>())
+			{
+				using element_type = typename T::value_type;
+				const auto size = ReadVarint();
+				/// New elements have to be in the delta
+				if (size > val.size() && size - val.size() > mDeltaSize / sizeof(element_type))
+					mReporter.ThrowError("Delta is truncated in '{}'", name);
+				val.resize(size_t(size));
+				const auto chunks = (val.size() + ChunkElements<element_type> - 1) / ChunkElements<element_type>;
+				for (auto chunk = ReadVarint(); chunk != 0; chunk = ReadVarint())
+				{
+					mValueReader->Value(name, mChunk);
+					const auto first = size_t(chunk - 1) * ChunkElements<element_type>;
+					if (chunk > chunks || mChunk.size() != std::min(ChunkElements<element_type>, val.size() - first) * sizeof(element_type))
+						mReporter.ThrowError("Delta has an invalid chunk {} of '{}'", chunk - 1, name);
+					std::memcpy(static_cast<void*>(val.data() + first), mChunk.data(), mChunk.size());
+				}
+			}
+			else
+				mValueReader->Value(name, val);
+
+			mFrames.back().NextChanged = ReadVarint();
+		}
+	};
+
+	template <typename T>
+	void Archive(DeltaArchiver& archive, std::string_view name, T& val)
+	{
+		archive.Value(name, val);
+	}
+
+	/// Applies a delta written by `DeltaArchiver::WriteDelta` to `object`.
+	/// Random-access buffers are read in place and not consumed; other buffers are read whole first.
+	template <typename BUFFER, typename T>
+	void ApplyDelta(BUFFER& input, T& object, IErrorReporter& reporter)
+	{
+		if constexpr (input_buffer_traits<std::remove_cvref_t<BUFFER>>::is_random_access)
+		{
+			DeltaArchiver archiver{ reporter, buffer_remaining_span(input) };
+			archiver.ApplyTo(object);
+		}
+		else
+		{
+			std::string contents;
+			buffer_copy(input, contents);
+			DeltaArchiver archiver{ reporter, std::span<char const>{ contents } };
+			archiver.ApplyTo(object);
+		}
+	}
+}
@@ -1,8 +1,13 @@
 #pragma once
 
+#include "../Includes/JSON.h"
+#include "../ErrorReporter.h"
 #include <map>
 #include <string>
 #include <vector>
+#include <typeindex>
+#include <utility>
+#include <algorithm>
 
 namespace gamelib::archive
 {
@@ -10,15 +15,37 @@ namespace gamelib::archive
 	using NVP = std::pair<std::string_view, T&>;
 	#define ARCHIVE_NVP(name) ::gamelib::archive::NVP<decltype(name)>{#name, name}
 
+	namespace detail
+	{
+		template <typename T, typename ARCHIVER>
+		concept archivable_record = requires (T& val, ARCHIVER& archiver) { val.Archive(archiver); };
+	}
+
 	struct Field
 	{
+		static constexpr size_t NotInObject = size_t(-1);
+
 		std::string Name;
+		/// Offset of the field from the start of the record, or `NotInObject` if the archived value lives elsewhere
+		size_t Offset = NotInObject;
+		size_t Size = 0;
+		std::type_index Type = typeid(void);
 	};
 
+	/// The fields a record archives, in the order its `Archive` function visits them (see `IArchiver::ModelOf`)
 	struct ClassModel
 	{
 		std::string Name;
+		size_t Size = 0;
 		std::vector<Field> Fields;
+		/// Indices into `Fields`, sorted by field name
+		std::vector<size_t> FieldsByName;
+
+		Field const* FindField(std::string_view name) const
+		{
+			const auto it = std::ranges::lower_bound(FieldsByName, name, std::less<>{}, [this](size_t i) -> std::string_view { return Fields[i].Name; });
+			return it != FieldsByName.end() && Fields[*it].Name == name ? &Fields[*it] : nullptr;
+		}
 	};
 
 	template <typename CRTP>
@@ -45,13 +72,67 @@ namespace gamelib::archive
 
 		Mode CurrentMode() const { return mMode; }
 
+		/// The model of a record type, built the first time it's asked for by archiving a default-constructed `T`
+		/// in `Mode::Modeling`, and cached for the lifetime of the archiver
+		template <typename T>
+		ClassModel const& ModelOf()
+		{
+			static_assert(std::is_default_constructible_v<T>, "records need to be default-constructible to be modeled");
+
+			/// Keyed by `type_index`, as type names aren't guaranteed to be unique
+			const std::type_index type = typeid(T);
+			if (const auto it = mClasses.find(type); it != mClasses.end())
+				return it->second;
+
+			ClassModel model;
+			model.Name = type.name();
+			model.Size = sizeof(T);
+
+			T object{};
+			const auto previous_mode = std::exchange(mMode, Mode::Modeling);
+			const auto previous_model = std::exchange(mModel, &model);
+			const auto previous_base = std::exchange(mModelBase, reinterpret_cast<char const*>(&object));
+			object.Archive(static_cast<CRTP&>(*this));
+			mMode = previous_mode;
+			mModel = previous_model;
+			mModelBase = previous_base;
+
+			model.FieldsByName.resize(model.Fields.size());
+			for (size_t i = 0; i < model.Fields.size(); ++i)
+				model.FieldsByName[i] = i;
+			std::ranges::stable_sort(model.FieldsByName, std::less<>{}, [&](size_t i) -> std::string_view { return model.Fields[i].Name; });
+
+			return mClasses.emplace(type, std::move(model)).first->second;
+		}
+
 	protected:
 
+		/// Archivers call this from `Value` in `Mode::Modeling`
+		template <typename T>
+		void ModelField(std::string_view name, T const& val)
+		{
+			if (!mModel)
+				return;
+
+			Field field{ std::string{ name } };
+			const auto address = reinterpret_cast<char const*>(std::addressof(val));
+			if (address >= mModelBase && address + sizeof(T) <= mModelBase + mModel->Size)
+				field.Offset = size_t(address - mModelBase);
+			field.Size = sizeof(T);
+			field.Type = typeid(T);
+			mModel->Fields.push_back(std::move(field));
+		}
+
 		IErrorReporter& mReporter;
 
 		Mode mMode = Mode::Loading;
 
-		std::map<std::string, ClassModel> mClasses;
+		std::map<std::type_index, ClassModel> mClasses;
+
+	private:
+
+		ClassModel* mModel = nullptr;
+		char const* mModelBase = nullptr;
 	};
 
 	struct JsonArchiver : IArchiver<JsonArchiver>
@@ -66,36 +147,118 @@ namespace gamelib::archive
 		JsonArchiver(IErrorReporter& reporter, json const& from) : IArchiver(reporter, Mode::Loading), CurrentObject(const_cast<json*>(&from)) {}
 		JsonArchiver(IErrorReporter& reporter, json&& from) : IArchiver(reporter, Mode::Loading), Root(std::move(from)), CurrentObject(&Root) {}
 
+		/// Archives a record into or out of the current object. When loading, the keys of the object are matched to the
+		/// fields of the record's model in a single pass, as both are sorted by name, so fields aren't looked up one by one.
+		/// Records that are fields of other records are archived this way too.
+		template <typename T>
+		void Record(T& object)
+		{
+			if (mMode != Mode::Loading)
+			{
+				object.Archive(*this);
+				return;
+			}
+
+			auto const& model = ModelOf<T>();
+			if (!CurrentObject->is_object())
+				mReporter.ThrowError("Expected an object for '{}', got {}", model.Name, CurrentObject->type_name());
+
+			static_assert(std::is_same_v<json::object_t, std::map<json::string_t, json, json::object_comparator_t, json::object_t::allocator_type>>,
+				"json object keys need to be sorted for them to be matched to the fields in order");
+
+			const auto first = mFieldValues.size();
+			mFieldValues.resize(first + model.Fields.size(), nullptr);
+			auto field = model.FieldsByName.begin();
+			for (auto& [key, value] : CurrentObject->get_ref<json::object_t&>())
+			{
+				while (field != model.FieldsByName.end() && model.Fields[*field].Name < key)
+					++field;
+				if (field == model.FieldsByName.end())
+					break;
+				if (model.Fields[*field].Name == key)
+					mFieldValues[first + *field++] = &value;
+			}
+
+			const auto previous_model = std::exchange(mRecordModel, &model);
+			const auto previous_first = std::exchange(mRecordFirstField, first);
+			const auto previous_field = std::exchange(mRecordField, 0);
+			object.Archive(*this);
+			mRecordModel = previous_model;
+			mRecordFirstField = previous_first;
+			mRecordField = previous_field;
+			mFieldValues.resize(first);
+		}
+
 		template <typename T>
 		void Value(std::string_view name, T& val)
 		{
 			switch (mMode)
 			{
 			case Mode::Loading:
-			{
-				auto it = CurrentObject->find(name);
-				if (it != CurrentObject->end())
+				if (const auto field = FindValue(name))
 				{
-					try
+					if constexpr (detail::archivable_record<T, JsonArchiver>)
 					{
-						it->get_to(val);
+						const auto parent = std::exchange(CurrentObject, field);
+						Record(val);
+						CurrentObject = parent;
 					}
-					catch (std::exception const& e)
+					else
 					{
-						mReporter.ThrowError("Invalid value for field '{}': {}", name, e.what());
+						try
+						{
+							field->get_to(val);
+						}
+						catch (std::exception const& e)
+						{
+							mReporter.ThrowError("Invalid value for field '{}': {}", name, e.what());
+						}
 					}
 				}
 				break;
-			}
 			case Mode::Saving:
-				CurrentObject->operator[]((std::string)name) = val;
+				if constexpr (detail::archivable_record<T, JsonArchiver>)
+				{
+					const auto parent = std::exchange(CurrentObject, &(CurrentObject->operator[]((std::string)name) = json::object_t{}));
+					Record(val);
+					CurrentObject = parent;
+				}
+				else
+					CurrentObject->operator[]((std::string)name) = val;
 				break;
-			case Mode::Updating:
 			case Mode::Modeling:
+				ModelField(name, val);
+				break;
+			case Mode::Updating:
 			default:
 				break;
 			}
 		}
+
+	private:
+
+		/// Within `Record`, fields are matched by the order they are visited in, falling back to a lookup
+		/// if the record visits them out of the order of its model
+		json* FindValue(std::string_view name)
+		{
+			if (mRecordModel)
+			{
+				auto const& fields = mRecordModel->Fields;
+				if (mRecordField < fields.size() && fields[mRecordField].Name == name)
+					return mFieldValues[mRecordFirstField + mRecordField++];
+				if (const auto field = mRecordModel->FindField(name))
+					return mFieldValues[mRecordFirstField + size_t(field - fields.data())];
+			}
+
+			const auto it = CurrentObject->find(name);
+			return it != CurrentObject->end() ? &*it : nullptr;
+		}
+
+		/// The values of the fields of the records being loaded, in model order; nested records are stacked after their parents
+		std::vector<json*> mFieldValues;
+		ClassModel const* mRecordModel = nullptr;
+		size_t mRecordFirstField = 0;
+		size_t mRecordField = 0;
 	};
 	
 	template <typename T>
@@ -6,6 +6,13 @@
 namespace gamelib
 {
 
+	template <>
+	struct output_buffer_traits<std::ostream> : base_buffer_traits<char>
+	{
+		static constexpr bool can_reserve = false;
+		static constexpr bool can_append_chunks = true;
+	};
+
 	template <>
 	inline bool buffer_append<std::ostream&, char const&>(std::ostream& buffer, char const& c)
 	{
@@ -13,6 +20,20 @@ namespace gamelib
 		return !buffer.fail();
 	}
 
+	template <>
+	inline size_t buffer_append_chunk<std::ostream&, char>(std::ostream& buffer, std::span<char const> chunk)
+	{
+		buffer.write(chunk.data(), std::streamsize(chunk.size()));
+		return buffer.fail() ? 0 : chunk.size();
+	}
+
+	template <>
+	struct input_buffer_traits<std::istream> : base_buffer_traits<char>
+	{
+		static constexpr bool is_random_access = false;
+		static constexpr bool can_read_chunks = true;
+	};
+
 	template <>
 	inline bool buffer_read_to<std::istream&, char>(std::istream& buffer, char& c)
 	{
@@ -20,4 +41,11 @@ namespace gamelib
 		return !buffer.fail();
 	}
 
+	template <>
+	inline std::span<char const> buffer_read_chunk<std::istream&, char>(std::istream& buffer, std::span<char> scratch)
+	{
+		buffer.read(scratch.data(), std::streamsize(scratch.size()));
+		return scratch.first(size_t(buffer.gcount()));
+	}
+
 }
\ No newline at end of file
@@ -0,0 +1,629 @@
+#pragma once
+
+#include "IArchiver.h"
+#include "../Buffers.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <charconv>
+#include <limits>
+#include <cmath>
+
+namespace gamelib::archive
+{
+	namespace detail
+	{
+		template <typename T>
+		struct is_json_vector : std::false_type {};
+		template <typename T, typename ALLOC>
+		struct is_json_vector<std::vector<T, ALLOC>> : std::true_type {};
+
+		inline void AppendJsonString(std::string& to, std::string_view str)
+		{
+			static constexpr char hex_digits[] = "0123456789abcdef";
+			to += '"';
+			size_t run_start = 0;
+			for (size_t i = 0; i < str.size(); ++i)
+			{
+				const auto c = uint8_t(str[i]);
+				if (c >= 0x20 && c != '"' && c != '\\')
+					continue;
+
+				to.append(str.data() + run_start, i - run_start);
+				run_start = i + 1;
+				switch (c)
+				{
+				case '"': to += "\\\""; break;
+				case '\\': to += "\\\\"; break;
+				case '\b': to += "\\b"; break;
+				case '\f': to += "\\f"; break;
+				case '\n': to += "\\n"; break;
+				case '\r': to += "\\r"; break;
+				case '\t': to += "\\t"; break;
+				default:
+					to += "\\u00";
+					to += hex_digits[c >> 4];
+					to += hex_digits[c & 0xF];
+					break;
+				}
+			}
+			to.append(str.data() + run_start, str.size() - run_start);
+			to += '"';
+		}
+
+		inline void AppendUTF8(std::string& to, char32_t cp)
+		{
+			if (cp < 0x80)
+				to += char(cp);
+			else if (cp < 0x800)
+			{
+				to += char((cp >> 6) | 0xC0);
+				to += char((cp & 0x3F) | 0x80);
+			}
+			else if (cp < 0x10000)
+			{
+				to += char((cp >> 12) | 0xE0);
+				to += char(((cp >> 6) & 0x3F) | 0x80);
+				to += char((cp & 0x3F) | 0x80);
+			}
+			else
+			{
+				to += char((cp >> 18) | 0xF0);
+				to += char(((cp >> 12) & 0x3F) | 0x80);
+				to += char(((cp >> 6) & 0x3F) | 0x80);
+				to += char((cp & 0x3F) | 0x80);
+			}
+		}
+	}
+
+	/// Saves records as JSON text, written into an output buffer as the fields are archived, without building a `json` tree.
+	/// Numbers, bools, strings, records and vectors of those are written directly; anything else goes through
+	/// its `nlohmann::json` conversion, so the result is the same as that of `JsonArchiver`.
+	/// Text is handed to the buffer in chunks of about `FlushSize` bytes; call `Flush` when done.
+	template <typename BUFFER>
+	struct JsonWriterArchiver : IArchiver<JsonWriterArchiver<BUFFER>>
+	{
+		using Mode = typename IArchiver<JsonWriterArchiver>::Mode;
+
+		static constexpr size_t FlushSize = 64 * 1024;
+
+		JsonWriterArchiver(IErrorReporter& reporter, BUFFER& output) : IArchiver<JsonWriterArchiver>(reporter, Mode::Saving), mOutput(output) {}
+
+		/// Writes a record as a JSON object
+		template <typename T>
+		void Record(T& object)
+		{
+			mPending += '{';
+			mFirstField = true;
+			object.Archive(*this);
+			mPending += '}';
+			mFirstField = false;
+		}
+
+		template <typename T>
+		void Value(std::string_view name, T& val)
+		{
+			switch (this->mMode)
+			{
+			case Mode::Saving:
+				if (!std::exchange(mFirstField, false))
+					mPending += ',';
+				detail::AppendJsonString(mPending, name);
+				mPending += ':';
+				Write(val);
+				FlushIfFull();
+				break;
+			case Mode::Modeling:
+				this->ModelField(name, val);
+				break;
+			case Mode::Loading:
+			case Mode::Updating:
+			default:
+				break;
+			}
+		}
+
+		/// Hands the pending text to the output buffer; returns the number of bytes appended to it so far
+		size_t Flush()
+		{
+			mWritten += buffer_append_read_chunk(mOutput, std::span<char const>{ mPending });
+			mPending.clear();
+			return mWritten;
+		}
+
+	private:
+
+		BUFFER& mOutput;
+		std::string mPending;
+		size_t mWritten = 0;
+		bool mFirstField = true;
+
+		void FlushIfFull()
+		{
+			if (mPending.size() >= FlushSize)
+				Flush();
+		}
+
+		template <typename T>
+		void AppendNumber(T val)
+		{
+			char digits[64];
+			const auto [end, ec] = std::to_chars(std::begin(digits), std::end(digits), val);
+			mPending.append(digits, end);
+		}
+
+		template <typename T>
+		void Write(T const& val)
+		{
+			static_assert(!std::is_pointer_v<T> || std::is_convertible_v<T, std::string_view>, "pointers cannot be archived");
+			if constexpr (std::is_same_v<T, bool>)
+				mPending += val ? "true" : "false";
+			else if constexpr (std::is_floating_point_v<T>)
+			{
+				/// Like nlohmann::json
+				if (std::isfinite(val))
+					AppendNumber(val);
+				else
+					mPending += "null";
+			}
+			else if constexpr (std::is_arithmetic_v<T>)
+				AppendNumber(val);
+			else if constexpr (std::is_convertible_v<T const&, std::string_view>)
+				detail::AppendJsonString(mPending, val);
+			else if constexpr (detail::archivable_record<T, JsonWriterArchiver>)
+				Record(const_cast<T&>(val));
+			else if constexpr (detail::is_json_vector<T>::value)
+			{
+				mPending += '[';
+				bool first = true;
+				for (typename T::value_type const& element : val)
+				{
+					if (!std::exchange(first, false))
+						mPending += ',';
+					Write(element);
+					FlushIfFull();
+				}
+				mPending += ']';
+			}
+			else
+				mPending += json(val).dump();
+		}
+	};
+
+	template <typename BUFFER, typename T>
+	void Archive(JsonWriterArchiver<BUFFER>& archive, std::string_view name, T& val)
+	{
+		archive.Value(name, val);
+	}
+
+	/// Reads JSON text one token at a time, without building a document. Values are read in place from the input,
+	/// which has to outlive the parser. Throws through the error reporter on malformed input.
+	class JsonPullParser
+	{
+	public:
+
+		JsonPullParser(IErrorReporter& reporter, std::string_view input) : mReporter(reporter), mInput(input) {}
+
+		size_t Position() const noexcept { return mPosition; }
+		void Seek(size_t position) noexcept { mPosition = position; }
+
+		/// The first character of the next token, or 0 at the end of the input
+		char Peek() noexcept
+		{
+			while (mPosition < mInput.size() && IsWhitespace(mInput[mPosition]))
+				++mPosition;
+			return mPosition < mInput.size() ? mInput[mPosition] : 0;
+		}
+
+		bool AtEnd() noexcept { return Peek() == 0; }
+
+		void BeginObject() { Expect('{', "an object"); }
+		void BeginArray() { Expect('[', "an array"); }
+
+		/// Reads the key of the next member of the current object; returns false (and consumes the `}`) if there are no more.
+		/// The key is valid until the next string is read.
+		bool NextKey(std::string_view& key)
+		{
+			if (!NextItem('}'))
+				return false;
+			key = ReadString();
+			Expect(':', "':'");
+			return true;
+		}
+
+		/// Returns false (and consumes the `]`) if there are no more elements in the current array
+		bool NextElement() { return NextItem(']'); }
+
+		/// Returns true and consumes the value if it's a null
+		bool ReadNull()
+		{
+			if (Peek() != 'n')
+				return false;
+			ExpectLiteral("null");
+			return true;
+		}
+
+		bool ReadBool()
+		{
+			if (Peek() == 't')
+			{
+				ExpectLiteral("true");
+				return true;
+			}
+			ExpectLiteral("false");
+			return false;
+		}
+
+		/// The text of a number, to be converted by the caller
+		std::string_view ReadNumber()
+		{
+			Peek();
+			const auto start = mPosition;
+			while (mPosition < mInput.size() && IsNumberCharacter(mInput[mPosition]))
+				++mPosition;
+			if (start == mPosition)
+				Error("a value");
+			return mInput.substr(start, mPosition - start);
+		}
+
+		/// Strings without escapes are returned in place; others are unescaped into a scratch string,
+		/// so the result is only valid until the next string is read
+		std::string_view ReadString()
+		{
+			Expect('"', "a string");
+			const auto start = mPosition;
+			while (mPosition < mInput.size())
+			{
+				const auto c = mInput[mPosition];
+				if (c == '"')
+					return mInput.substr(start, mPosition++ - start);
+				if (c == '\\')
+					break;
+				if (uint8_t(c) < 0x20)
+					Error("a character");
+				++mPosition;
+			}
+
+			mScratch.assign(mInput.substr(start, mPosition - start));
+			while (mPosition < mInput.size())
+			{
+				const auto c = mInput[mPosition++];
+				if (c == '"')
+					return mScratch;
+				if (uint8_t(c) < 0x20)
+					Error("a character");
+				if (c != '\\')
+				{
+					mScratch += c;
+					continue;
+				}
+
+				if (mPosition == mInput.size())
+					break;
+				switch (mInput[mPosition++])
+				{
+				case '"': mScratch += '"'; break;
+				case '\\': mScratch += '\\'; break;
+				case '/': mScratch += '/'; break;
+				case 'b': mScratch += '\b'; break;
+				case 'f': mScratch += '\f'; break;
+				case 'n': mScratch += '\n'; break;
+				case 'r': mScratch += '\r'; break;
+				case 't': mScratch += '\t'; break;
+				case 'u':
+				{
+					char32_t cp = ReadHex4();
+					if (cp >= 0xDC00 && cp <= 0xDFFF)
+						Error("a high surrogate");
+					if (cp >= 0xD800 && cp <= 0xDBFF)
+					{
+						if (mInput.substr(mPosition, 2) != "\\u")
+							Error("a low surrogate");
+						mPosition += 2;
+						const auto low = ReadHex4();
+						if (low < 0xDC00 || low > 0xDFFF)
+							Error("a low surrogate");
+						cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+					}
+					detail::AppendUTF8(mScratch, cp);
+					break;
+				}
+				default:
+					--mPosition;
+					Error("an escape sequence");
+				}
+			}
+			Error("the end of the string");
+			return {};
+		}
+
+		/// Skips over the next value, returning its text
+		std::string_view SkipValue()
+		{
+			const auto c = Peek();
+			const auto start = mPosition;
+			switch (c)
+			{
+			case '{':
+			{
+				BeginObject();
+				std::string_view key;
+				while (NextKey(key))
+					SkipValue();
+				break;
+			}
+			case '[':
+				BeginArray();
+				while (NextElement())
+					SkipValue();
+				break;
+			case '"': ReadString(); break;
+			case 't': case 'f': ReadBool(); break;
+			case 'n': ReadNull(); break;
+			default: ReadNumber(); break;
+			}
+			return mInput.substr(start, mPosition - start);
+		}
+
+	private:
+
+		IErrorReporter& mReporter;
+		std::string_view mInput;
+		size_t mPosition = 0;
+		std::string mScratch;
+
+		static constexpr bool IsWhitespace(char c) noexcept { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
+		static constexpr bool IsNumberCharacter(char c) noexcept { return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E'; }
+
+		void Error(std::string_view expected)
+		{
+			if (mPosition < mInput.size())
+				mReporter.ThrowError("Invalid JSON at offset {}: expected {}, got '{}'", mPosition, expected, mInput[mPosition]);
+			mReporter.ThrowError("Invalid JSON: expected {}, got the end of the input", expected);
+		}
+
+		void Expect(char c, std::string_view expected)
+		{
+			if (Peek() != c)
+				Error(expected);
+			++mPosition;
+		}
+
+		void ExpectLiteral(std::string_view literal)
+		{
+			if (mInput.substr(mPosition, literal.size()) != literal)
+				Error(literal);
+			mPosition += literal.size();
+		}
+
+		char32_t ReadHex4()
+		{
+			uint32_t result = 0;
+			const auto digits = mInput.substr(mPosition, 4);
+			const auto [end, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), result, 16);
+			if (digits.size() != 4 || ec != std::errc{} || end != digits.data() + 4)
+				Error("4 hex digits");
+			mPosition += 4;
+			return result;
+		}
+
+		/// Members and elements after the first need a comma before them, which is checked by looking at the character
+		/// before the next one: only the opening brace or bracket can precede the first
+		bool NextItem(char close)
+		{
+			const auto c = Peek();
+			if (c == close)
+			{
+				++mPosition;
+				return false;
+			}
+
+			auto before = mPosition;
+			while (before > 0 && IsWhitespace(mInput[before - 1]))
+				--before;
+			const auto first = before > 0 && (mInput[before - 1] == '{' || mInput[before - 1] == '[');
+			if (!first)
+				Expect(',', close == '}' ? "',' or '}'" : "',' or ']'");
+			return true;
+		}
+	};
+
+	/// Loads records from JSON text with a `JsonPullParser`, without building a `json` tree. Fields are expected in the order
+	/// they are archived in, as `JsonWriterArchiver` writes them; others are found by scanning the rest of the object, then its
+	/// start. Unknown fields are skipped, and missing or null ones are left untouched.
+	struct JsonReaderArchiver : IArchiver<JsonReaderArchiver>
+	{
+		JsonReaderArchiver(IErrorReporter& reporter, std::span<char const> input)
+			: IArchiver(reporter, Mode::Loading), mParser(reporter, std::string_view{ input.data(), input.size() })
+		{
+		}
+
+		/// Loads a record from the next JSON object
+		template <typename T>
+		void Record(T& object)
+		{
+			mParser.BeginObject();
+			mObjects.push_back({ mParser.Position(), mParser.Position() });
+			object.Archive(*this);
+
+			/// Skips the fields that weren't archived
+			if (const auto end = mObjects.back().End; end != NotFound)
+				mParser.Seek(end);
+			else
+			{
+				mParser.Seek(mObjects.back().Cursor);
+				std::string_view key;
+				while (mParser.NextKey(key))
+					mParser.SkipValue();
+			}
+			mObjects.pop_back();
+		}
+
+		template <typename T>
+		void Value(std::string_view name, T& val)
+		{
+			switch (mMode)
+			{
+			case Mode::Loading:
+				if (mObjects.empty())
+					mReporter.ThrowError("Field '{}' is loaded outside of a record", name);
+				if (FindField(name))
+				{
+					Read(name, val);
+					mObjects.back().Cursor = mParser.Position();
+				}
+				break;
+			case Mode::Modeling:
+				ModelField(name, val);
+				break;
+			case Mode::Saving:
+			case Mode::Updating:
+			default:
+				break;
+			}
+		}
+
+	private:
+
+		static constexpr size_t NotFound = size_t(-1);
+
+		JsonPullParser mParser;
+
+		struct Object
+		{
+			size_t Start = 0;
+			/// Position after the last field loaded, where the next field most likely is
+			size_t Cursor = 0;
+			/// Position after the closing brace, once it's been found
+			size_t End = NotFound;
+		};
+		std::vector<Object> mObjects;
+
+		/// Leaves the parser at the value of the field and returns true, or leaves it at the cursor and returns false
+		bool FindField(std::string_view name)
+		{
+			auto& object = mObjects.back();
+			std::string_view key;
+			mParser.Seek(object.Cursor);
+			while (mParser.NextKey(key))
+			{
+				if (key == name)
+					return true;
+				mParser.SkipValue();
+			}
+			object.End = mParser.Position();
+
+			mParser.Seek(object.Start);
+			while (mParser.Position() < object.Cursor && mParser.NextKey(key))
+			{
+				if (key == name)
+					return true;
+				mParser.SkipValue();
+			}
+			mParser.Seek(object.Cursor);
+			return false;
+		}
+
+		template <typename T>
+		void ReadNumber(std::string_view name, T& val)
+		{
+			const auto text = mParser.ReadNumber();
+			const auto end = text.data() + text.size();
+			auto result = std::from_chars(text.data(), end, val);
+			/// Integers saved as floating point numbers by other writers
+			if constexpr (std::is_integral_v<T>)
+			{
+				double as_double = 0;
+				if (result.ptr != end && std::from_chars(text.data(), end, as_double).ptr == end && std::trunc(as_double) == as_double
+					&& as_double >= double(std::numeric_limits<T>::lowest()) && as_double <= double(std::numeric_limits<T>::max()))
+				{
+					val = T(as_double);
+					return;
+				}
+			}
+			if (result.ec != std::errc{} || result.ptr != end)
+				mReporter.ThrowError("Invalid value '{}' for field '{}'", text, name);
+		}
+
+		template <typename T>
+		void Read(std::string_view name, T& val)
+		{
+			static_assert(!std::is_pointer_v<T>, "pointers cannot be archived");
+			if (mParser.ReadNull())
+				return;
+
+			if constexpr (std::is_same_v<T, bool>)
+				val = mParser.ReadBool();
+			else if constexpr (std::is_arithmetic_v<T>)
+				ReadNumber(name, val);
+			else if constexpr (std::is_same_v<T, std::string>)
+				val = mParser.ReadString();
+			else if constexpr (detail::archivable_record<T, JsonReaderArchiver>)
+				Record(val);
+			else if constexpr (detail::is_json_vector<T>::value)
+			{
+				val.clear();
+				mParser.BeginArray();
+				while (mParser.NextElement())
+				{
+					if constexpr (std::is_same_v<typename T::value_type, bool>)
+					{
+						bool element = false;
+						Read(name, element);
+						val.push_back(element);
+					}
+					else
+						Read(name, val.emplace_back());
+				}
+			}
+			else
+			{
+				const auto text = mParser.SkipValue();
+				try
+				{
+					json::parse(text).get_to(val);
+				}
+				catch (std::exception const& e)
+				{
+					mReporter.ThrowError("Invalid value for field '{}': {}", name, e.what());
+				}
+			}
+		}
+	};
+
+	template <typename T>
+	void Archive(JsonReaderArchiver& archive, std::string_view name, T& val)
+	{
+		archive.Value(name, val);
+	}
+
+	/// Saves `object` (which needs an `Archive(ARCHIVER&)` member) as JSON text to an output buffer, without building a `json` tree;
+	/// returns the number of bytes appended
+	template <typename BUFFER, typename T>
+	size_t SaveJson(BUFFER& output, T& object, IErrorReporter& reporter)
+	{
+		JsonWriterArchiver<BUFFER> archiver{ reporter, output };
+		archiver.Record(object);
+		return archiver.Flush();
+	}
+
+	/// Loads `object` (which needs an `Archive(ARCHIVER&)` member) from JSON text in an input buffer, without building a `json` tree.
+	/// Random-access buffers are read in place and not consumed; other buffers are read whole first.
+	template <typename BUFFER, typename T>
+	void LoadJson(BUFFER& input, T& object, IErrorReporter& reporter)
+	{
+		if constexpr (input_buffer_traits<std::remove_cvref_t<BUFFER>>::is_random_access)
+		{
+			JsonReaderArchiver archiver{ reporter, buffer_remaining_span(input) };
+			archiver.Record(object);
+		}
+		else
+		{
+			std::string contents;
+			buffer_copy(input, contents);
+			JsonReaderArchiver archiver{ reporter, std::span<char const>{ contents } };
+			archiver.Record(object);
+		}
+	}
+}
@@ -0,0 +1,150 @@
+#include "MappedFileBuffers.h"
+#include <system_error>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace gamelib
+{
+#ifdef _WIN32
+
+	MappedFile::MappedFile(std::filesystem::path const& path, FileAccessPattern access)
+	{
+		const auto flags = access == FileAccessPattern::Sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS;
+		const auto file = ::CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | flags, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			throw std::system_error(int(::GetLastError()), std::system_category(), "could not open " + path.string());
+
+		LARGE_INTEGER size{};
+		if (!::GetFileSizeEx(file, &size))
+		{
+			const auto error = ::GetLastError();
+			::CloseHandle(file);
+			throw std::system_error(int(error), std::system_category(), "could not get the size of " + path.string());
+		}
+		mSize = size_t(size.QuadPart);
+
+		/// Empty files can't be mapped, but they're still open
+		if (mSize == 0)
+		{
+			::CloseHandle(file);
+			mOpen = true;
+			return;
+		}
+
+		/// The view keeps the mapping and the file open
+		const auto mapping = ::CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		::CloseHandle(file);
+		if (!mapping)
+			throw std::system_error(int(::GetLastError()), std::system_category(), "could not map " + path.string());
+
+		mData = static_cast<char const*>(::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		const auto error = ::GetLastError();
+		::CloseHandle(mapping);
+		if (!mData)
+			throw std::system_error(int(error), std::system_category(), "could not map " + path.string());
+		mOpen = true;
+
+		Advise(access);
+	}
+
+	void MappedFile::Advise(FileAccessPattern access) noexcept
+	{
+		if (!mData || access != FileAccessPattern::Sequential)
+			return;
+		/// Windows has no read-ahead hint for views, so ask for the whole file to be paged in asynchronously
+		WIN32_MEMORY_RANGE_ENTRY range{ const_cast<char*>(mData), mSize };
+		::PrefetchVirtualMemory(::GetCurrentProcess(), 1, &range, 0);
+	}
+
+	void MappedFile::Close() noexcept
+	{
+		if (mData)
+			::UnmapViewOfFile(mData);
+		mData = nullptr;
+		mSize = 0;
+		mOpen = false;
+	}
+
+#else
+
+	MappedFile::MappedFile(std::filesystem::path const& path, FileAccessPattern access)
+	{
+		const auto file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (file < 0)
+			throw std::system_error(errno, std::generic_category(), "could not open " + path.string());
+
+		struct stat status {};
+		if (::fstat(file, &status) != 0)
+		{
+			const auto error = errno;
+			::close(file);
+			throw std::system_error(error, std::generic_category(), "could not get the size of " + path.string());
+		}
+
+		/// Empty files can't be mapped, but they're still open
+		const auto size = size_t(status.st_size);
+		const auto data = size ? ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0) : nullptr;
+		const auto error = errno;
+		/// The mapping keeps the file open
+		::close(file);
+		if (data == MAP_FAILED)
+			throw std::system_error(error, std::generic_category(), "could not map " + path.string());
+
+		mData = static_cast<char const*>(data);
+		mSize = size;
+		mOpen = true;
+
+		Advise(access);
+	}
+
+	void MappedFile::Advise(FileAccessPattern access) noexcept
+	{
+		if (mData)
+			::madvise(const_cast<char*>(mData), mSize, access == FileAccessPattern::Sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+	}
+
+	void MappedFile::Close() noexcept
+	{
+		if (mData)
+			::munmap(const_cast<char*>(mData), mSize);
+		mData = nullptr;
+		mSize = 0;
+		mOpen = false;
+	}
+
+#endif
+
+	MappedFile::~MappedFile()
+	{
+		Close();
+	}
+
+	MappedFile::MappedFile(MappedFile&& other) noexcept
+		: mData(std::exchange(other.mData, nullptr))
+		, mSize(std::exchange(other.mSize, 0))
+		, mOpen(std::exchange(other.mOpen, false))
+	{
+	}
+
+	MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+	{
+		if (this != &other)
+		{
+			Close();
+			mData = std::exchange(other.mData, nullptr);
+			mSize = std::exchange(other.mSize, 0);
+			mOpen = std::exchange(other.mOpen, false);
+		}
+		return *this;
+	}
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <filesystem>
+#include <string_view>
+#include "../Buffers.h"
+
+namespace gamelib
+{
+	/// How a mapped file is going to be read; passed on to the OS so it can read ahead (or not)
+	enum class FileAccessPattern
+	{
+		Sequential,
+		Random,
+	};
+
+	/// A read-only view of a whole file mapped into memory. Pages are loaded by the OS as they are touched,
+	/// so huge files can be parsed in place without copying them into a string first.
+	class MappedFile
+	{
+	public:
+
+		MappedFile() noexcept = default;
+
+		/// Throws `std::system_error` if the file can't be opened or mapped
+		explicit MappedFile(std::filesystem::path const& path, FileAccessPattern access = FileAccessPattern::Sequential);
+		~MappedFile();
+
+		MappedFile(MappedFile&& other) noexcept;
+		MappedFile& operator=(MappedFile&& other) noexcept;
+		MappedFile(MappedFile const&) = delete;
+		MappedFile& operator=(MappedFile const&) = delete;
+
+		/// Tells the OS how the rest of the file is going to be read
+		void Advise(FileAccessPattern access) noexcept;
+
+		char const* Data() const noexcept { return mData; }
+		size_t Size() const noexcept { return mSize; }
+		std::string_view View() const noexcept { return { mData, mSize }; }
+
+		bool IsOpen() const noexcept { return mOpen; }
+		explicit operator bool() const noexcept { return IsOpen(); }
+
+		void Close() noexcept;
+
+	private:
+
+		char const* mData = nullptr;
+		size_t mSize = 0;
+		/// Empty files are open, but not mapped
+		bool mOpen = false;
+	};
+
+	/// An input buffer that reads a mapped file from start to end
+	struct MappedFileBuffer
+	{
+		MappedFile File;
+		size_t Position = 0;
+
+		MappedFileBuffer() noexcept = default;
+		explicit MappedFileBuffer(std::filesystem::path const& path, FileAccessPattern access = FileAccessPattern::Sequential)
+			: File(path, access)
+		{
+		}
+
+		std::string_view Remaining() const noexcept { return File.View().substr(Position); }
+	};
+
+	template <>
+	struct input_buffer_traits<MappedFileBuffer> : base_buffer_traits<char>
+	{
+		static constexpr bool is_random_access = true;
+		static constexpr bool can_read_chunks = true;
+	};
+
+	template <>
+	inline auto buffer_get_iterator<MappedFileBuffer&>(MappedFileBuffer& buffer, intptr_t at_element)
+	{
+		const auto remaining = buffer.Remaining();
+		return remaining.begin() + std::clamp(at_element, intptr_t{}, static_cast<intptr_t>(remaining.size()));
+	}
+
+	template <>
+	inline bool buffer_read_to<MappedFileBuffer&, char>(MappedFileBuffer& buffer, char& c)
+	{
+		if (buffer.Position >= buffer.File.Size()) return false;
+		c = buffer.File.Data()[buffer.Position++];
+		return true;
+	}
+
+	template <>
+	inline size_t buffer_available_data<MappedFileBuffer&>(MappedFileBuffer& buffer)
+	{
+		return buffer.File.Size() - buffer.Position;
+	}
+
+	/// Doesn't copy; the chunk points into the mapped file
+	template <>
+	inline std::span<char const> buffer_read_chunk<MappedFileBuffer&, char>(MappedFileBuffer& buffer, std::span<char> scratch)
+	{
+		const auto chunk = buffer.Remaining().substr(0, scratch.size());
+		buffer.Position += chunk.size();
+		return { chunk.data(), chunk.size() };
+	}
+
+}
\ No newline at end of file
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "../Buffers.h"
+#include <string>
+#include <string_view>
 
 namespace gamelib
 {
@@ -9,6 +11,7 @@ namespace gamelib
 	struct output_buffer_traits<std::string> : base_buffer_traits<char>
 	{
 		static constexpr bool can_reserve = true;
+		static constexpr bool can_append_chunks = true;
 	};
 
 	template <>
@@ -18,6 +21,13 @@ namespace gamelib
 		return true;
 	}
 
+	template <>
+	inline size_t buffer_append_chunk<std::string&, char>(std::string& buffer, std::span<char const> chunk)
+	{
+		buffer.append(chunk.data(), chunk.size());
+		return chunk.size();
+	}
+
 	template <>
 	bool buffer_reserve<std::string&>(std::string& buffer, long long int additional)
 	{
@@ -36,6 +46,7 @@ namespace gamelib
 	struct input_buffer_traits<std::string_view> : base_buffer_traits<char>
 	{
 		static constexpr bool is_random_access = true;
+		static constexpr bool can_read_chunks = true;
 	};
 
 	template <>
@@ -49,8 +60,17 @@ namespace gamelib
 	{
 		if (buffer.empty()) return false;
 		c = buffer[0];
-		buffer.remove_suffix(1);
+		buffer.remove_prefix(1);
 		return true;
 	}
 
+	/// Doesn't copy; the chunk points into the viewed string
+	template <>
+	inline std::span<char const> buffer_read_chunk<std::string_view&, char>(std::string_view& buffer, std::span<char> scratch)
+	{
+		const auto chunk = buffer.substr(0, scratch.size());
+		buffer.remove_prefix(chunk.size());
+		return { chunk.data(), chunk.size() };
+	}
+
 }
\ No newline at end of file
@@ -0,0 +1,524 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <numbers>
+#include <numeric>
+#include <thread>
+#include <sstream>
+
+#include "Includes/Format.h"
+#include "Geometry/Triangulate.h"
+#include "Geometry/RandomPoint.h"
+#include "ObjectManagement/EntityPool_.h"
+#include "Signals.h"
+#include "Serialization/IOStreamBuffers.h"
+#include "Serialization/StringBuffers.h"
+#include "Serialization/CSV.h"
+#include "Serialization/BinaryArchiver.h"
+#include "Serialization/JsonStreamArchiver.h"
+#include "Serialization/DeltaArchiver.h"
+
+using namespace gamelib;
+
+/// Runs `func` `repeats` times and returns the best time in milliseconds
+template <typename FUNC>
+double BestOf(int repeats, FUNC&& func)
+{
+	auto best = std::numeric_limits<double>::max();
+	for (int i = 0; i < repeats; ++i)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		func();
+		best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+	}
+	return best;
+}
+
+TEST(benchmarks, triangulate_10k_vertex_polygon)
+{
+	static constexpr uint32_t vertex_count = 10000;
+
+	std::vector<glm::tvec2<double>> vertices;
+	for (uint32_t i = 0; i < vertex_count; ++i)
+	{
+		const auto angle = i * 2.0 * std::numbers::pi / vertex_count;
+		const auto radius = (i % 2) ? 100.0 : 60.0 + 30.0 * std::sin(angle * 7.0);
+		vertices.push_back({ radius * std::cos(angle), radius * std::sin(angle) });
+	}
+
+	std::vector<uint32_t> indices(max_triangulation_indices(vertex_count, 0));
+	std::vector<uint32_t> polygons(indices.size());
+	std::vector<uint32_t> polygon_starts(indices.size() / 3 + 1);
+	std::vector<std::byte> arena_buffer(4 << 20);
+
+	size_t index_count = 0;
+	const auto triangulation_time = BestOf(5, [&] {
+		std::pmr::monotonic_buffer_resource arena{ arena_buffer.data(), arena_buffer.size() };
+		index_count = triangulate(std::span<glm::tvec2<double> const>{ vertices }, indices, &arena);
+	});
+	EXPECT_EQ(index_count, (vertex_count - 2) * 3);
+
+	size_t polygon_count = 0;
+	const auto decomposition_time = BestOf(5, [&] {
+		std::pmr::monotonic_buffer_resource arena{ arena_buffer.data(), arena_buffer.size() };
+		polygon_count = decompose_convex(std::span<glm::tvec2<double> const>{ vertices }, std::span<uint32_t const>{ indices.data(), index_count }, polygons, polygon_starts, &arena);
+	});
+	EXPECT_GT(polygon_count, 0);
+	EXPECT_LT(polygon_count, index_count / 3);
+
+	fmt::print("triangulate: {:.3f} ms, decompose_convex: {:.3f} ms ({} polygons)\n", triangulation_time, decomposition_time, polygon_count);
+}
+
+TEST(benchmarks, random_points_1m)
+{
+	static constexpr size_t point_count = 1'000'000;
+
+	const tcircle2<float> circle{ { 0, 0 }, 100 };
+	const rec2 rect{ 0, 0, 100, 100 };
+	std::vector<vec2> points(point_count);
+
+	std::mt19937_64 engine{ 42 };
+	const auto single_time = BestOf(3, [&] {
+		for (auto& point : points)
+			point = random_point(rect, engine);
+	});
+
+	random::CounterRNG rng{ 42 };
+	const auto batched_time = BestOf(3, [&] { random_points(rect, rng, std::span{ points }); });
+	const auto batched_engine_time = BestOf(3, [&] { random_points(rect, engine, std::span{ points }); });
+	const auto circle_time = BestOf(3, [&] { random_points(circle, rng, std::span{ points }); });
+
+	fmt::print("1M points in rect: random_point {:.3f} ms, random_points {:.3f} ms (mt19937_64: {:.3f} ms); in circle: {:.3f} ms\n", single_time, batched_time, batched_engine_time, circle_time);
+}
+
+TEST(benchmarks, poisson_disk_points)
+{
+	const rec2 area{ 0, 0, 1000, 1000 };
+	std::vector<vec2> points;
+	random::CounterRNG rng{ 42 };
+
+	const auto time = BestOf(3, [&] {
+		points.clear();
+		poisson_disk_points(area, 2.0f, rng, points);
+	});
+
+	fmt::print("poisson_disk_points: {} points in {:.3f} ms ({:.2f} Mpoints/s)\n", points.size(), time, points.size() / time / 1000.0);
+	EXPECT_GT(points.size(), 100'000);
+}
+
+TEST(benchmarks, sorted_group_10k_few_changes)
+{
+	static constexpr int entity_count = 10'000;
+	static constexpr int changes_per_frame = 20;
+	static constexpr int frames = 100;
+
+	struct Sprite { float Depth = 0; };
+	const auto by_depth = [](Sprite const& a, Sprite const& b) { return a.Depth < b.Depth; };
+
+	EntityPool<Sprite> pool;
+	pool.AddGroup("render", { .Sort = by_depth });
+	std::vector<EntityID> ids;
+	std::mt19937_64 engine{ 42 };
+	for (int i = 0; i < entity_count; ++i)
+		ids.push_back(pool.Add({ random::UnitReal<float>(random::Bits(engine)) }));
+	pool.Flush();
+
+	/// The same changes every repeat, so both versions do the same work
+	std::vector<std::pair<size_t, float>> changes;
+	for (int i = 0; i < changes_per_frame * frames; ++i)
+		changes.emplace_back(size_t(engine() % entity_count), random::UnitReal<float>(random::Bits(engine)));
+
+	const auto incremental_time = BestOf(3, [&] {
+		for (int frame = 0; frame < frames; ++frame)
+		{
+			for (int i = 0; i < changes_per_frame; ++i)
+			{
+				const auto [entity, depth] = changes[frame * changes_per_frame + i];
+				pool.Get(ids[entity])->Depth = depth;
+				pool.MarkChanged(ids[entity]);
+			}
+			pool.Flush();
+		}
+	});
+
+	std::vector<Sprite> sprites(pool.Entities().begin(), pool.Entities().end());
+	std::vector<uint32_t> order(sprites.size());
+	std::iota(order.begin(), order.end(), 0);
+	const auto full_sort_time = BestOf(3, [&] {
+		for (int frame = 0; frame < frames; ++frame)
+		{
+			for (int i = 0; i < changes_per_frame; ++i)
+			{
+				const auto [entity, depth] = changes[frame * changes_per_frame + i];
+				sprites[entity].Depth = depth;
+			}
+			std::ranges::sort(order, [&](uint32_t a, uint32_t b) { return by_depth(sprites[a], sprites[b]); });
+		}
+	});
+
+	std::vector<float> depths;
+	pool.ForEachInGroup("render", [&](Sprite const& sprite) { depths.push_back(sprite.Depth); });
+	EXPECT_EQ(depths.size(), size_t(entity_count));
+	EXPECT_TRUE(std::ranges::is_sorted(depths));
+
+	fmt::print("sorted group of {} with {} changes/frame: incremental {:.4f} ms/frame, std::sort {:.4f} ms/frame\n", entity_count, changes_per_frame, incremental_time / frames, full_sort_time / frames);
+}
+
+TEST(benchmarks, mailbox_1_4_16_producers)
+{
+	static constexpr size_t message_count = 1 << 20;
+	static constexpr size_t latency_message_count = 1 << 16;
+
+	using clock = std::chrono::steady_clock;
+
+	/// Producers spin until their message fits; the consumer delivers as fast as it can
+	const auto run = [](Mailbox<clock::time_point>& mailbox, size_t producer_count, size_t count) {
+		std::jthread consumer{ [&] {
+			for (size_t delivered = 0; delivered < count; )
+				delivered += mailbox.Deliver();
+		} };
+		std::vector<std::jthread> producers;
+		for (size_t producer = 0; producer < producer_count; ++producer)
+			producers.emplace_back([&mailbox, per_producer = count / producer_count] {
+				for (size_t i = 0; i < per_producer; ++i)
+				{
+					while (!mailbox.Post(clock::now()))
+						std::this_thread::yield();
+				}
+			});
+	};
+
+	for (size_t producer_count : { 1, 4, 16 })
+	{
+		Mailbox<clock::time_point> mailbox{ 4096 };
+		size_t received = 0;
+		mailbox.Received.Connect([&](clock::time_point&) { ++received; });
+		const auto time = BestOf(3, [&] { run(mailbox, producer_count, message_count); });
+		EXPECT_EQ(received, 3 * message_count);
+
+		/// Latency from posting to delivery; the producers are throttled so the queue doesn't sit full
+		std::vector<double> latencies;
+		latencies.reserve(latency_message_count);
+		mailbox.Received.DisconnectAll();
+		mailbox.Received.Connect([&](clock::time_point& sent) { latencies.push_back(std::chrono::duration<double, std::micro>(clock::now() - sent).count()); });
+		std::jthread consumer{ [&] {
+			while (latencies.size() < latency_message_count)
+				mailbox.Deliver();
+		} };
+		std::vector<std::jthread> producers;
+		for (size_t producer = 0; producer < producer_count; ++producer)
+			producers.emplace_back([&mailbox, per_producer = latency_message_count / producer_count] {
+				for (size_t i = 0; i < per_producer; ++i)
+				{
+					while (!mailbox.Post(clock::now()))
+						std::this_thread::yield();
+					if (i % 64 == 63)
+						std::this_thread::yield();
+				}
+			});
+		producers.clear();
+		consumer.join();
+		std::ranges::sort(latencies);
+
+		fmt::print("mailbox with {:2} producers: {:.2f} Mmessages/s, latency median {:.2f} us, p99 {:.2f} us\n",
+			producer_count, message_count / time / 1000.0, latencies[latencies.size() / 2], latencies[latencies.size() * 99 / 100]);
+	}
+}
+
+TEST(benchmarks, buffer_copy_16mb_istream_to_string)
+{
+	const std::string source(16 << 20, 'x');
+	std::string copy;
+
+	const auto chunked_time = BestOf(3, [&] {
+		std::istringstream stream{ source };
+		copy.clear();
+		buffer_copy(static_cast<std::istream&>(stream), copy);
+	});
+	EXPECT_EQ(copy.size(), source.size());
+
+	const auto per_char_time = BestOf(3, [&] {
+		std::istringstream stream{ source };
+		copy.clear();
+		char c = 0;
+		while (buffer_read_to(static_cast<std::istream&>(stream), c))
+			buffer_append(copy, std::as_const(c));
+	});
+	EXPECT_EQ(copy.size(), source.size());
+
+	fmt::print("buffer_copy of 16 MB from istream to string: chunked {:.2f} ms, per char {:.2f} ms\n", chunked_time, per_char_time);
+}
+
+TEST(benchmarks, csv_64mb_balance_table)
+{
+	/// A balance spreadsheet: ids, names, numbers, and the occasional quoted description
+	std::string csv = "id,name,hp,damage,speed,cost,description\n";
+	std::mt19937_64 engine{ 42 };
+	for (int row = 0; csv.size() < (64 << 20); ++row)
+	{
+		csv += fmt::format("{},unit_{},{},{}.{},{},{},", row, row % 977, engine() % 1000, engine() % 100, engine() % 10, engine() % 50, engine() % 10000);
+		csv += row % 10 == 0 ? "\"Fast, \"\"elite\"\" unit\"\n" : "plain\n";
+	}
+
+	size_t cells = 0;
+	const auto in_place_time = BestOf(3, [&] {
+		cells = 0;
+		LoadCSVViews(csv, [&](intptr_t, std::span<std::string_view const> row) { cells += row.size(); });
+	});
+	EXPECT_GT(cells, 0);
+
+	/// The char-by-char parser is much slower, so it only gets a slice
+	const auto slice = csv.substr(0, csv.find('\n', 4 << 20) + 1);
+	const auto by_char_time = BestOf(1, [&] {
+		std::istringstream stream{ slice };
+		LoadCSV(static_cast<std::istream&>(stream), [&](intptr_t, std::vector<std::string> row) { cells += row.size(); });
+	});
+
+	fmt::print("csv: in place {:.2f} GB/s, char by char {:.3f} GB/s\n", csv.size() / in_place_time / 1e6, slice.size() / by_char_time / 1e6);
+}
+
+TEST(benchmarks, csv_64mb_parallel_chunks)
+{
+	std::string csv = "id,name,hp,damage,speed,cost,description\n";
+	std::mt19937_64 engine{ 42 };
+	for (int row = 0; csv.size() < (64 << 20); ++row)
+	{
+		csv += fmt::format("{},unit_{},{},{}.{},{},{},", row, row % 977, engine() % 1000, engine() % 100, engine() % 10, engine() % 50, engine() % 10000);
+		csv += row % 10 == 0 ? "\"Fast, \"\"elite\"\"\nunit\"\n" : "plain\n";
+	}
+
+	intptr_t sequential_rows = 0, parallel_rows = 0;
+	const auto sequential_time = BestOf(3, [&] {
+		sequential_rows = LoadCSVViews(csv, [&](intptr_t, std::span<std::string_view const>) {});
+	});
+
+	std::atomic<size_t> cells = 0;
+	const auto any_order_time = BestOf(3, [&] {
+		parallel_rows = LoadCSVViewsParallel(csv, [&](intptr_t, std::span<std::string_view const> row) { cells.fetch_add(row.size(), std::memory_order_relaxed); }, CSVRowOrder::Any);
+	});
+	EXPECT_EQ(parallel_rows, sequential_rows);
+
+	const auto in_order_time = BestOf(3, [&] {
+		parallel_rows = LoadCSVViewsParallel(csv, [&](intptr_t, std::span<std::string_view const>) {}, CSVRowOrder::InOrder);
+	});
+	EXPECT_EQ(parallel_rows, sequential_rows);
+
+	fmt::print("csv on {} threads: sequential {:.2f} GB/s, parallel in any order {:.2f} GB/s, in order {:.2f} GB/s\n", std::thread::hardware_concurrency(),
+		csv.size() / sequential_time / 1e6, csv.size() / any_order_time / 1e6, csv.size() / in_order_time / 1e6);
+}
+
+namespace
+{
+	struct BalanceRow
+	{
+		int64_t id = 0;
+		std::string name;
+		int hp = 0;
+		double speed = 0;
+		int cost = 0;
+
+		template <typename ARCHIVER>
+		void Archive(ARCHIVER& archiver)
+		{
+			archiver & ARCHIVE_NVP(id) & ARCHIVE_NVP(name) & ARCHIVE_NVP(hp) & ARCHIVE_NVP(speed) & ARCHIVE_NVP(cost);
+		}
+	};
+}
+
+TEST(benchmarks, csv_200k_typed_records_vs_json)
+{
+	std::string csv = "id,name,hp,damage,speed,cost\n";
+	std::mt19937_64 engine{ 42 };
+	for (int row = 0; row < 200'000; ++row)
+		csv += fmt::format("{},unit_{},{},{},{}.{},{}\n", row, row % 977, engine() % 1000, engine() % 100, engine() % 10, engine() % 50, engine() % 10000);
+
+	IErrorReporter reporter;
+	std::vector<BalanceRow> rows;
+	const auto typed_time = BestOf(3, [&] {
+		std::string_view view = csv;
+		rows = LoadCSVRecords<BalanceRow>(view, reporter);
+	});
+	ASSERT_EQ(rows.size(), 200'000);
+
+	int64_t cost_sum = 0;
+	const auto json_time = BestOf(1, [&] {
+		std::string_view view = csv;
+		const auto table = LoadCSV(view);
+		for (auto const& row : table)
+			cost_sum += row["cost"].get<int64_t>();
+	});
+	EXPECT_EQ(cost_sum, std::accumulate(rows.begin(), rows.end(), int64_t{}, [](int64_t sum, BalanceRow const& row) { return sum + row.cost; }));
+
+	fmt::print("csv of 200k rows: typed records {:.2f} ms, via json {:.2f} ms\n", typed_time, json_time);
+}
+
+TEST(benchmarks, json_archiver_100k_records_model_vs_lookup)
+{
+	json rows = json::array();
+	std::mt19937_64 engine{ 7 };
+	for (int row = 0; row < 100'000; ++row)
+	{
+		json object{ { "id", row }, { "name", fmt::format("unit_{}", row % 977) }, { "hp", int(engine() % 1000) }, { "speed", double(engine() % 100) / 10 }, { "cost", int(engine() % 10000) } };
+		/// Saved by other tools, and not archived
+		for (int extra = 0; extra < 8; ++extra)
+			object[fmt::format("editor_{}", extra)] = extra;
+		rows.push_back(std::move(object));
+	}
+
+	IErrorReporter reporter;
+	std::vector<BalanceRow> modeled(rows.size()), looked_up(rows.size());
+	archive::JsonArchiver archiver{ reporter, json{} };
+	const auto model_time = BestOf(3, [&] {
+		for (size_t i = 0; i < rows.size(); ++i)
+		{
+			archiver.CurrentObject = &rows[i];
+			archiver.Record(modeled[i]);
+		}
+	});
+	const auto lookup_time = BestOf(3, [&] {
+		for (size_t i = 0; i < rows.size(); ++i)
+		{
+			archiver.CurrentObject = &rows[i];
+			looked_up[i].Archive(archiver);
+		}
+	});
+	EXPECT_EQ(modeled.back().cost, looked_up.back().cost);
+	EXPECT_EQ(modeled[500].name, rows[500]["name"]);
+
+	fmt::print("json archiver, 100k records: with class model {:.2f} ms, looking up every field {:.2f} ms\n", model_time, lookup_time);
+}
+
+namespace
+{
+	struct BalanceTable
+	{
+		std::vector<BalanceRow> Rows;
+
+		template <typename ARCHIVER>
+		void Archive(ARCHIVER& archiver) { archiver & ARCHIVE_NVP(Rows); }
+	};
+}
+
+TEST(benchmarks, json_streaming_200k_records_vs_tree)
+{
+	BalanceTable table;
+	std::mt19937_64 engine{ 11 };
+	for (int row = 0; row < 200'000; ++row)
+		table.Rows.push_back({ row, fmt::format("unit_{}", row % 977), int(engine() % 1000), double(engine() % 100) / 10, int(engine() % 10000) });
+
+	IErrorReporter reporter;
+	std::string streamed, dumped;
+	const auto stream_save_time = BestOf(3, [&] { streamed.clear(); archive::SaveJson(streamed, table, reporter); });
+	const auto tree_save_time = BestOf(3, [&] {
+		json rows = json::array();
+		for (auto& row : table.Rows)
+		{
+			archive::JsonArchiver archiver{ reporter };
+			archiver.Record(row);
+			rows.push_back(std::move(archiver.Root));
+		}
+		dumped = json{ { "Rows", std::move(rows) } }.dump();
+	});
+	EXPECT_EQ(json::parse(streamed), json::parse(dumped));
+
+	BalanceTable loaded;
+	const auto stream_load_time = BestOf(3, [&] { std::string_view view = streamed; archive::LoadJson(view, loaded, reporter); });
+	EXPECT_EQ(loaded.Rows.size(), table.Rows.size());
+	EXPECT_EQ(loaded.Rows.back().name, table.Rows.back().name);
+	const auto tree_load_time = BestOf(3, [&] {
+		auto parsed = json::parse(dumped);
+		archive::JsonArchiver archiver{ reporter, json{} };
+		loaded.Rows.resize(parsed["Rows"].size());
+		for (size_t i = 0; i < loaded.Rows.size(); ++i)
+		{
+			archiver.CurrentObject = &parsed["Rows"][i];
+			archiver.Record(loaded.Rows[i]);
+		}
+	});
+
+	fmt::print("json of 200k records: streaming save {:.2f} ms, load {:.2f} ms; via json tree save {:.2f} ms, load {:.2f} ms\n",
+		stream_save_time, stream_load_time, tree_save_time, tree_load_time);
+}
+
+namespace
+{
+	struct QuickSaveUnit
+	{
+		std::string Name;
+		glm::vec2 Position{};
+		glm::vec2 Velocity{};
+		int HP = 0;
+		std::vector<uint16_t> Inventory;
+
+		template <typename ARCHIVER>
+		void Archive(ARCHIVER& archiver) { archiver & ARCHIVE_NVP(Name) & ARCHIVE_NVP(Position) & ARCHIVE_NVP(Velocity) & ARCHIVE_NVP(HP) & ARCHIVE_NVP(Inventory); }
+	};
+
+	struct QuickSaveWorld
+	{
+		std::vector<QuickSaveUnit> Units;
+		std::vector<uint32_t> Tiles;
+
+		template <typename ARCHIVER>
+		void Archive(ARCHIVER& archiver) { archiver & ARCHIVE_NVP(Units) & ARCHIVE_NVP(Tiles); }
+	};
+}
+
+TEST(benchmarks, binary_quick_save_50k_units)
+{
+	QuickSaveWorld world;
+	std::mt19937 engine{ 3 };
+	for (int i = 0; i < 50'000; ++i)
+		world.Units.push_back({ fmt::format("unit_{}", i), { float(engine() % 1000), float(engine() % 1000) }, {}, int(engine() % 100), std::vector<uint16_t>(engine() % 8, 1) });
+	world.Tiles.resize(1024 * 1024);
+	std::iota(world.Tiles.begin(), world.Tiles.end(), 0);
+
+	IErrorReporter reporter;
+	std::string compact, versioned;
+	const auto compact_time = BestOf(5, [&] { compact.clear(); archive::SaveBinary(compact, world, reporter); });
+	const auto versioned_time = BestOf(5, [&] { versioned.clear(); archive::SaveBinary(versioned, world, reporter, archive::BinaryFormat::FieldIDs); });
+
+	QuickSaveWorld loaded;
+	const auto load_time = BestOf(5, [&] { std::string_view view = compact; archive::LoadBinary(view, loaded, reporter); });
+	EXPECT_EQ(loaded.Units.size(), world.Units.size());
+	EXPECT_EQ(loaded.Tiles, world.Tiles);
+
+	fmt::print("binary quick save: compact {:.2f} ms ({} KB), with field IDs {:.2f} ms ({} KB), compact load {:.2f} ms\n",
+		compact_time, compact.size() / 1024, versioned_time, versioned.size() / 1024, load_time);
+}
+
+TEST(benchmarks, delta_autosave_50k_units_1_percent_changed)
+{
+	QuickSaveWorld world;
+	std::mt19937 engine{ 5 };
+	for (int i = 0; i < 50'000; ++i)
+		world.Units.push_back({ fmt::format("unit_{}", i), { float(engine() % 1000), float(engine() % 1000) }, {}, int(engine() % 100), std::vector<uint16_t>(engine() % 8, 1) });
+	world.Tiles.resize(1024 * 1024);
+
+	IErrorReporter reporter;
+	archive::DeltaArchiver autosave{ reporter };
+	std::string base;
+	autosave.WriteDelta(base, world);
+
+	std::string full, delta;
+	int tick = 0;
+	const auto full_time = BestOf(5, [&] { full.clear(); archive::SaveBinary(full, world, reporter); });
+	const auto delta_time = BestOf(5, [&] {
+		++tick;
+		for (int i = 0; i < 500; ++i)
+			world.Units[engine() % world.Units.size()].HP += tick;
+		world.Tiles[engine() % world.Tiles.size()] = tick;
+		delta.clear();
+		autosave.WriteDelta(delta, world);
+	});
+
+	QuickSaveWorld loaded;
+	std::string_view view = base;
+	archive::ApplyDelta(view, loaded, reporter);
+	EXPECT_EQ(loaded.Units.size(), world.Units.size());
+
+	fmt::print("autosave of 50k units, 1% changed: full {:.2f} ms ({} KB), delta {:.2f} ms ({} KB)\n",
+		full_time, full.size() / 1024, delta_time, delta.size() / 1024);
+	EXPECT_LT(delta.size() * 10, full.size());
+}
+
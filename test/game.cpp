@@ -242,93 +242,57 @@ void Game::Update()
 	CurrentLevel.Tiles.ForEach([this](auto pos) { CurrentLevel.Tiles.At(pos)->Mem = 0; });
 
 	/// Do collisions
+	mMovers.Clear();
+	mMovingMobs.clear();
 	for (auto& obj : LevelObjects)
 	{
 		if (auto dynamic = dynamic_cast<Mob*>(obj.get()))
 		{
 			dynamic->PrevVelocity = dynamic->Velocity;
-			dynamic->Velocity.y += gravity * fdt;
-			
-			const auto tile_size = vec2{ TILE_SIZE };
-			auto pos = dynamic->Position;
-			const auto size = dynamic->Size;
-			auto vel = dynamic->Velocity;
-
-			auto check_y = [&](int& out_yo, float offs) {
-				const auto yo = int(pos.y + offs + std::clamp(vel.y * fdt, -float(TILE_SIZE / 2), float(TILE_SIZE / 2))) / 16;
-				out_yo = yo;
-				auto bottom = ivec2{ int(pos.x + size.x / 2) / 16, yo };
-				if (auto tile = CurrentLevel.Tiles.At(bottom); tile && tile->Type != TileType::Air) return tile;
-				bottom = ivec2{ int(pos.x) / 16, yo };
-				if (auto tile = CurrentLevel.Tiles.At(bottom); tile && tile->Type != TileType::Air) return tile;
-				bottom = ivec2{ int(pos.x + (size.x - 1)) / 16, yo };
-				if (auto tile = CurrentLevel.Tiles.At(bottom); tile && tile->Type != TileType::Air) return tile;
-				return (Tile*)nullptr;
-			};
-
-			if (vel.y > 0)
-			{
-				int yo = 0;
-				if (auto tile = check_y(yo, size.y))
-				{
-					pos.y = yo * 16 - size.y;
-					vel.y = 0;
-					mJumping = false;
-					mCanJump = true;
-				}
-			}
-			else if (vel.y < 0)
-			{
-				int yo = 0;
-				if (auto tile = check_y(yo, 0))
-				{
-					pos.y = (yo + 1) * 16;
-					vel.y = 0;
-					mJumping = false;
-				}
-			}
-			dynamic->Velocity.y = vel.y;
-			pos.y += vel.y * fdt;
-			dynamic->Position.y = pos.y;
-
-			auto check_x = [&](int& out_xo, float offs) {
-				const auto xo = int(pos.x + offs + std::clamp(vel.x * fdt, -float(TILE_SIZE / 2), float(TILE_SIZE / 2))) / 16;
-				out_xo = xo;
-				auto right = ivec2{ xo , int(pos.y + size.y / 2) / 16 };
-				if (auto tile = CurrentLevel.Tiles.At(right); tile && tile->Type != TileType::Air) return tile;
-				right = ivec2{ xo , int(pos.y) / 16 };
-				if (auto tile = CurrentLevel.Tiles.At(right); tile && tile->Type != TileType::Air) return tile;
-				right = ivec2{ xo , int(pos.y + (size.y - 1)) / 16 };
-				if (auto tile = CurrentLevel.Tiles.At(right); tile && tile->Type != TileType::Air) return tile;
-				return (Tile*)nullptr;
-			};
-
-			if (vel.x > 0)
-			{
-				int xo = 0;
-				if (auto tile = check_x(xo, size.x))
-				{
-					pos.x = xo * 16 - size.x;
-					vel.x = 0;
-				}
-			}
-			else if (vel.x < 0)
+			mMovingMobs.push_back(dynamic);
+			mMovers.Add(dynamic->Position, vec2{ dynamic->Size }, dynamic->Velocity);
+		}
+	}
+
+	const squares::GridCollisionParameters collision_params{
+		.TileSize = vec2{ TILE_SIZE },
+		.Gravity = { 0.0f, gravity },
+		.MaxStep = vec2{ TILE_SIZE / 2 },
+		.EdgeInset = 1.0f,
+	};
+	squares::ResolveGridCollisions(CurrentLevel.Tiles, mMovers.View(), dt, collision_params, [](ivec2, Tile const& tile) { return tile.Type != TileType::Air; });
+
+	for (size_t i = 0; i < mMovingMobs.size(); ++i)
+	{
+		const auto dynamic = mMovingMobs[i];
+		dynamic->Position = mMovers.Positions[i];
+		dynamic->Velocity = mMovers.Velocities[i];
+
+		if (dynamic == Gostek)
+		{
+			const auto contacts = mMovers.Contacts[i];
+			if (contacts.is_set(squares::GridContact::Bottom))
 			{
-				int xo = 0;
-				if (auto tile = check_x(xo, 0))
-				{
-					pos.x = (xo + 1) * 16;
-					vel.x = 0;
-				}
+				mJumping = false;
+				mCanJump = true;
 			}
-			dynamic->Velocity.x = vel.x;
-			pos.x += vel.x * fdt;
-			dynamic->Position.x = pos.x;
-
-			//ImGui::Text("Position: %gx%g", dynamic->Position.x, dynamic->Position.y);
+			else if (contacts.is_set(squares::GridContact::Top))
+				mJumping = false;
 		}
 	}
 
+	/// Rebuild the object index
+	if (mObjectIndex.GridSize() != CurrentLevel.Tiles.Size())
+		mObjectIndex.Reset(CurrentLevel.Tiles, vec2{ TILE_SIZE });
+	mIndexedObjects.clear();
+	mIndexedPositions.clear();
+	for (uint32_t i = 0; i < LevelObjects.size(); ++i)
+	{
+		mIndexedObjects.push_back(i);
+		mIndexedPositions.push_back(LevelObjects[i]->Position);
+	}
+	mObjectIndex.Rebuild(mIndexedObjects, mIndexedPositions);
+
 	mCamera.SetWorldCenter(ivec2(Gostek->Position));
 }
 
@@ -410,8 +374,14 @@ void Game::Render()
 		}
 	}
 
-	for (auto& obj : LevelObjects)
+	/// Only draw objects near the camera; grown by a tile so sprites sticking out of their positions are not culled.
+	/// The index is only used for culling: objects are drawn in `LevelObjects` order, so overlapping sprites stack the same way everywhere.
+	mVisibleObjects.clear();
+	mObjectIndex.ForEachObjectInRect(mCamera.WorldBounds().grown(float(TILE_SIZE)), [&](uint32_t index, vec2) { mVisibleObjects.push_back(index); });
+	std::ranges::sort(mVisibleObjects);
+	for (auto index : mVisibleObjects)
 	{
+		auto& obj = LevelObjects[index];
 		auto& frame = obj->Frame(); 
 		DrawTile(frame.Image.get(), frame.Pos, glm::floor(obj->Position + frame.Offset + obj->SpriteOffset));
 
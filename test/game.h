@@ -18,6 +18,8 @@
 #include <Text/TextField.h>
 #include <Debug/AllegroImGuiDebugger.h>
 #include <Navigation/Grid.h>
+#include <Navigation/GridCollision.h>
+#include <Navigation/GridObjectIndex.h>
 #include <Includes/Assuming.h>
 
 #include <filesystem>
@@ -283,5 +285,14 @@ private:
 
 	std::vector<std::function<bool(seconds_t)>> mAnimators;
 
+	squares::GridMoverArrays mMovers;
+	std::vector<Mob*> mMovingMobs;
+
+	/// Indices into `LevelObjects`
+	squares::GridObjectIndex<uint32_t> mObjectIndex;
+	std::vector<uint32_t> mIndexedObjects;
+	std::vector<vec2> mIndexedPositions;
+	std::vector<uint32_t> mVisibleObjects;
+
 	std::map<std::filesystem::path, Bitmap> mBitmaps;
 };
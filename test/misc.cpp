@@ -1,9 +1,20 @@
 #include "game.h"
 
 #include <gtest/gtest.h>
+#include <numeric>
+#include <thread>
+#include <unordered_set>
+#include <sstream>
+#include <fstream>
+#include <deque>
 
 #include "Serialization/IOStreamBuffers.h"
 #include "Serialization/StringBuffers.h"
+#include "Serialization/MappedFileBuffers.h"
+#include "Serialization/CSV.h"
+#include "Serialization/BinaryArchiver.h"
+#include "Serialization/JsonStreamArchiver.h"
+#include "Serialization/DeltaArchiver.h"
 #include "Machine/IMachine.h"
 #include "Geometry/ShapeConcept.h"
 #include "Geometry/Circle.h"
@@ -16,6 +27,16 @@
 #include "Geometry/RandomPoint.h"
 #include "Geometry/RayCast.h"
 #include "Geometry/Collision.h"
+#include "Geometry/Triangulate.h"
+#include "Navigation/GridCollision.h"
+#include "Navigation/NavMesh.h"
+#include "Navigation/GridObjectIndex.h"
+#include "Navigation/GridSnapshot.h"
+#include "ObjectManagement/EntityPool_.h"
+#include "ObjectManagement/ArchetypeStore.h"
+#include "ObjectManagement/EntityCommandBuffer.h"
+#include "Misc/SlotMap.h"
+#include "Misc/ConcurrentHandleManager.h"
 
 using namespace gamelib;
 using namespace glm;
@@ -106,3 +127,1376 @@ TEST(shapes, rect)
 		EXPECT_TRUE(s.is_valid());
 	}
 }
+
+TEST(grid_collision, movers_land_on_floor)
+{
+	squares::Grid<int> grid{ 16, 16, 0 };
+	grid.ForEachInRect(irec2{ 0, 10, 16, 11 }, [&](ivec2 pos) { *grid.At(pos) = 1; });
+
+	squares::GridMoverArrays movers;
+	for (int i = 0; i < 1000; ++i)
+		movers.Add({ 1.0f + (i % 100) * 0.1f, 2.0f }, { 0.5f, 0.5f }, {});
+
+	const squares::GridCollisionParameters params{ .Gravity = { 0.0f, 10.0f }, .ParallelBatchSize = 128 };
+	for (int frame = 0; frame < 300; ++frame)
+		squares::ResolveGridCollisions(grid, movers.View(), 1.0 / 60.0, params, [](ivec2, int tile) { return tile != 0; });
+
+	for (size_t i = 0; i < movers.Count(); ++i)
+	{
+		EXPECT_FLOAT_EQ(movers.Positions[i].y, 9.5f) << i;
+		EXPECT_TRUE(movers.Contacts[i].is_set(squares::GridContact::Bottom)) << i;
+	}
+}
+
+TEST(triangulation, polygon_with_hole)
+{
+	const std::vector<glm::tvec2<double>> vertices = { {0,0}, {10,0}, {10,10}, {0,10}, {2,2}, {2,8}, {8,8}, {8,2} };
+	const uint32_t hole_starts[] = { 4 };
+
+	std::array<std::byte, 4096> arena_buffer{};
+	std::pmr::monotonic_buffer_resource arena{ arena_buffer.data(), arena_buffer.size(), std::pmr::null_memory_resource() };
+
+	std::vector<uint32_t> indices(max_triangulation_indices(vertices.size(), 1));
+	const auto index_count = triangulate(std::span{ vertices }, hole_starts, indices, &arena);
+	ASSERT_EQ(index_count, indices.size());
+
+	std::vector<uint32_t> polygons(index_count);
+	std::vector<uint32_t> polygon_starts(index_count / 3 + 1);
+	const auto polygon_count = decompose_convex(std::span{ vertices }, std::span{ indices }, polygons, polygon_starts, &arena);
+	ASSERT_GT(polygon_count, 0);
+
+	double total_area = 0;
+	for (size_t p = 0; p < polygon_count; ++p)
+	{
+		const auto polygon = std::span{ polygons }.subspan(polygon_starts[p], polygon_starts[p + 1] - polygon_starts[p]);
+		for (size_t i = 0; i < polygon.size(); ++i)
+		{
+			const auto a = vertices[polygon[i]], b = vertices[polygon[(i + 1) % polygon.size()]], c = vertices[polygon[(i + 2) % polygon.size()]];
+			EXPECT_GE((b.x - a.x) * (c.y - b.y) - (b.y - a.y) * (c.x - b.x), 0.0) << "polygon " << p << " is not convex";
+			total_area += (a.x * b.y - b.x * a.y) / 2;
+		}
+	}
+	EXPECT_DOUBLE_EQ(total_area, 100.0 - 36.0);
+}
+
+TEST(navmesh, grid_paths_and_local_rebuild)
+{
+	/// A wall down the middle, with a gap at the bottom
+	squares::BlockNavigationGrid grid;
+	grid.Reset(10, 10);
+	for (int y = 0; y < 8; ++y)
+		grid.SetBlocksPassage({ 5, y }, true);
+
+	NavMesh mesh;
+	mesh.BuildFromGrid(grid, { 1.0f, 1.0f });
+	EXPECT_LT(mesh.PolygonCount(), 10);
+
+	const vec2 start{ 1.5f, 1.5f }, goal{ 8.5f, 1.5f };
+	auto path = mesh.FindPath(start, goal);
+	ASSERT_GE(path.size(), 4);
+	EXPECT_EQ(path.front(), goal);
+	EXPECT_EQ(path.back(), start);
+	EXPECT_EQ(path[path.size() - 2], vec2(5, 8)); /// hugs the wall's corners
+	EXPECT_EQ(path[1], vec2(6, 8));
+
+	/// Closing the gap only touches the polygons around it
+	const auto far_polygon = mesh.FindPolygon({ 0.5f, 0.5f });
+	const auto far_rect = mesh.At(far_polygon)->TileRect;
+	grid.SetBlocksPassage({ 5, 8 }, true);
+	grid.SetBlocksPassage({ 5, 9 }, true);
+	mesh.RebuildGridRect(grid, { 5, 8, 6, 10 });
+	EXPECT_TRUE(mesh.FindPath(start, goal).empty());
+	EXPECT_EQ(mesh.FindPolygon({ 0.5f, 0.5f }), far_polygon);
+	EXPECT_EQ(mesh.At(far_polygon)->TileRect.p1, far_rect.p1);
+
+	grid.SetBlocksPassage({ 5, 3 }, false);
+	mesh.RebuildGridRect(grid, { 5, 3, 6, 4 });
+	EXPECT_EQ(mesh.FindPath(start, goal).size(), 4);
+
+	/// A similar wall as an obstacle polygon, with the bounds leaving a gap above it
+	const glm::tpolygon2<float> wall{ { { 5, 0 }, { 6, 0 }, { 6, 8 }, { 5, 8 } } };
+	NavMesh polygon_mesh;
+	polygon_mesh.BuildFromPolygons({ 0, -1, 10, 10 }, std::span{ &wall, 1 });
+	path = polygon_mesh.FindPath(start, goal);
+	ASSERT_EQ(path.size(), 4);
+	EXPECT_EQ(path[1], vec2(6, 0));
+	EXPECT_EQ(path[2], vec2(5, 0));
+}
+
+TEST(random_points, batched_and_poisson_disk)
+{
+	random::CounterRNG rng{ 42 };
+
+	const tcircle2<float> circle{ { 10, 10 }, 5 };
+	std::vector<vec2> points(1000);
+	random_points(circle, rng, std::span{ points });
+	vec2 mean{};
+	for (auto& p : points)
+	{
+		EXPECT_TRUE(circle.contains(p));
+		mean += p / float(points.size());
+	}
+	EXPECT_NEAR(mean.x, 10.0f, 0.5f);
+	EXPECT_NEAR(mean.y, 10.0f, 0.5f);
+
+	/// The same counters always give the same points
+	random::CounterRNG replay{ 42 };
+	std::vector<vec2> replayed(1000);
+	random_points(circle, replay, std::span{ replayed });
+	EXPECT_EQ(points, replayed);
+
+	points.clear();
+	const rec2 area{ 0, 0, 100, 100 };
+	const auto count = poisson_disk_points(area, 5.0f, rng, points);
+	EXPECT_EQ(count, points.size());
+	EXPECT_GT(count, 200);
+	for (size_t i = 0; i < points.size(); ++i)
+	{
+		EXPECT_TRUE(area.contains(points[i]));
+		for (size_t j = i + 1; j < points.size(); ++j)
+			ASSERT_GE(glm::distance(points[i], points[j]), 5.0f);
+	}
+}
+
+TEST(grid_object_index, queries_match_brute_force)
+{
+	random::CounterRNG rng{ 7 };
+	std::vector<vec2> positions(2000);
+	random_points(rec2{ -10, -10, 330, 330 }, rng, std::span{ positions });
+	std::vector<int> objects(positions.size());
+	std::iota(objects.begin(), objects.end(), 0);
+
+	squares::GridObjectIndex<int> serial, parallel;
+	serial.Reset({ 32, 32 }, { 10.0f, 10.0f });
+	parallel.Reset({ 32, 32 }, { 10.0f, 10.0f });
+	serial.Rebuild(objects, positions);
+	parallel.Rebuild(objects, positions, 128);
+	ASSERT_EQ(serial.ObjectCount(), objects.size());
+
+	for (int y = 0; y < 32; ++y)
+		for (int x = 0; x < 32; ++x)
+			ASSERT_TRUE(std::ranges::equal(serial.ObjectsInTile({ x, y }), parallel.ObjectsInTile({ x, y })));
+
+	const vec2 center{ 100, 150 };
+	std::vector<int> found, expected;
+	parallel.ForEachObjectInRadius(center, 42.0f, [&](int object, vec2) { found.push_back(object); });
+	for (auto object : objects)
+		if (glm::distance(positions[object], center) <= 42.0f)
+			expected.push_back(object);
+	std::ranges::sort(found);
+	EXPECT_EQ(found, expected);
+
+	const rec2 rect{ 55, 5, 120, 77 };
+	size_t in_rect = 0;
+	serial.ForEachObjectInRect(rect, [&](int object, vec2 position) { EXPECT_TRUE(rect.contains(position)); ++in_rect; });
+	EXPECT_EQ(in_rect, std::ranges::count_if(positions, [&](vec2 p) { return rect.contains(p); }));
+
+	EXPECT_TRUE(serial.ForEachObjectInRadius(center, 42.0f, [&](int object, vec2) { return object == expected.front(); }));
+
+	/// Objects outside the grid are found by queries outside the grid
+	const rec2 outside{ -10, 0, -1, 320 };
+	size_t in_outside = 0;
+	parallel.ForEachObjectInRect(outside, [&](int, vec2) { ++in_outside; });
+	EXPECT_EQ(in_outside, std::ranges::count_if(positions, [&](vec2 p) { return outside.contains(p); }));
+	EXPECT_GT(in_outside, 0);
+
+	squares::GridObjectIndex<int> edge;
+	edge.Reset({ 4, 4 }, { 10.0f, 10.0f });
+	const std::vector<vec2> edge_positions{ { -5, 15 } };
+	edge.Rebuild(std::vector<int>{ 7 }, edge_positions);
+	std::vector<int> found_outside;
+	edge.ForEachObjectInRect(rec2{ -10, 10, -1, 20 }, [&](int object, vec2) { found_outside.push_back(object); });
+	EXPECT_EQ(found_outside, std::vector<int>{ 7 });
+}
+
+TEST(entity_pool, groups_follow_adds_changes_and_removals)
+{
+	struct Thing { int Value = 0; };
+	EntityPool<Thing> pool;
+	pool.AddGroup("even", { .Filter = [](Thing const& t) { return t.Value % 2 == 0; } });
+	pool.AddGroup("all", {});
+
+	int added_to_even = 0, removed = 0;
+	pool.AddedToGroup.Connect([&](std::string_view group, Thing&) { added_to_even += group == "even"; });
+	pool.Removed.Connect([&](Thing&) { ++removed; });
+
+	std::vector<EntityID> ids;
+	for (int i = 0; i < 100; ++i)
+		ids.push_back(pool.Add({ i }));
+	EXPECT_EQ(pool.Entities().size(), 0);
+	pool.Flush();
+	EXPECT_EQ(pool.Entities().size(), 100);
+	EXPECT_EQ(pool.GroupSize("even"), 50);
+	EXPECT_EQ(added_to_even, 50);
+
+	/// Changing an entity only moves it between groups once it's requeued
+	pool.Get(ids[3])->Value = 4;
+	pool.Queue(ids[3]);
+	pool.Flush();
+	EXPECT_TRUE(pool.IsInGroup(ids[3], "even"));
+	EXPECT_EQ(pool.GroupSize("even"), 51);
+
+	/// Swap-and-pop keeps IDs, groups and entities consistent
+	pool.RemoveIf([](Thing const& t) { return t.Value < 10; });
+	EXPECT_TRUE(pool.Remove(ids[50]));
+	EXPECT_FALSE(pool.Remove(ids[50]));
+	EXPECT_EQ(removed, 11);
+	EXPECT_EQ(pool.Entities().size(), 89);
+	EXPECT_EQ(pool.GroupSize("all"), 89);
+	EXPECT_EQ(pool.GroupSize("even"), 44);
+	for (int i = 10; i < 100; ++i)
+	{
+		EXPECT_EQ(pool.Contains(ids[i]), i != 50);
+		if (i != 50)
+			EXPECT_EQ(pool.Get(ids[i])->Value, i);
+	}
+	pool.ForEachInGroup("even", [](Thing& t) { EXPECT_EQ(t.Value % 2, 0); });
+
+	/// Cancelling a queued addition
+	const auto cancelled = pool.Add({ 1000 });
+	EXPECT_TRUE(pool.Remove(cancelled));
+	const auto added = pool.Add({ 1001 });
+	pool.Flush();
+	EXPECT_EQ(pool.Entities().size(), 90);
+	EXPECT_FALSE(pool.Contains(cancelled));
+	EXPECT_NE(added, cancelled);
+
+	/// IDs of removed entities don't refer to the entities that reuse their slots
+	const auto removed_id = pool.Add({ 1 });
+	pool.Flush();
+	EXPECT_TRUE(pool.Remove(removed_id));
+	const auto reused_id = pool.Add({ 2 });
+	pool.Flush();
+	EXPECT_EQ(IndexOf(reused_id), IndexOf(removed_id));
+	EXPECT_NE(reused_id, removed_id);
+	EXPECT_FALSE(pool.Contains(removed_id));
+	EXPECT_EQ(pool.Get(removed_id), nullptr);
+	EXPECT_FALSE(pool.Remove(removed_id));
+	EXPECT_FALSE(pool.IsInGroup(removed_id, "all"));
+	EXPECT_EQ(pool.Get(reused_id)->Value, 2);
+}
+
+TEST(entity_pool, cascading_removals_from_listeners)
+{
+	struct Thing { int Value = 0; std::vector<EntityID> Children; };
+	EntityPool<Thing> pool;
+	pool.AddGroup("all", {});
+
+	/// Removing a parent removes its children, from its `Removed` event
+	bool removed_self_again = true;
+	pool.Removed.Connect([&](Thing& thing) {
+		removed_self_again &= pool.Remove(pool.IDOf(thing));
+		for (auto child : thing.Children)
+			EXPECT_TRUE(pool.Remove(child));
+	});
+
+	const auto child1 = pool.Add({ 1 });
+	const auto child2 = pool.Add({ 2 });
+	const auto child3 = pool.Add({ 3 });
+	const auto parent = pool.Add({ 4, { child1 } });
+	pool.Flush();
+	EXPECT_TRUE(pool.Remove(parent));
+	EXPECT_FALSE(removed_self_again);
+	EXPECT_FALSE(pool.Contains(parent));
+	EXPECT_FALSE(pool.Contains(child1));
+	std::vector<int> values;
+	for (auto const& thing : pool.Entities())
+		values.push_back(thing.Value);
+	std::ranges::sort(values);
+	EXPECT_EQ(values, (std::vector<int>{ 2, 3 }));
+	EXPECT_EQ(pool.Get(child2)->Value, 2);
+	EXPECT_EQ(pool.Get(child3)->Value, 3);
+	EXPECT_EQ(pool.GroupSize("all"), 2);
+
+	/// Chains of removals, and removals from `RemoveIf`
+	pool.Remove(child2);
+	pool.Remove(child3);
+	std::vector<EntityID> chain;
+	for (int i = 0; i < 10; ++i)
+		chain.push_back(pool.Add({ 10 + i, i > 0 ? std::vector{ chain.back() } : std::vector<EntityID>{} }));
+	for (int i = 0; i < 10; ++i)
+		pool.Add({ 100 + i });
+	pool.Flush();
+	pool.RemoveIf([](Thing const& thing) { return thing.Value == 19 || thing.Value == 105; });
+	EXPECT_EQ(pool.Entities().size(), 9);
+	EXPECT_EQ(pool.GroupSize("all"), 9);
+	for (auto const& thing : pool.Entities())
+	{
+		EXPECT_TRUE(thing.Value >= 100 && thing.Value != 105);
+		EXPECT_EQ(pool.Get(pool.IDOf(thing)), &thing);
+	}
+}
+
+TEST(archetype_store, components_move_between_archetypes)
+{
+	struct Position { vec2 Value; };
+	struct Velocity { vec2 Value; };
+	struct Name { std::string Value; };
+
+	ArchetypeStore store;
+	store.AddGroup("moving", EntityQuery::With<Position, Velocity>());
+
+	std::vector<std::string> events;
+	store.AddedToGroup.Connect([&](std::string_view group, EntityID&) { events.push_back(std::string{ "+" } + std::string{ group }); });
+	store.RemovedFromGroup.Connect([&](std::string_view group, EntityID&) { events.push_back(std::string{ "-" } + std::string{ group }); });
+
+	std::vector<EntityID> ids;
+	for (int i = 0; i < 3000; ++i)
+		ids.push_back(store.Create(Position{ { float(i), 0 } }, Name{ std::to_string(i) }));
+	EXPECT_EQ(store.GroupSize("moving"), 0);
+
+	for (int i = 0; i < 3000; i += 2)
+		store.Set(ids[i], Velocity{ { 1, 2 } });
+	EXPECT_EQ(store.GroupSize("moving"), 1500);
+	EXPECT_EQ(events.size(), 1500);
+
+	store.ForEachInGroup<Position, Velocity>("moving", [](Position& p, Velocity const& v) { p.Value += v.Value; });
+	for (int i = 0; i < 3000; ++i)
+	{
+		EXPECT_EQ(store.Get<Position>(ids[i])->Value, vec2(float(i + (i % 2 == 0)), (i % 2 == 0) ? 2.0f : 0.0f));
+		EXPECT_EQ(store.Get<Name>(ids[i])->Value, std::to_string(i));
+	}
+
+	/// Removal swaps the last entity of the archetype into the hole
+	for (int i = 0; i < 3000; i += 3)
+		store.Destroy(ids[i]);
+	EXPECT_TRUE(store.Remove<Velocity>(ids[2]));
+	EXPECT_FALSE(store.IsInGroup(ids[2], "moving"));
+	EXPECT_EQ(events.back(), "-moving");
+	EXPECT_EQ(store.EntityCount(), 2000);
+
+	size_t count = 0;
+	store.ForEach<Name>([&](EntityID id, Name const& name) {
+		const auto i = std::stoi(name.Value);
+		EXPECT_EQ(store.Get<Position>(id)->Value.x, float(i + (i % 2 == 0)));
+		++count;
+	});
+	EXPECT_EQ(count, 2000);
+
+	/// IDs of destroyed entities don't refer to the entities that reuse their slots
+	const auto reused = store.Create(Position{ { -1, 0 } });
+	EXPECT_EQ(IndexOf(reused), IndexOf(ids[2997]));
+	EXPECT_FALSE(store.IsValid(ids[2997]));
+	EXPECT_EQ(store.Get<Position>(ids[2997]), nullptr);
+	EXPECT_FALSE(store.Destroy(ids[2997]));
+	EXPECT_EQ(store.Get<Position>(reused)->Value.x, -1.0f);
+}
+
+TEST(system_scheduler, runs_conflicting_systems_in_order)
+{
+	struct Position {}; struct Velocity {}; struct Health {};
+	struct Thing { int Position = 0; int Velocity = 0; int Health = 0; };
+
+	EntityPool<Thing> pool{ EntityPoolOptions<Thing>{
+		.Groups = { { "moving", { .Filter = [](Thing const& t) { return t.Velocity >= 0; } } } },
+		.Systems = {
+			{ .Name = "accelerate", .Writes = ComponentMaskOf<Velocity>(), .Update = [](Thing& t) { t.Velocity += 1; } },
+			{ .Name = "move", .Reads = ComponentMaskOf<Velocity>(), .Writes = ComponentMaskOf<Position>(), .Group = "moving", .Update = [](Thing& t) { t.Position += t.Velocity; } },
+			{ .Name = "regenerate", .Writes = ComponentMaskOf<Health>(), .Update = [](Thing& t) { t.Health += 1; } },
+		},
+	} };
+
+	size_t reported = 0;
+	pool.AddSystem({ .Name = "report", .Reads = ComponentMaskOf<Position, Health>(), .Update = [&](Thing const& t) { EXPECT_GE(t.Position, t.Health); ++reported; } });
+
+	auto& systems = pool.Systems();
+	ASSERT_EQ(systems.SystemCount(), 4);
+	EXPECT_TRUE(std::ranges::equal(systems.DependenciesOf(1), std::vector<size_t>{ 0 }));
+	EXPECT_TRUE(systems.DependenciesOf(2).empty());
+	EXPECT_TRUE(std::ranges::equal(systems.DependenciesOf(3), std::vector<size_t>{ 1, 2 }));
+
+	std::vector<EntityID> ids;
+	for (int i = 0; i < 1000; ++i)
+		ids.push_back(pool.Add({ .Velocity = i }));
+	pool.Flush();
+
+	WorkStealingPool workers{ 3 };
+	for (int frame = 0; frame < 3; ++frame)
+		pool.RunSystems(workers);
+
+	for (int i = 0; i < 1000; ++i)
+	{
+		auto const& thing = *pool.Get(ids[i]);
+		EXPECT_EQ(thing.Velocity, i + 3);
+		EXPECT_EQ(thing.Position, 3 * i + 6);
+		EXPECT_EQ(thing.Health, 3);
+	}
+	EXPECT_EQ(reported, 3000);
+	EXPECT_EQ(systems.TimeOf(0).SampleCount, 3);
+}
+
+TEST(entity_pool, sorted_groups_stay_sorted)
+{
+	struct Thing { int Depth = 0; };
+	EntityPool<Thing> pool;
+	pool.AddGroup("by_depth", { .Sort = [](Thing const& a, Thing const& b) { return a.Depth < b.Depth; } });
+	pool.AddGroup("shallow", { .Filter = [](Thing const& t) { return t.Depth < 500; }, .Sort = [](Thing const& a, Thing const& b) { return a.Depth > b.Depth; } });
+
+	const auto is_sorted = [&](std::string_view group, auto compare) {
+		std::vector<int> depths;
+		pool.ForEachInGroup(group, [&](Thing& t) { depths.push_back(t.Depth); });
+		return std::ranges::is_sorted(depths, compare);
+	};
+
+	std::vector<EntityID> ids;
+	for (int i = 0; i < 1000; ++i)
+		ids.push_back(pool.Add({ (i * 7919) % 1000 }));
+	pool.Flush();
+	EXPECT_TRUE(is_sorted("by_depth", std::less<>{}));
+	EXPECT_TRUE(is_sorted("shallow", std::greater<>{}));
+	EXPECT_EQ(pool.GroupSize("shallow"), 500);
+
+	/// Changes only take effect on flush, and only for marked entities (or requeued ones, which may also change groups)
+	for (int i = 0; i < 1000; i += 37)
+	{
+		pool.Get(ids[i])->Depth = 1000 - pool.Get(ids[i])->Depth;
+		if (i % 2) pool.MarkChanged(ids[i]); else pool.Queue(ids[i]);
+	}
+	pool.MarkChanged(ids[1]);
+	pool.MarkChanged(ids[1]);
+	pool.Flush();
+	EXPECT_TRUE(is_sorted("by_depth", std::less<>{}));
+	EXPECT_TRUE(is_sorted("shallow", std::greater<>{}));
+
+	/// Removals keep the order too
+	pool.RemoveIf([](Thing const& t) { return t.Depth % 3 == 0; });
+	pool.Add({ -1 });
+	pool.Flush();
+	EXPECT_TRUE(is_sorted("by_depth", std::less<>{}));
+	EXPECT_TRUE(is_sorted("shallow", std::greater<>{}));
+	EXPECT_EQ(pool.GroupSize("by_depth"), pool.Entities().size());
+	for (int i = 0; i < 1000; ++i)
+	{
+		if (pool.Contains(ids[i]))
+			EXPECT_TRUE(pool.IsInGroup(ids[i], "by_depth"));
+	}
+}
+
+TEST(entity_pool, sorted_inserts_with_pending_changes)
+{
+	struct Thing { int Depth = 0; };
+	std::mt19937 engine{ 17 };
+	for (int trial = 0; trial < 200; ++trial)
+	{
+		EntityPool<Thing> pool;
+		pool.AddGroup("by_depth", { .Sort = [](Thing const& a, Thing const& b) { return a.Depth < b.Depth; } });
+		pool.AddGroup("deep", { .Filter = [](Thing const& t) { return t.Depth >= 500; }, .Sort = [](Thing const& a, Thing const& b) { return a.Depth < b.Depth; } });
+
+		std::vector<EntityID> ids;
+		for (int i = 0; i < 64; ++i)
+			ids.push_back(pool.Add({ int(engine() % 1000) }));
+		pool.Flush();
+
+		/// Entities added and requeued in the same flush as marked ones join groups that aren't sorted yet
+		for (int i = 0; i < 8; ++i)
+		{
+			const auto id = ids[engine() % ids.size()];
+			pool.Get(id)->Depth = int(engine() % 1000);
+			if (i % 2) pool.MarkChanged(id); else pool.Queue(id);
+		}
+		pool.Add({ int(engine() % 1000) });
+		pool.Flush();
+
+		for (auto group : { "by_depth", "deep" })
+		{
+			std::vector<int> depths;
+			pool.ForEachInGroup(group, [&](Thing& t) { depths.push_back(t.Depth); });
+			ASSERT_TRUE(std::ranges::is_sorted(depths)) << group << " in trial " << trial;
+		}
+	}
+}
+
+TEST(slot_map, dense_values_and_stale_handles)
+{
+	SlotMap<int> map;
+	std::vector<Handle> handles;
+	for (int i = 0; i < 100; ++i)
+		handles.push_back(map.Insert(i));
+	EXPECT_EQ(map.Size(), 100);
+
+	/// Erasing swaps the last value in, but other handles stay valid
+	EXPECT_TRUE(map.Erase(handles[10]));
+	EXPECT_FALSE(map.Erase(handles[10]));
+	EXPECT_EQ(map.Get(handles[10]), nullptr);
+	EXPECT_EQ(*map.Get(handles[99]), 99);
+	EXPECT_EQ(map.EraseIf([](int v) { return v % 2 == 1; }), 50);
+	EXPECT_EQ(map.Size(), 49);
+
+	for (int i = 0; i < 100; ++i)
+	{
+		EXPECT_EQ(map.Contains(handles[i]), i % 2 == 0 && i != 10);
+		if (map.Contains(handles[i]))
+			EXPECT_EQ(*map.Get(handles[i]), i);
+	}
+	for (size_t i = 0; i < map.Size(); ++i)
+		EXPECT_EQ(*map.Get(map.Handles()[i]), map.Values()[i]);
+
+	/// Reused slots get new counters, so old handles don't see the new values
+	const auto reused = map.Insert(1000);
+	EXPECT_NE(reused, handles[10]);
+	EXPECT_FALSE(map.Contains(handles[10]));
+	EXPECT_EQ(std::accumulate(map.begin(), map.end(), 0), 1000 + 2450 - 10);
+
+	map.Clear();
+	EXPECT_TRUE(map.Empty());
+	EXPECT_FALSE(map.Contains(reused));
+}
+
+TEST(concurrent_handle_manager, stress_16_threads)
+{
+	static constexpr int thread_count = 16;
+	static constexpr int operations = 20000;
+
+	ConcurrentHandleManager manager;
+	/// Which thread holds each handle index; a handle must never be handed to two threads at once
+	std::vector<std::atomic<int>> owners(ConcurrentHandleManager::MaxHandles);
+	std::atomic<int> errors = 0;
+
+	{
+		std::vector<std::jthread> threads;
+		for (int t = 1; t <= thread_count; ++t)
+		{
+			threads.emplace_back([&, t] {
+				std::mt19937 engine{ uint32_t(t) };
+				std::vector<Handle> held;
+				for (int op = 0; op < operations; ++op)
+				{
+					if (held.empty() || (engine() % 3 != 0 && held.size() < 200))
+					{
+						const auto handle = manager.CreateHandle();
+						if (owners[handle.Index].exchange(t) != 0 || !manager.IsValid(handle))
+							++errors;
+						held.push_back(handle);
+					}
+					else
+					{
+						const auto which = engine() % held.size();
+						const auto handle = held[which];
+						held[which] = held.back();
+						held.pop_back();
+						if (!manager.IsValid(handle) || owners[handle.Index].exchange(0) != t)
+							++errors;
+						if (!manager.FreeHandle(handle) || manager.FreeHandle(handle))
+							++errors;
+					}
+				}
+				for (auto handle : held)
+				{
+					owners[handle.Index] = 0;
+					if (!manager.FreeHandle(handle))
+						++errors;
+				}
+			});
+		}
+	}
+
+	EXPECT_EQ(errors, 0);
+	EXPECT_LE(manager.Capacity(), thread_count * 200);
+	EXPECT_FALSE(manager.IsValid(Handle{}));
+}
+
+TEST(handle_manager, bit_widths_and_bulk_reserve)
+{
+	static_assert(sizeof(Handle) == 4 && sizeof(Handle64) == 8);
+
+	/// More live handles than 16-bit indices allow
+	HandleManager64 manager;
+	manager.Reserve(100'000);
+	EXPECT_EQ(manager.Capacity(), 100'000);
+	std::vector<Handle64> handles;
+	for (int i = 0; i < 100'000; ++i)
+		handles.push_back(manager.CreateHandle());
+	EXPECT_EQ(manager.Capacity(), 100'000);
+	EXPECT_TRUE(std::ranges::all_of(handles, [&](Handle64 h) { return manager.IsValid(h); }));
+	EXPECT_EQ(std::unordered_set<Handle64>(handles.begin(), handles.end()).size(), handles.size());
+
+	/// Counters wrap around instead of running out
+	BasicHandleManager<BasicHandle<4, 4>> tiny;
+	auto handle = tiny.CreateHandle();
+	for (int i = 0; i < 100; ++i)
+	{
+		tiny.FreeHandle(handle);
+		EXPECT_FALSE(tiny.IsValid(handle));
+		handle = tiny.CreateHandle();
+		EXPECT_TRUE(tiny.IsValid(handle));
+		EXPECT_NE(handle.Counter, 0);
+	}
+
+	SlotMap<int, Handle64> map;
+	map.Reserve(70'000);
+	for (int i = 0; i < 70'000; ++i)
+		map.Insert(i);
+	EXPECT_EQ(*map.Get(map.Handles().back()), 69'999);
+
+	BasicConcurrentHandleManager<Handle64> concurrent;
+	const auto concurrent_handle = concurrent.CreateHandle();
+	EXPECT_TRUE(concurrent.IsValid(concurrent_handle));
+	EXPECT_TRUE(concurrent.FreeHandle(concurrent_handle));
+	EXPECT_FALSE(concurrent.IsValid(concurrent_handle));
+}
+
+TEST(entity_command_buffers, record_on_threads_and_play_back)
+{
+	struct Thing { int Value = 0; int Hits = 0; };
+	EntityPool<Thing> pool;
+	pool.AddGroup("hit", { .Filter = [](Thing const& t) { return t.Hits > 0; } });
+	std::vector<EntityID> ids;
+	for (int i = 0; i < 10'000; ++i)
+		ids.push_back(pool.Add({ i }));
+	pool.Flush();
+
+	EntityCommandBuffers<Thing> commands;
+	ParallelForBatches(ids.size(), 500, [&](size_t begin, size_t end) {
+		auto& local = commands.Local();
+		for (auto i = begin; i < end; ++i)
+		{
+			const auto& thing = *pool.Get(ids[i]);
+			EXPECT_EQ(pool.IDOf(thing), ids[i]);
+			if (thing.Value % 10 == 0)
+				local.Destroy(ids[i]);
+			if (thing.Value % 3 == 0)
+			{
+				local.Modify(ids[i], [](Thing& t) { t.Hits += 1; });
+				local.Modify(ids[i], [](Thing& t) { t.Hits *= 5; });
+			}
+			if (thing.Value % 100 == 0)
+				local.Spawn({ -thing.Value - 1 });
+		}
+	});
+	EXPECT_EQ(pool.Entities().size(), 10'000);
+	EXPECT_FALSE(commands.Empty());
+
+	commands.Playback(pool);
+	EXPECT_TRUE(commands.Empty());
+	EXPECT_EQ(pool.Entities().size(), 10'000 - 1'000 + 100);
+	for (int i = 0; i < 10'000; ++i)
+	{
+		/// The spawned entities reuse the slots of the destroyed ones, but not their IDs
+		if (i % 10 == 0)
+			EXPECT_FALSE(pool.Contains(ids[i]));
+		else
+		{
+			EXPECT_EQ(pool.Get(ids[i])->Hits, i % 3 == 0 ? 5 : 0);
+			EXPECT_EQ(pool.IsInGroup(ids[i], "hit"), i % 3 == 0);
+		}
+	}
+	EXPECT_EQ(std::ranges::count_if(pool.Entities(), [](Thing const& t) { return t.Value < 0; }), 100);
+
+	/// Commands recorded with stale IDs don't touch the spawned entities
+	commands.Local().Destroy(ids[0]);
+	commands.Local().Modify(ids[10], [](Thing& t) { t.Hits = 100; });
+	commands.Playback(pool);
+	EXPECT_EQ(pool.Entities().size(), 10'000 - 1'000 + 100);
+	EXPECT_EQ(std::ranges::count_if(pool.Entities(), [](Thing const& t) { return t.Value < 0 && t.Hits == 0; }), 100);
+}
+
+TEST(signals, listeners_batches_and_disconnection)
+{
+	/// Small captures are stored inline, big ones on the heap
+	int a = 0, b = 0;
+	auto small = [&a, &b](int x) { a += x; b -= x; };
+	auto big = [&a, &b, c = std::array<int, 8>{}](int x) mutable { c[0] += x; a += c[0]; };
+	static_assert(Delegate<void(int)>::StoredInline<decltype(small)>);
+	static_assert(!Delegate<void(int)>::StoredInline<decltype(big)>);
+
+	Signal<int> signal;
+	EXPECT_FALSE(signal);
+	const auto first = signal.Connect(small);
+	signal.Connect(big);
+	signal(2);
+	EXPECT_EQ(a, 4);
+	EXPECT_EQ(b, -2);
+
+	/// Listeners can disconnect others, and connect new ones that are first called by the next emission
+	int third_calls = 0;
+	signal.Connect([&](int) { signal.Disconnect(first); signal.Connect([&](int) { ++third_calls; }); });
+	signal(1);
+	EXPECT_EQ(b, -3);
+	EXPECT_EQ(third_calls, 0);
+	EXPECT_EQ(signal.ListenerCount(), 3);
+	signal(1);
+	EXPECT_EQ(b, -3);
+	EXPECT_EQ(third_calls, 1);
+	EXPECT_FALSE(signal.Disconnect(first));
+	signal.DisconnectAll();
+	EXPECT_FALSE(signal.HasListeners());
+
+	/// A listener can disconnect itself; its (heap-stored) capture stays alive until it returns
+	std::string log;
+	int self_calls = 0;
+	ConnectionID self{};
+	self = signal.Connect([&signal, &log, &self, &self_calls, name = std::string(64, 'x')](int) {
+		++self_calls;
+		signal.Disconnect(self);
+		log = name;
+	});
+	signal(1);
+	signal(1);
+	EXPECT_EQ(self_calls, 1);
+	EXPECT_EQ(log, std::string(64, 'x'));
+	EXPECT_FALSE(signal.HasListeners());
+
+	BatchedSignal<int> batched;
+	std::vector<int> received;
+	batched.Listeners.Connect([&](std::span<int const> events) { received.assign(events.begin(), events.end()); });
+	batched.Queue(1);
+	batched.Queue(2);
+	batched.Queue(3);
+	batched.Dispatch();
+	EXPECT_EQ(received, (std::vector<int>{ 1, 2, 3 }));
+	EXPECT_EQ(batched.QueuedCount(), 0);
+
+	/// The pool hands listeners every entity added by a flush at once, even if per-entity listeners remove some
+	struct Thing { int Value = 0; };
+	EntityPool<Thing> pool;
+	std::vector<size_t> batch_sizes;
+	int added = 0;
+	pool.AddedBatch.Connect([&](std::span<Thing> things) { batch_sizes.push_back(things.size()); });
+	pool.Added.Connect([&](Thing& thing) { ++added; if (thing.Value == 0) pool.Remove(pool.IDOf(thing)); });
+	for (int i = 0; i < 10; ++i)
+		pool.Add({ i });
+	pool.Flush();
+	pool.Add({ 10 });
+	pool.Flush();
+	pool.Flush();
+	EXPECT_EQ(batch_sizes, (std::vector<size_t>{ 10, 1 }));
+	EXPECT_EQ(added, 11);
+	EXPECT_EQ(pool.Entities().size(), 10);
+
+	/// Batch listeners that remove entities don't invalidate the batch for the listeners after them
+	EntityPool<Thing> batch_pool;
+	int batch_sum = 0;
+	batch_pool.AddedBatch.Connect([&](std::span<Thing> things) { EXPECT_TRUE(batch_pool.Remove(batch_pool.IDOf(things.front()))); });
+	batch_pool.AddedBatch.Connect([&](std::span<Thing> things) { for (auto const& thing : things) batch_sum += thing.Value; });
+	for (int i = 1; i <= 10; ++i)
+		batch_pool.Add({ i });
+	batch_pool.Flush();
+	EXPECT_EQ(batch_sum, 55);
+	EXPECT_EQ(batch_pool.Entities().size(), 9);
+}
+
+TEST(signals, mailboxes_and_actors)
+{
+	/// Messages from each producer arrive in order, when their phase is dispatched
+	Mailbox<std::pair<int, int>> mailbox{ 1 << 16 };
+	MessageDispatcher dispatcher;
+	dispatcher.Add("update", mailbox);
+	std::vector<int> last_received(4, -1);
+	bool in_order = true;
+	mailbox.Received.Connect([&](std::pair<int, int>& message) {
+		in_order &= message.second == last_received[message.first] + 1;
+		last_received[message.first] = message.second;
+	});
+
+	std::vector<std::jthread> producers;
+	for (int producer = 0; producer < 4; ++producer)
+		producers.emplace_back([&mailbox, producer] {
+			for (int i = 0; i < 10'000; ++i)
+				EXPECT_TRUE(mailbox.Post({ producer, i }));
+		});
+	producers.clear();
+	EXPECT_EQ(dispatcher.Dispatch("render"), 0);
+	EXPECT_EQ(dispatcher.Dispatch("update"), 40'000);
+	EXPECT_TRUE(in_order);
+	EXPECT_EQ(last_received, (std::vector<int>(4, 9'999)));
+
+	/// Bounded: posting to a full mailbox fails
+	Mailbox<int> small{ 3 };
+	EXPECT_EQ(small.Capacity(), 4);
+	for (int i = 0; i < 4; ++i)
+		EXPECT_TRUE(small.Post(i));
+	EXPECT_FALSE(small.Post(4));
+	EXPECT_EQ(small.Deliver(), 4);
+	EXPECT_TRUE(small.Empty());
+
+	/// An actor processes its messages one at a time on pool threads, so its state needs no locking
+	struct Summer : Actor<int>
+	{
+		using Actor::Actor;
+		int64_t Sum = 0;
+		int Count = 0;
+		void Receive(int& value) override { Sum += value; ++Count; }
+	};
+
+	WorkStealingPool pool{ 4 };
+	Summer summer{ pool, 256 };
+	for (int producer = 0; producer < 4; ++producer)
+		producers.emplace_back([&summer] {
+			for (int i = 1; i <= 10'000; ++i)
+			{
+				while (!summer.Send(i))
+					std::this_thread::yield();
+			}
+		});
+	producers.clear();
+	pool.WaitIdle();
+	EXPECT_EQ(summer.Count, 40'000);
+	EXPECT_EQ(summer.Sum, 4 * 10'000 * 10'001 / 2);
+}
+
+TEST(buffers, chunked_copy_and_read_range)
+{
+	std::string source(100'000, ' ');
+	for (size_t i = 0; i < source.size(); ++i)
+		source[i] = char('a' + i % 26);
+
+	std::istringstream stream{ source };
+	std::string copy;
+	EXPECT_EQ(buffer_copy(static_cast<std::istream&>(stream), copy), source.size());
+	EXPECT_EQ(copy, source);
+
+	/// String views are consumed as they're read
+	std::string_view view = source;
+	char first[11]{};
+	EXPECT_EQ(buffer_read_cstring(view, first), 10);
+	EXPECT_EQ(std::string_view{ first }, source.substr(0, 10));
+	EXPECT_EQ(view.size(), source.size() - 10);
+
+	/// Non-contiguous outputs go through a scratch buffer
+	std::deque<char> some(5'000);
+	EXPECT_EQ(buffer_read_range(view, some.begin(), some.end()), some.size());
+	EXPECT_TRUE(std::ranges::equal(some, source.substr(10, some.size())));
+
+	std::ostringstream out;
+	EXPECT_EQ(buffer_copy(view, static_cast<std::ostream&>(out)), source.size() - 5'010);
+	EXPECT_EQ(out.str(), source.substr(5'010));
+	EXPECT_TRUE(view.empty());
+}
+
+TEST(buffers, mapped_file)
+{
+	const auto path = std::filesystem::temp_directory_path() / "gamelib_mapped_file_test.csv";
+	{
+		std::ofstream file{ path, std::ios::binary };
+		file << "name,hp\r\n\"orc, big\",100\ngoblin,7\n";
+	}
+
+	{
+		MappedFileBuffer buffer{ path };
+		EXPECT_EQ(buffer.File.Size(), 33);
+		std::vector<std::vector<std::string>> rows;
+		EXPECT_EQ(LoadCSV(buffer, [&](intptr_t, std::vector<std::string> row) { rows.push_back(std::move(row)); }), 3);
+		EXPECT_EQ(rows[1], (std::vector<std::string>{ "orc, big", "100" }));
+		EXPECT_EQ(rows[2], (std::vector<std::string>{ "goblin", "7" }));
+		/// Parsed in place, without consuming the buffer
+		EXPECT_EQ(buffer_available_data(buffer), 33);
+
+		/// Chunks point into the mapping
+		MappedFileBuffer again{ path, FileAccessPattern::Random };
+		std::string copy;
+		EXPECT_EQ(buffer_copy(again, copy), 33);
+		EXPECT_EQ(copy, buffer.File.View());
+	}
+
+	std::ofstream{ path, std::ios::trunc };
+	MappedFile empty{ path };
+	EXPECT_TRUE(empty.IsOpen());
+	EXPECT_EQ(empty.Size(), 0);
+	EXPECT_THROW(MappedFile{ path.parent_path() / "gamelib_no_such_file" }, std::system_error);
+	empty.Close();
+	std::filesystem::remove(path);
+}
+
+TEST(csv, in_place_parsing_matches_char_by_char)
+{
+	const auto parse_both = [](std::string const& csv) {
+		std::vector<std::vector<std::string>> by_char, in_place;
+		std::istringstream stream{ csv };
+		LoadCSV(static_cast<std::istream&>(stream), [&](intptr_t, std::vector<std::string> row) { by_char.push_back(std::move(row)); });
+		LoadCSVViews(csv, [&](intptr_t, std::span<std::string_view const> row) { in_place.emplace_back(row.begin(), row.end()); });
+		EXPECT_EQ(by_char, in_place) << csv;
+		return in_place;
+	};
+
+	EXPECT_EQ(parse_both("a,\"b,c\",\"d \"\"e\"\"\"\r\nf\r\n"), (std::vector<std::vector<std::string>>{ { "a", "b,c", "d \"e\"" }, { "f" } }));
+	EXPECT_EQ(parse_both("\"multi\nline\",x\n\n,\n"), (std::vector<std::vector<std::string>>{ { "multi\nline", "x" }, { "" }, { "", "" } }));
+
+	/// A CR that isn't followed by a LF is part of the cell
+	EXPECT_EQ(parse_both("a\r,b\n\r\r\nc\r"), (std::vector<std::vector<std::string>>{ { "a\r", "b" }, { "\r" }, { "c\r" } }));
+
+	/// Random quotes, delimiters, line breaks and long cells, so quote state carries over 64-byte blocks
+	std::mt19937 engine{ 7 };
+	for (int i = 0; i < 500; ++i)
+	{
+		std::string csv;
+		const auto length = engine() % 300;
+		for (size_t c = 0; c < length; ++c)
+			csv += "ab,\"\r\nxyz"[engine() % 10];
+		parse_both(csv);
+	}
+
+	/// Random-access buffers take the in-place path with either kind of callback
+	std::string_view view = "x,y\n1,2\n";
+	std::vector<std::string> last_row;
+	EXPECT_EQ(LoadCSV(view, [&](intptr_t, std::vector<std::string> row) { last_row = std::move(row); }), 2);
+	EXPECT_EQ(last_row, (std::vector<std::string>{ "1", "2" }));
+}
+
+TEST(csv, parallel_chunks_match_sequential)
+{
+	const auto parse_all = [](std::string const& csv, size_t chunk_size) {
+		std::vector<std::vector<std::string>> sequential, in_order;
+		LoadCSVViews(csv, [&](intptr_t, std::span<std::string_view const> row) { sequential.emplace_back(row.begin(), row.end()); });
+
+		intptr_t expected_line = 0;
+		EXPECT_EQ(LoadCSVViewsParallel(csv, [&](intptr_t line, std::span<std::string_view const> row) {
+			EXPECT_EQ(line, expected_line++);
+			in_order.emplace_back(row.begin(), row.end());
+		}, CSVRowOrder::InOrder, chunk_size), intptr_t(sequential.size()));
+		EXPECT_EQ(sequential, in_order) << csv;
+
+		std::mutex mutex;
+		std::map<intptr_t, std::vector<std::string>> any_order;
+		LoadCSVViewsParallel(csv, [&](intptr_t line, std::span<std::string_view const> row) {
+			std::lock_guard lock{ mutex };
+			EXPECT_TRUE(any_order.emplace(line, std::vector<std::string>(row.begin(), row.end())).second);
+		}, CSVRowOrder::Any, chunk_size);
+		ASSERT_EQ(any_order.size(), sequential.size());
+		for (auto& [line, row] : any_order)
+			EXPECT_EQ(row, sequential[line]);
+	};
+
+	/// Quoted newlines, escaped quotes and CRLFs straddling the 64-byte chunk boundaries
+	std::mt19937 engine{ 11 };
+	for (int i = 0; i < 300; ++i)
+	{
+		std::string csv;
+		const auto length = engine() % 1000;
+		for (size_t c = 0; c < length; ++c)
+			csv += "ab,\"\n\rxyz"[engine() % 10];
+		parse_all(csv, 64);
+	}
+
+	std::string table;
+	for (int row = 0; row < 5000; ++row)
+		table += fmt::format("{},\"name\n{}\",\"\"\"q\"\"\"\r\n", row, row);
+	parse_all(table, 4096);
+
+	/// Exceptions from the callback are rethrown, and stop the delivery
+	intptr_t delivered = 0;
+	EXPECT_THROW(LoadCSVViewsParallel(table, [&](intptr_t line, std::span<std::string_view const>) {
+		if (line == 1000)
+			throw std::runtime_error{ "stop" };
+		++delivered;
+	}, CSVRowOrder::InOrder, 4096), std::runtime_error);
+	EXPECT_EQ(delivered, 1000);
+
+	std::string_view view = table;
+	std::vector<std::string> last_row;
+	EXPECT_EQ(LoadCSVParallel(view, [&](intptr_t, std::vector<std::string> row) { last_row = std::move(row); }, CSVRowOrder::InOrder, 4096), 5000);
+	EXPECT_EQ(last_row, (std::vector<std::string>{ "4999", "name\n4999", "\"q\"" }));
+}
+
+namespace
+{
+	enum class ItemKind { Weapon, Armor, Potion };
+
+	struct CSVItem
+	{
+		std::string Name;
+		int Cost = 0;
+		float Weight = 1.0f;
+		bool Stackable = false;
+		ItemKind Kind = ItemKind::Weapon;
+
+		template <typename ARCHIVER>
+		void Archive(ARCHIVER& archiver)
+		{
+			archiver & ARCHIVE_NVP(Name) & ARCHIVE_NVP(Cost) & ARCHIVE_NVP(Weight) & ARCHIVE_NVP(Stackable) & ARCHIVE_NVP(Kind);
+		}
+	};
+}
+
+TEST(csv, typed_records_and_columns)
+{
+	IErrorReporter reporter;
+	const std::string_view csv = "Kind,Name,Cost,Stackable,Unused\n0,\"Sword, long\",+120,false,x\n2,Potion,-5,1,y\n1,Helmet\n";
+
+	std::string_view view = csv;
+	const auto items = LoadCSVRecords<CSVItem>(view, reporter);
+	ASSERT_EQ(items.size(), 3);
+	EXPECT_EQ(items[0].Name, "Sword, long");
+	EXPECT_EQ(items[0].Cost, 120);
+	EXPECT_EQ(items[1].Cost, -5);
+	EXPECT_TRUE(items[1].Stackable);
+	EXPECT_EQ(items[1].Kind, ItemKind::Potion);
+	/// Missing columns and cells leave the defaults
+	EXPECT_EQ(items[2].Kind, ItemKind::Armor);
+	EXPECT_EQ(items[2].Cost, 0);
+	EXPECT_EQ(items[2].Weight, 1.0f);
+
+	/// Non-random-access buffers give the same result
+	std::istringstream stream{ std::string{ csv } };
+	const auto streamed = LoadCSVRecords<CSVItem>(static_cast<std::istream&>(stream), reporter);
+	ASSERT_EQ(streamed.size(), 3);
+	EXPECT_EQ(streamed[0].Name, items[0].Name);
+
+	view = csv;
+	const auto [names, costs] = LoadCSVColumns<std::string, int>(view, { "Name", "Cost" }, reporter);
+	EXPECT_EQ(names, (std::vector<std::string>{ "Sword, long", "Potion", "Helmet" }));
+	EXPECT_EQ(costs, (std::vector<int>{ 120, -5, 0 }));
+
+	int number = 0;
+	bool flag = false;
+	EXPECT_FALSE(ParseCSVCell("12x", number));
+	EXPECT_FALSE(ParseCSVCell("yes", flag));
+
+	view = "Name,Cost\nAxe,cheap\n";
+	EXPECT_THROW(LoadCSVRecords<CSVItem>(view, reporter), Reporter);
+	view = "Name\nAxe\n";
+	EXPECT_THROW((LoadCSVColumns<std::string, int>(view, { "Name", "Cost" }, reporter)), Reporter);
+}
+
+namespace
+{
+	struct SaveUnit
+	{
+		std::string Name;
+		glm::vec2 Position{};
+		int HP = 0;
+		std::vector<int> Inventory;
+
+		template <typename ARCHIVER>
+		void Archive(ARCHIVER& archiver) { archiver & ARCHIVE_NVP(Name) & ARCHIVE_NVP(Position) & ARCHIVE_NVP(HP) & ARCHIVE_NVP(Inventory); }
+	};
+
+	struct SaveWorld
+	{
+		uint64_t Seed = 0;
+		std::vector<SaveUnit> Units;
+		std::vector<glm::ivec2> Visited;
+
+		template <typename ARCHIVER>
+		void Archive(ARCHIVER& archiver) { archiver & ARCHIVE_NVP(Seed) & ARCHIVE_NVP(Units) & ARCHIVE_NVP(Visited); }
+	};
+
+	/// A later version: a field removed, one added, and the rest reordered
+	struct SaveUnitV2
+	{
+		int HP = 0;
+		std::string Name;
+		float Morale = 0.5f;
+
+		template <typename ARCHIVER>
+		void Archive(ARCHIVER& archiver) { archiver & ARCHIVE_NVP(Morale) & ARCHIVE_NVP(HP) & ARCHIVE_NVP(Name); }
+	};
+
+	struct SaveWorldV2
+	{
+		std::vector<SaveUnitV2> Units;
+		uint64_t Seed = 0;
+
+		template <typename ARCHIVER>
+		void Archive(ARCHIVER& archiver) { archiver & ARCHIVE_NVP(Units) & ARCHIVE_NVP(Seed); }
+	};
+}
+
+TEST(archive, binary_round_trip_and_versioning)
+{
+	IErrorReporter reporter;
+	SaveWorld world{ 1234, { { "orc", { 1, 2 }, 30, { 1, 2, 3 } }, { "goblin", { -5, 0.5f }, 7, {} } }, { { 1, 1 }, { 2, 3 } } };
+
+	for (auto format : { archive::BinaryFormat::Compact, archive::BinaryFormat::FieldIDs })
+	{
+		std::string saved;
+		const auto written = archive::SaveBinary(saved, world, reporter, format);
+		EXPECT_EQ(written, saved.size());
+
+		SaveWorld loaded;
+		std::string_view view = saved;
+		archive::LoadBinary(view, loaded, reporter);
+		EXPECT_EQ(loaded.Seed, 1234);
+		ASSERT_EQ(loaded.Units.size(), 2);
+		EXPECT_EQ(loaded.Units[0].Name, "orc");
+		EXPECT_EQ(loaded.Units[0].Inventory, (std::vector<int>{ 1, 2, 3 }));
+		EXPECT_EQ(loaded.Units[1].Position, glm::vec2(-5, 0.5f));
+		EXPECT_EQ(loaded.Visited, world.Visited);
+
+		/// Streams are read whole first
+		std::istringstream stream{ saved };
+		SaveWorld streamed;
+		archive::LoadBinary(static_cast<std::istream&>(stream), streamed, reporter);
+		EXPECT_EQ(streamed.Units[1].HP, 7);
+
+		/// Running out of data is an error
+		view = std::string_view{ saved }.substr(0, saved.size() - 3);
+		EXPECT_THROW(archive::LoadBinary(view, loaded, reporter), Reporter);
+	}
+
+	/// Field IDs let a newer version load older saves
+	std::string saved;
+	archive::SaveBinary(saved, world, reporter, archive::BinaryFormat::FieldIDs);
+	SaveWorldV2 upgraded;
+	std::string_view view = saved;
+	archive::LoadBinary(view, upgraded, reporter);
+	EXPECT_EQ(upgraded.Seed, 1234);
+	ASSERT_EQ(upgraded.Units.size(), 2);
+	EXPECT_EQ(upgraded.Units[1].Name, "goblin");
+	EXPECT_EQ(upgraded.Units[1].HP, 7);
+	EXPECT_EQ(upgraded.Units[1].Morale, 0.5f);
+}
+
+namespace
+{
+	struct ModelStats
+	{
+		int Strength = 0;
+		float Speed = 0;
+
+		template <typename ARCHIVER>
+		void Archive(ARCHIVER& archiver) { archiver & ARCHIVE_NVP(Strength) & ARCHIVE_NVP(Speed); }
+	};
+
+	struct ModelUnit
+	{
+		std::string Name;
+		ModelStats Stats;
+		int HP = 0;
+		bool Elite = false;
+
+		template <typename ARCHIVER>
+		void Archive(ARCHIVER& archiver)
+		{
+			archiver & ARCHIVE_NVP(Name) & ARCHIVE_NVP(Stats) & ARCHIVE_NVP(HP);
+			/// Visited out of the model's order when loading, to exercise the fallback
+			if (archiver.CurrentMode() == ARCHIVER::Mode::Loading)
+				archiver & ARCHIVE_NVP(Elite) & ARCHIVE_NVP(HP);
+			else
+				archiver & ARCHIVE_NVP(Elite);
+		}
+	};
+}
+
+TEST(archive, class_models)
+{
+	IErrorReporter reporter;
+	archive::JsonArchiver archiver{ reporter };
+
+	auto const& model = archiver.ModelOf<ModelUnit>();
+	EXPECT_EQ(&model, &archiver.ModelOf<ModelUnit>());
+	EXPECT_EQ(model.Size, sizeof(ModelUnit));
+	ASSERT_EQ(model.Fields.size(), 4);
+	EXPECT_EQ(model.Fields[0].Name, "Name");
+	EXPECT_EQ(model.Fields[1].Offset, offsetof(ModelUnit, Stats));
+	EXPECT_EQ(model.Fields[1].Type, typeid(ModelStats));
+	EXPECT_EQ(model.Fields[2].Offset, offsetof(ModelUnit, HP));
+	EXPECT_EQ(model.Fields[2].Size, sizeof(int));
+	EXPECT_EQ(model.Fields[3].Type, typeid(bool));
+	EXPECT_EQ(model.FindField("Elite"), &model.Fields[3]);
+	EXPECT_EQ(model.FindField("Morale"), nullptr);
+
+	ModelUnit unit{ "orc", { 12, 1.5f }, 30, true };
+	archiver.Record(unit);
+	EXPECT_EQ(archiver.Root["Stats"]["Strength"], 12);
+
+	json saved = archiver.Root;
+	saved["Unknown"] = 5;
+	saved.erase("Name");
+	ModelUnit loaded{ "default" };
+	archive::JsonArchiver loader{ reporter, std::move(saved) };
+	loader.Record(loaded);
+	EXPECT_EQ(loaded.Name, "default");
+	EXPECT_EQ(loaded.Stats.Strength, 12);
+	EXPECT_EQ(loaded.Stats.Speed, 1.5f);
+	EXPECT_EQ(loaded.HP, 30);
+	EXPECT_TRUE(loaded.Elite);
+
+	/// Other archivers model records the same way
+	std::string_view header[] = { "Speed" };
+	archive::CSVArchiver csv{ reporter, header };
+	EXPECT_EQ(csv.ModelOf<ModelStats>().Fields[1].Offset, offsetof(ModelStats, Speed));
+
+	archive::JsonArchiver invalid{ reporter, json{ { "Stats", 5 } } };
+	EXPECT_THROW(invalid.Record(loaded), Reporter);
+}
+
+namespace
+{
+	struct StreamSquad
+	{
+		std::string Name;
+		std::vector<ModelUnit> Units;
+		std::vector<bool> Flags;
+		std::vector<double> Weights;
+		uint64_t Seed = 0;
+
+		template <typename ARCHIVER>
+		void Archive(ARCHIVER& archiver) { archiver & ARCHIVE_NVP(Name) & ARCHIVE_NVP(Units) & ARCHIVE_NVP(Flags) & ARCHIVE_NVP(Weights) & ARCHIVE_NVP(Seed); }
+	};
+}
+
+TEST(archive, json_streaming)
+{
+	IErrorReporter reporter;
+	StreamSquad squad{ "the \"quoted\"\n\\ squad", { { "orc", { 12, 1.5f }, 30, true }, { "elf", { 3, 2.25f }, 8, false } }, { true, false, true }, { 0.1, -2e300 }, 1ull << 60 };
+
+	std::string saved;
+	const auto written = archive::SaveJson(saved, squad, reporter);
+	EXPECT_EQ(written, saved.size());
+	const auto parsed = json::parse(saved);
+	EXPECT_EQ(parsed["Name"], squad.Name);
+	EXPECT_EQ(parsed["Units"][1]["Stats"]["Speed"], 2.25);
+	EXPECT_EQ(parsed["Seed"], squad.Seed);
+
+	StreamSquad loaded;
+	std::string_view view = saved;
+	archive::LoadJson(view, loaded, reporter);
+	EXPECT_EQ(loaded.Name, squad.Name);
+	ASSERT_EQ(loaded.Units.size(), 2);
+	EXPECT_EQ(loaded.Units[1].Stats.Speed, 2.25f);
+	EXPECT_TRUE(loaded.Units[0].Elite);
+	EXPECT_EQ(loaded.Flags, squad.Flags);
+	EXPECT_EQ(loaded.Weights, squad.Weights);
+	EXPECT_EQ(loaded.Seed, squad.Seed);
+
+	std::ostringstream out;
+	archive::SaveJson(static_cast<std::ostream&>(out), squad, reporter);
+	EXPECT_EQ(out.str(), saved);
+	std::istringstream in{ saved };
+	StreamSquad streamed;
+	archive::LoadJson(static_cast<std::istream&>(in), streamed, reporter);
+	EXPECT_EQ(streamed.Units[0].Name, "orc");
+
+	/// Text from elsewhere: reordered, unknown, escaped, null and missing fields
+	std::string_view edited_text = R"( { "Seed": 7.0, "Extra": { "a": [1, {"b": null}], "c": "\"}" }, "Units": [ { "HP": 5, "Name": "\u00e9\ud83d\ude00" } ], "Name": null } )";
+	StreamSquad edited{ "kept" };
+	archive::LoadJson(edited_text, edited, reporter);
+	EXPECT_EQ(edited.Seed, 7);
+	EXPECT_EQ(edited.Name, "kept");
+	ASSERT_EQ(edited.Units.size(), 1);
+	EXPECT_EQ(edited.Units[0].Name, "\xC3\xA9\xF0\x9F\x98\x80");
+	EXPECT_EQ(edited.Units[0].HP, 5);
+	EXPECT_EQ(edited.Units[0].Stats.Strength, 0);
+
+	for (std::string_view malformed : { R"({"Seed": 1,})", R"({"Seed": 1 "Name": "x"})", R"({"Name": "open)", R"({"Seed": "text"})", R"({"Units": [{"HP": 1}, ]})" })
+	{
+		StreamSquad target;
+		EXPECT_THROW(archive::LoadJson(malformed, target, reporter), Reporter) << malformed;
+	}
+}
+
+TEST(archive, delta_autosaves)
+{
+	IErrorReporter reporter;
+	SaveWorld world{ 1234, { { "orc", { 1, 2 }, 30, { 1, 2, 3 } }, { "goblin", { -5, 0.5f }, 7, {} } }, { { 1, 1 }, { 2, 3 } } };
+	for (int i = 0; i < 1000; ++i)
+		world.Units.push_back({ "unit_" + std::to_string(i), { float(i), 0 }, i % 50, { i, 7 } });
+
+	archive::DeltaArchiver autosave{ reporter };
+	std::vector<std::string> deltas(1);
+	autosave.WriteDelta(deltas.back(), world);
+
+	/// Nothing changed
+	deltas.emplace_back();
+	EXPECT_EQ(autosave.WriteDelta(deltas.back(), world), 3);
+
+	world.Units[500].HP = 1;
+	deltas.emplace_back();
+	autosave.WriteDelta(deltas.back(), world);
+	EXPECT_LT(deltas.back().size(), 16);
+
+	world.Seed = 99;
+	world.Units.erase(world.Units.end() - 3);
+	world.Units.back().Inventory.push_back(9);
+	world.Visited.clear();
+	deltas.emplace_back();
+	autosave.WriteDelta(deltas.back(), world);
+	EXPECT_LT(deltas.back().size(), deltas[0].size() / 50);
+
+	/// Large vectors of plain values only write the chunks that changed
+	world.Visited.assign(10'000, { 1, 2 });
+	deltas.emplace_back();
+	autosave.WriteDelta(deltas.back(), world);
+	world.Visited[7777] = { 3, 4 };
+	deltas.emplace_back();
+	autosave.WriteDelta(deltas.back(), world);
+	EXPECT_LT(deltas.back().size(), archive::DeltaArchiver::ChunkSize + 16);
+
+	/// Applying the deltas in order gives the latest state
+	SaveWorld loaded;
+	for (auto const& delta : deltas)
+	{
+		std::string_view view = delta;
+		archive::ApplyDelta(view, loaded, reporter);
+	}
+	EXPECT_EQ(loaded.Seed, 99);
+	EXPECT_EQ(loaded.Visited, world.Visited);
+	ASSERT_EQ(loaded.Units.size(), world.Units.size());
+	for (size_t i = 0; i < world.Units.size(); ++i)
+	{
+		EXPECT_EQ(loaded.Units[i].Name, world.Units[i].Name);
+		EXPECT_EQ(loaded.Units[i].Position, world.Units[i].Position);
+		EXPECT_EQ(loaded.Units[i].HP, world.Units[i].HP);
+		EXPECT_EQ(loaded.Units[i].Inventory, world.Units[i].Inventory);
+	}
+
+	/// Streams are read whole first
+	SaveWorld streamed;
+	for (size_t i = 0; i < 3; ++i)
+	{
+		std::istringstream stream{ deltas[i] };
+		archive::ApplyDelta(static_cast<std::istream&>(stream), streamed, reporter);
+	}
+	EXPECT_EQ(streamed.Units[500].HP, 1);
+	EXPECT_EQ(streamed.Seed, 1234);
+
+	/// After a reset, the next delta is a full snapshot again
+	autosave.Reset();
+	std::string full;
+	autosave.WriteDelta(full, world);
+	SaveWorld restored;
+	std::string_view view = full;
+	archive::ApplyDelta(view, restored, reporter);
+	EXPECT_EQ(restored.Units.back().Inventory, world.Units.back().Inventory);
+
+	view = std::string_view{ deltas[0] }.substr(0, deltas[0].size() / 2);
+	EXPECT_THROW(archive::ApplyDelta(view, restored, reporter), Reporter);
+}
+
+TEST(grid, mapped_snapshot)
+{
+	struct SnapshotTile
+	{
+		uint16_t Terrain = 0;
+		uint8_t Height = 0;
+		bool Blocked = false;
+	};
+
+	squares::Grid<SnapshotTile> grid{ 300, 200 };
+	for (int y = 0; y < grid.Height(); ++y)
+		for (int x = 0; x < grid.Width(); ++x)
+			*grid.At(x, y) = { uint16_t(x * y), uint8_t(x + y), (x ^ y) % 7 == 0 };
+
+	const auto path = std::filesystem::temp_directory_path() / "gamelib_grid_snapshot_test.bin";
+	{
+		std::ofstream file{ path, std::ios::binary };
+		EXPECT_EQ(squares::SaveGridSnapshot(static_cast<std::ostream&>(file), grid, 3), 64 + 300 * 200 * sizeof(SnapshotTile));
+	}
+
+	{
+		squares::MappedGrid<SnapshotTile> mapped{ path, 3 };
+		EXPECT_EQ(mapped->Size(), grid.Size());
+		EXPECT_EQ(mapped->At(123, 45)->Terrain, 123 * 45);
+		EXPECT_EQ(mapped->At(299, 199)->Height, uint8_t(299 + 199));
+		EXPECT_EQ(mapped->At(300, 0), nullptr);
+		EXPECT_EQ(reinterpret_cast<uintptr_t>(mapped->Tiles().data()) % squares::GridSnapshotHeader::TileArrayAlignment, 0);
+
+		const auto copy = mapped->ToGrid();
+		EXPECT_EQ(copy.At(17, 3)->Blocked, grid.At(17, 3)->Blocked);
+
+		/// Other versions and tile types are rejected
+		EXPECT_THROW(squares::MappedGrid<SnapshotTile>(path, 4), std::runtime_error);
+		EXPECT_THROW(squares::MappedGrid<uint64_t>(path, 3), std::runtime_error);
+	}
+
+	std::string snapshot;
+	squares::SaveGridSnapshot(snapshot, grid);
+	squares::Grid<SnapshotTile> loaded;
+	squares::LoadGridSnapshot(snapshot, loaded);
+	EXPECT_EQ(loaded.Size(), grid.Size());
+	EXPECT_EQ(loaded.At(250, 150)->Terrain, uint16_t(250 * 150));
+	EXPECT_THROW(squares::ViewGridSnapshot<SnapshotTile>(std::string_view{ snapshot }.substr(0, 1000)), std::runtime_error);
+
+	std::filesystem::remove(path);
+}
+